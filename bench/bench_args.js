@@ -0,0 +1,62 @@
+/**
+ * Cost of the argument extraction of the bindings, per argument type.
+ *
+ *   node bench/bench_args.js [baseline/build/Release/sodium.node]
+ *
+ * crypto_verify_16 on 16 bytes does next to no work, so its time per call is mostly
+ * call and argument overhead. When the path of another build of the module is given,
+ * the Buffer case is measured with it too.
+ */
+"use strict";
+
+var path = require('path');
+var crypto = require('crypto');
+
+var current = require('../build/Release/sodium');
+var baseline = process.argv[2] ? require(path.resolve(process.argv[2])) : null;
+
+var ITERATIONS = 2000000;
+
+var bytes = crypto.randomBytes(16);
+
+function arena(Type) {
+    var buffer = new Type(64);
+    var view = new Uint8Array(buffer, 16, 16);
+    view.set(bytes);
+    return view;
+}
+
+var ARGUMENTS = {
+    'Buffer': bytes,
+    'Uint8Array': new Uint8Array(bytes),
+    'Uint8Array at an offset': arena(ArrayBuffer),
+    'DataView': new DataView(arena(ArrayBuffer).buffer, 16, 16),
+    'ArrayBuffer': new Uint8Array(bytes).buffer
+};
+if (typeof SharedArrayBuffer !== 'undefined') {
+    ARGUMENTS['SharedArrayBuffer view'] = arena(SharedArrayBuffer);
+}
+
+// Nanoseconds per call
+function measure(sodium, arg) {
+    for (var i = 0; i < 10000; i++) sodium.crypto_verify_16(arg, arg);
+
+    var start = process.hrtime();
+    for (i = 0; i < ITERATIONS; i++) sodium.crypto_verify_16(arg, arg);
+    var elapsed = process.hrtime(start);
+    return (elapsed[0] * 1e9 + elapsed[1]) / ITERATIONS;
+}
+
+function pad(str, width) {
+    str = String(str);
+    while (str.length < width) str += ' ';
+    return str;
+}
+
+console.log(pad('argument type', 28) + 'ns/call');
+Object.keys(ARGUMENTS).forEach(function(name) {
+    console.log(pad(name, 28) + measure(current, ARGUMENTS[name]).toFixed(1));
+});
+if (baseline) {
+    console.log(pad('Buffer (baseline)', 28) + measure(baseline, ARGUMENTS.Buffer).toFixed(1));
+}
@@ -0,0 +1,87 @@
+/**
+ * Peak memory and speed of the password based file encryption: encrypt_file/decrypt_file,
+ * which hold the whole file in memory, against encrypt_file_stream/decrypt_file_stream.
+ *
+ *   node bench/bench_file_stream.js
+ *
+ * Each case runs in its own process, so that its peak resident set is its own. The peak of the
+ * streaming functions should not depend on the file size. Needs about 3 GB of free disk space
+ * in the temporary directory. The baseline module argument of the other benchmarks is ignored.
+ */
+"use strict";
+
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+var childProcess = require('child_process');
+
+var SIZES = [16 * 1024 * 1024, 256 * 1024 * 1024, 1024 * 1024 * 1024];
+var dir = os.tmpdir();
+var plainFile = path.join(dir, 'sodium-bench.txt');
+var encryptedFile = path.join(dir, 'sodium-bench.enc');
+var decryptedFile = path.join(dir, 'sodium-bench.out');
+var password = 'benchmark password';
+
+// Child process: runs one case, prints its peak RSS (MB) and duration (s)
+if (process.argv[2] == 'run') {
+    var sodium = require('../build/Release/sodium');
+    var start = process.hrtime();
+    switch (process.argv[3]) {
+        case 'encrypt_file':
+            sodium.encrypt_file(fs.readFileSync(plainFile), new Buffer(password), encryptedFile);
+            break;
+        case 'decrypt_file':
+            fs.writeFileSync(decryptedFile, sodium.decrypt_file(encryptedFile, new Buffer(password)));
+            break;
+        case 'encrypt_file_stream':
+            sodium.encrypt_file_stream(plainFile, encryptedFile, new Buffer(password));
+            break;
+        case 'decrypt_file_stream':
+            sodium.decrypt_file_stream(encryptedFile, decryptedFile, new Buffer(password));
+            break;
+    }
+    var elapsed = process.hrtime(start);
+    var maxRss = process.resourceUsage ? process.resourceUsage().maxRSS / 1024 : process.memoryUsage().rss / 1e6;
+    console.log(JSON.stringify({ rss: maxRss, seconds: elapsed[0] + elapsed[1] / 1e9 }));
+    process.exit(0);
+}
+
+function pad(str, width) {
+    str = String(str);
+    while (str.length < width) str = ' ' + str;
+    return str;
+}
+
+function writeFile(size) {
+    var fd = fs.openSync(plainFile, 'w');
+    var block = new Buffer(1024 * 1024);
+    block.fill(0x61);
+    for (var written = 0; written < size; written += block.length) {
+        fs.writeSync(fd, block, 0, Math.min(block.length, size - written));
+    }
+    fs.closeSync(fd);
+}
+
+function run(name) {
+    var child = childProcess.spawnSync(process.execPath, [__filename, 'run', name], { encoding: 'utf8' });
+    if (child.status !== 0) return null;
+    return JSON.parse(child.stdout);
+}
+
+console.log(pad('size MB', 10) + pad('case', 22) + pad('peak RSS MB', 14) + pad('MB/s', 10));
+SIZES.forEach(function(size) {
+    writeFile(size);
+    [['encrypt_file', 'decrypt_file'], ['encrypt_file_stream', 'decrypt_file_stream']].forEach(function(pair) {
+        pair.forEach(function(name) {
+            var result = run(name);
+            var line = pad(size / (1024 * 1024), 10) + pad(name, 22);
+            // encrypt_file can't write files of 4 GiB or more, and needs the whole file in a Buffer
+            line += result ? pad(result.rss.toFixed(0), 14) + pad((size / 1e6 / result.seconds).toFixed(0), 10) : pad('failed', 14);
+            console.log(line);
+        });
+    });
+});
+
+[plainFile, encryptedFile, decryptedFile].forEach(function(name) {
+    if (fs.existsSync(name)) fs.unlinkSync(name);
+});
@@ -0,0 +1,99 @@
+/**
+ * Memory cost and speed of KeyRing encrypt/decrypt: resident set and external memory
+ * growth per call, measured over many calls after a full GC.
+ *
+ *   node --expose-gc bench/bench_keyring.js [baseline/build/Release/sodium.node]
+ *
+ * A leak shows as a per-call RSS growth close to the message size, that doesn't go
+ * away after GC. When the path of another build of the module is given (eg. one built
+ * from an older commit), both are measured.
+ */
+"use strict";
+
+var path = require('path');
+var crypto = require('crypto');
+
+var current = require('../build/Release/sodium');
+var baseline = process.argv[2] ? require(path.resolve(process.argv[2])) : null;
+
+var SIZES = [64, 1024, 64 * 1024];
+var CALLS = 20000;
+
+function gc() {
+    if (global.gc) global.gc();
+}
+
+function setup(sodium, size) {
+    var alice = new sodium.KeyRing();
+    var bob = new sodium.KeyRing();
+    var s = {
+        alice: alice,
+        bob: bob,
+        alicePub: new Buffer(alice.createKeyPair('curve25519').publicKey, 'hex'),
+        bobPub: new Buffer(bob.createKeyPair('curve25519').publicKey, 'hex'),
+        message: crypto.randomBytes(size),
+        nonce: crypto.randomBytes(sodium.crypto_box_NONCEBYTES)
+    };
+    s.cipher = alice.encrypt(s.message, s.bobPub, s.nonce);
+    if (alice.encryptEasy) s.easyCipher = alice.encryptEasy(s.message, s.bobPub, s.nonce);
+    return s;
+}
+
+var CASES = {
+    encrypt: function(s) {
+        return s.alice.encrypt(s.message, s.bobPub, s.nonce);
+    },
+    decrypt: function(s) {
+        return s.bob.decrypt(s.cipher, s.alicePub, s.nonce);
+    },
+    encryptEasy: function(s) {
+        return s.alice.encryptEasy(s.message, s.bobPub, s.nonce);
+    },
+    decryptEasy: function(s) {
+        return s.bob.decryptEasy(s.easyCipher, s.alicePub, s.nonce);
+    }
+};
+
+// {rss, external} growth per call in bytes, and calls per second
+function measure(sodium, fn, size) {
+    var s = setup(sodium, size);
+    for (var i = 0; i < 1000; i++) fn(s);
+    gc();
+    var before = process.memoryUsage();
+
+    var start = process.hrtime();
+    for (i = 0; i < CALLS; i++) fn(s);
+    var elapsed = process.hrtime(start);
+
+    gc();
+    var after = process.memoryUsage();
+    return {
+        rss: (after.rss - before.rss) / CALLS,
+        external: ((after.external || 0) - (before.external || 0)) / CALLS,
+        ops: CALLS / (elapsed[0] + elapsed[1] / 1e9)
+    };
+}
+
+function pad(str, width) {
+    str = String(str);
+    while (str.length < width) str = ' ' + str;
+    return str;
+}
+
+function format(r) {
+    return pad(r.rss.toFixed(1), 12) + pad(r.external.toFixed(1), 12) + pad(Math.round(r.ops), 10);
+}
+
+if (!global.gc) console.log('Run with --expose-gc for accurate figures');
+console.log(pad('function', 14) + pad('size', 8) + pad('RSS B/call', 12) + pad('ext B/call', 12) + pad('ops/s', 10) +
+    (baseline ? pad('base RSS', 12) + pad('base ext', 12) + pad('base ops/s', 12) : ''));
+Object.keys(CASES).forEach(function(name) {
+    SIZES.forEach(function(size) {
+        var line = pad(name, 14) + pad(size, 8) + format(measure(current, CASES[name], size));
+        if (baseline) {
+            var proto = new baseline.KeyRing();
+            line += proto[name] ? format(measure(baseline, CASES[name], size)) : pad('n/a', 12);
+        }
+        console.log(line);
+    });
+});
@@ -0,0 +1,91 @@
+/**
+ * Throughput of the NaCl format box/secretbox bindings at 64 B, 1 KB and 1 MB.
+ *
+ *   node bench/bench_nacl_box.js [baseline/build/Release/sodium.node]
+ *
+ * When the path of another build of the module is given (eg. one built from an older
+ * commit), both are measured and the gain over the baseline is printed.
+ */
+"use strict";
+
+var path = require('path');
+var crypto = require('crypto');
+
+var current = require('../build/Release/sodium');
+var baseline = process.argv[2] ? require(path.resolve(process.argv[2])) : null;
+
+var SIZES = [64, 1024, 1024 * 1024];
+// Enough work per size for a stable measure
+var BYTES_PER_RUN = 64 * 1024 * 1024;
+var MIN_ITERATIONS = 20;
+
+function setup(sodium, size) {
+    var alice = sodium.crypto_box_keypair();
+    var bob = sodium.crypto_box_keypair();
+    var s = {
+        message: crypto.randomBytes(size),
+        boxNonce: crypto.randomBytes(sodium.crypto_box_NONCEBYTES),
+        secretboxNonce: crypto.randomBytes(sodium.crypto_secretbox_NONCEBYTES),
+        key: crypto.randomBytes(sodium.crypto_secretbox_KEYBYTES),
+        alice: alice,
+        bob: bob,
+        k: sodium.crypto_box_beforenm(bob.publicKey, alice.secretKey)
+    };
+    s.secretbox = sodium.crypto_secretbox(s.message, s.secretboxNonce, s.key);
+    s.box = sodium.crypto_box(s.message, s.boxNonce, bob.publicKey, alice.secretKey);
+    s.afternm = sodium.crypto_box_afternm(s.message, s.boxNonce, s.k);
+    return s;
+}
+
+var CASES = {
+    crypto_secretbox: function(sodium, s) {
+        return sodium.crypto_secretbox(s.message, s.secretboxNonce, s.key);
+    },
+    crypto_secretbox_open: function(sodium, s) {
+        return sodium.crypto_secretbox_open(s.secretbox, s.secretboxNonce, s.key);
+    },
+    crypto_box: function(sodium, s) {
+        return sodium.crypto_box(s.message, s.boxNonce, s.bob.publicKey, s.alice.secretKey);
+    },
+    crypto_box_open: function(sodium, s) {
+        return sodium.crypto_box_open(s.box, s.boxNonce, s.alice.publicKey, s.bob.secretKey);
+    },
+    crypto_box_afternm: function(sodium, s) {
+        return sodium.crypto_box_afternm(s.message, s.boxNonce, s.k);
+    }
+};
+
+// MB/s of fn on size bytes messages
+function measure(sodium, fn, size) {
+    var s = setup(sodium, size);
+    var iterations = Math.max(MIN_ITERATIONS, Math.floor(BYTES_PER_RUN / size));
+
+    // Warm up
+    for (var i = 0; i < Math.min(iterations, 1000); i++) fn(sodium, s);
+
+    var start = process.hrtime();
+    for (i = 0; i < iterations; i++) fn(sodium, s);
+    var elapsed = process.hrtime(start);
+    var seconds = elapsed[0] + elapsed[1] / 1e9;
+    return (size * iterations) / (1024 * 1024) / seconds;
+}
+
+function pad(str, width) {
+    str = String(str);
+    while (str.length < width) str = ' ' + str;
+    return str;
+}
+
+console.log(pad('function', 24) + pad('size', 10) + pad('MB/s', 12) + (baseline ? pad('baseline', 12) + pad('gain', 10) : ''));
+Object.keys(CASES).forEach(function(name) {
+    SIZES.forEach(function(size) {
+        var line = pad(name, 24) + pad(size, 10);
+        var mbs = measure(current, CASES[name], size);
+        line += pad(mbs.toFixed(1), 12);
+        if (baseline) {
+            var baseMbs = measure(baseline, CASES[name], size);
+            line += pad(baseMbs.toFixed(1), 12) + pad(((mbs / baseMbs - 1) * 100).toFixed(1) + '%', 10);
+        }
+        console.log(line);
+    });
+});
@@ -0,0 +1,86 @@
+/**
+ * Throughput and memory of SecretboxStream on a 1 GiB input, fed in 1 MiB pieces as a
+ * file stream would, against crypto_stream_xor on the same pieces (the cipher alone,
+ * without the MACs) and against crypto_secretbox_easy called from JS on each chunk.
+ *
+ *   node --expose-gc bench/bench_secretbox_stream.js
+ *
+ * The resident set should not grow with the input: the pieces are dropped as they are
+ * produced. The baseline module argument of the other benchmarks is ignored.
+ */
+"use strict";
+
+var crypto = require('crypto');
+
+var sodium = require('../build/Release/sodium');
+
+var TOTAL = 1024 * 1024 * 1024;
+var PIECE = 1024 * 1024;
+var CHUNK = sodium.SecretboxStream.DEFAULT_CHUNKSIZE;
+
+function gc() {
+    if (global.gc) global.gc();
+}
+
+function pad(str, width) {
+    str = String(str);
+    while (str.length < width) str = ' ' + str;
+    return str;
+}
+
+// Runs fn on TOTAL bytes in PIECE pieces. Returns MB/s and the RSS growth in MB
+function measure(fn) {
+    var piece = crypto.randomBytes(PIECE);
+    gc();
+    var rss = process.memoryUsage().rss;
+    var maxRss = rss;
+    var start = process.hrtime();
+    for (var done = 0; done < TOTAL; done += PIECE) {
+        fn(piece);
+        if (done % (64 * PIECE) === 0) maxRss = Math.max(maxRss, process.memoryUsage().rss);
+    }
+    var elapsed = process.hrtime(start);
+    var seconds = elapsed[0] + elapsed[1] / 1e9;
+    return {
+        speed: TOTAL / seconds / 1e6,
+        rss: (maxRss - rss) / 1e6
+    };
+}
+
+var key = sodium.randombytes_buf(sodium.crypto_secretbox_KEYBYTES);
+var nonce = sodium.randombytes_buf(sodium.crypto_secretbox_NONCEBYTES);
+
+var cases = {
+    'crypto_stream_xor': function() {
+        return function(piece) {
+            sodium.crypto_stream_xor(piece, nonce, key);
+        };
+    },
+    'secretbox_easy per chunk': function() {
+        return function(piece) {
+            for (var i = 0; i < piece.length; i += CHUNK) {
+                sodium.crypto_secretbox_easy(piece.slice(i, i + CHUNK), sodium.randombytes_buf(sodium.crypto_secretbox_NONCEBYTES), key);
+            }
+        };
+    },
+    'SecretboxStream encrypt': function() {
+        var state = new sodium.SecretboxStream('encrypt', key, CHUNK);
+        return function(piece) {
+            state.update(piece);
+        };
+    },
+    // Decrypting needs a valid stream: each piece is encrypted first, so this is both costs
+    'SecretboxStream round trip': function() {
+        var encryptor = new sodium.SecretboxStream('encrypt', key, CHUNK);
+        var decryptor = new sodium.SecretboxStream('decrypt', key);
+        return function(piece) {
+            decryptor.update(encryptor.update(piece));
+        };
+    }
+};
+
+console.log(pad('case', 26) + pad('MB/s', 10) + pad('RSS MB', 10));
+Object.keys(cases).forEach(function(name) {
+    var result = measure(cases[name]());
+    console.log(pad(name, 26) + pad(result.speed.toFixed(0), 10) + pad(result.rss.toFixed(1), 10));
+});
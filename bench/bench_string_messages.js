@@ -0,0 +1,59 @@
+/**
+ * Cost of passing a JS string message: the string itself (encoded natively) versus the
+ * Buffer the JS wrappers used to create for it with toBuffer.
+ *
+ *   node bench/bench_string_messages.js [baseline/build/Release/sodium.node]
+ *
+ * Messages are JSON documents of a few sizes, authenticated with crypto_auth. When the path
+ * of another build of the module is given, its Buffer case is measured too.
+ */
+"use strict";
+
+var path = require('path');
+var crypto = require('crypto');
+
+var current = require('../build/Release/sodium');
+var baseline = process.argv[2] ? require(path.resolve(process.argv[2])) : null;
+
+var SIZES = [100, 1024, 16 * 1024, 256 * 1024];
+var BYTES_PER_RUN = 64 * 1024 * 1024;
+
+function jsonOf(size) {
+    var items = [];
+    var json = '';
+    while (json.length < size) {
+        items.push({ id: items.length, name: 'item ' + items.length, tags: ['a', 'b'], price: 1.5 });
+        json = JSON.stringify(items);
+    }
+    return json.slice(0, size);
+}
+
+// Nanoseconds per call
+function measure(fn, size) {
+    var iterations = Math.max(100, Math.floor(BYTES_PER_RUN / size));
+    for (var i = 0; i < Math.min(iterations, 1000); i++) fn();
+
+    var start = process.hrtime();
+    for (i = 0; i < iterations; i++) fn();
+    var elapsed = process.hrtime(start);
+    return (elapsed[0] * 1e9 + elapsed[1]) / iterations;
+}
+
+function pad(str, width) {
+    str = String(str);
+    while (str.length < width) str = ' ' + str;
+    return str;
+}
+
+console.log(pad('size', 10) + pad('string ns', 14) + pad('Buffer ns', 14) + (baseline ? pad('baseline ns', 14) : ''));
+SIZES.forEach(function(size) {
+    var json = jsonOf(size);
+    var key = crypto.randomBytes(current.crypto_auth_KEYBYTES);
+    var line = pad(size, 10);
+    line += pad(measure(function() { return current.crypto_auth(json, key); }, size).toFixed(0), 14);
+    line += pad(measure(function() { return current.crypto_auth(new Buffer(json, 'utf8'), key); }, size).toFixed(0), 14);
+    if (baseline) {
+        line += pad(measure(function() { return baseline.crypto_auth(new Buffer(json, 'utf8'), key); }, size).toFixed(0), 14);
+    }
+    console.log(line);
+});
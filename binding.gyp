@@ -3,7 +3,7 @@
             {
                   'target_name': 'sodium',
                   'sources': [
-                        'sodium.cc', 'keyring.cc'
+                        'sodium.cc', 'keyring.cc', 'workerpool.cc', 'codecs.cc', 'hashstate.cc', 'secretboxstream.cc', 'classdata.cc'
                   ],
                   'include_dirs': [
                         './libsodium/src/libsodium/include',
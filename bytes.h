@@ -0,0 +1,46 @@
+#ifndef BYTES_H
+#define BYTES_H
+
+#include <node.h>
+#include <node_buffer.h>
+#include <nan.h>
+
+// Data of an ArrayBuffer or a SharedArrayBuffer
+#if V8_MAJOR_VERSION > 7 || (V8_MAJOR_VERSION == 7 && V8_MINOR_VERSION >= 9)
+#define ARRAY_BUFFER_DATA(buffer) ((unsigned char*) (buffer)->GetBackingStore()->Data())
+#else
+#define ARRAY_BUFFER_DATA(buffer) ((unsigned char*) (buffer)->GetContents().Data())
+#endif
+
+/*
+* Gets the bytes of a binary argument: a Buffer, any other ArrayBufferView (typed array, DataView),
+* or a whole ArrayBuffer or SharedArrayBuffer. Nothing is copied: a view selects a range of its
+* buffer with its own byteOffset and byteLength. Returns false if arg is none of these
+*/
+static inline bool get_bytes(v8::Local<v8::Value> arg, unsigned char** data, size_t* size) {
+    if (arg->IsArrayBufferView()) {
+        // Buffers included
+        *data = (unsigned char*) node::Buffer::Data(arg);
+        *size = node::Buffer::Length(arg);
+        return true;
+    }
+    if (arg->IsArrayBuffer()) {
+        v8::Local<v8::ArrayBuffer> buffer = arg.As<v8::ArrayBuffer>();
+        *data = ARRAY_BUFFER_DATA(buffer);
+        *size = buffer->ByteLength();
+        return true;
+    }
+    if (arg->IsSharedArrayBuffer()) {
+        v8::Local<v8::SharedArrayBuffer> buffer = arg.As<v8::SharedArrayBuffer>();
+        *data = ARRAY_BUFFER_DATA(buffer);
+        *size = buffer->ByteLength();
+        return true;
+    }
+    return false;
+}
+
+static inline bool is_bytes(v8::Local<v8::Value> arg) {
+    return arg->IsArrayBufferView() || arg->IsArrayBuffer() || arg->IsSharedArrayBuffer();
+}
+
+#endif
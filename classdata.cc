@@ -0,0 +1,52 @@
+/**
+ * Per-isolate class data
+ */
+#include <vector>
+
+#include "classdata.h"
+#include "workerpool.h"
+
+using namespace v8;
+
+ClassData* ClassData::New() {
+    ClassData* data = new ClassData();
+#ifdef SODIUM_HAS_CLEANUP_HOOKS
+    node::AddEnvironmentCleanupHook(Isolate::GetCurrent(), Delete, data);
+#endif
+    return data;
+}
+
+void ClassData::Delete(void* data) {
+    delete static_cast<ClassData*>(data);
+}
+
+Local<FunctionTemplate> ClassData::NewTemplate(Nan::FunctionCallback construct, const char* name, int internalFieldCount) {
+    Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(construct, Nan::New<External>(this));
+    tpl->SetClassName(Nan::New(name).ToLocalChecked());
+    tpl->InstanceTemplate()->SetInternalFieldCount(internalFieldCount);
+    return tpl;
+}
+
+Local<Function> ClassData::Export(Local<Object> target, Local<FunctionTemplate> tpl) {
+    Local<Function> cons = Nan::GetFunction(tpl).ToLocalChecked();
+    constructor.Reset(cons);
+    Nan::Set(target, cons->GetName(), cons);
+    return cons;
+}
+
+bool ClassData::ForwardPlainCall(NAN_METHOD_ARGS_TYPE info, int maxArgs) {
+    if (info.IsConstructCall()) {
+        return false;
+    }
+    ClassData* data = static_cast<ClassData*>(info.Data().As<External>()->Value());
+    int argc = info.Length() < maxArgs ? info.Length() : maxArgs;
+    std::vector<Local<Value> > argv(argc);
+    for (int i = 0; i < argc; i++) {
+        argv[i] = info[i];
+    }
+    Nan::MaybeLocal<Object> instance = Nan::NewInstance(Nan::New(data->constructor), argc, argc > 0 ? &argv[0] : NULL);
+    if (!instance.IsEmpty()) {
+        info.GetReturnValue().Set(instance.ToLocalChecked());
+    }
+    return true;
+}
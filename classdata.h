@@ -0,0 +1,46 @@
+#ifndef CLASSDATA_H
+#define CLASSDATA_H
+
+#include <node.h>
+#include <nan.h>
+
+/**
+ * Per-isolate data of a class wrapped with node::ObjectWrap: the module is
+ * context-aware and may be loaded in several worker_threads, so its constructor
+ * isn't kept at file scope but passed to New through the constructor template.
+ *
+ *   NAN_MODULE_INIT(Foo::Init) {
+ *       ClassData* data = ClassData::New();
+ *       Local<FunctionTemplate> tpl = data->NewTemplate(New, "Foo", 1);
+ *       Nan::SetPrototypeMethod(tpl, "bar", Bar);
+ *       data->Export(target, tpl);
+ *   }
+ *
+ *   NAN_METHOD(Foo::New) {
+ *       if (ClassData::ForwardPlainCall(info, 2)) return;
+ *       ...
+ *   }
+ */
+class ClassData {
+public:
+    // The data is freed along with the environment (when it has cleanup hooks)
+    static ClassData* New();
+
+    // Template of the class, construct being its New
+    v8::Local<v8::FunctionTemplate> NewTemplate(Nan::FunctionCallback construct, const char* name, int internalFieldCount);
+
+    // Keeps the constructor of tpl, once its prototype methods are set, and exports it to target under its name
+    v8::Local<v8::Function> Export(v8::Local<v8::Object> target, v8::Local<v8::FunctionTemplate> tpl);
+
+    // For New: when invoked as a plain function, constructs an instance with its first maxArgs
+    // arguments instead, returns it to JS and returns true
+    static bool ForwardPlainCall(NAN_METHOD_ARGS_TYPE info, int maxArgs);
+
+private:
+    ClassData() {}
+    static void Delete(void* data);
+
+    Nan::Persistent<v8::Function> constructor;
+};
+
+#endif
@@ -0,0 +1,209 @@
+/**
+ * Constant time hex and base64 codecs
+ */
+#include <string.h>
+
+#include "codecs.h"
+
+/*
+* Comparisons of values in [0, 255], without branches: 0xFF when true, 0 otherwise
+*/
+static inline unsigned int ct_gt(unsigned int x, unsigned int y) {
+    return ((y - x) >> 8) & 0xFF;
+}
+
+static inline unsigned int ct_ge(unsigned int x, unsigned int y) {
+    return ct_gt(y, x) ^ 0xFF;
+}
+
+static inline unsigned int ct_eq(unsigned int x, unsigned int y) {
+    return (((0U - (x ^ y)) >> 8) & 0xFF) ^ 0xFF;
+}
+
+// Hex digit of the nibble n
+static inline char hex_char(unsigned int n) {
+    return (char) (87U + n + (((n - 10U) >> 8) & ~38U));
+}
+
+// Value of the hex digit c. Sets bits of invalid if c isn't one
+static inline unsigned int hex_value(unsigned char c, unsigned int* invalid) {
+    unsigned int num = c ^ 48U;
+    unsigned int num0 = ((num - 10U) >> 8) & 0xFF;
+    unsigned int alpha = ((c & ~32U) - 55U) & 0xFF;
+    unsigned int alpha0 = (((alpha - 10U) ^ (alpha - 16U)) >> 8) & 0xFF;
+    *invalid |= (num0 | alpha0) ^ 0xFF;
+    return (num0 & num) | (alpha0 & alpha);
+}
+
+// Character of the 6 bits value x. c62 and c63 depend on the variant
+static inline char base64_char(unsigned int x, unsigned int c62, unsigned int c63) {
+    return (char) ((ct_gt(26, x) & (x + 'A')) |
+        (ct_ge(x, 26) & ct_gt(52, x) & (x + ('a' - 26))) |
+        (ct_ge(x, 52) & ct_gt(62, x) & (x + ('0' - 52))) |
+        (ct_eq(x, 62) & c62) |
+        (ct_eq(x, 63) & c63));
+}
+
+// 6 bits value of the character c, or 0xFF if it isn't in the alphabet
+static inline unsigned int base64_value(unsigned char c, unsigned int c62, unsigned int c63) {
+    unsigned int x = (ct_ge(c, 'A') & ct_ge('Z', c) & (c - 'A')) |
+        (ct_ge(c, 'a') & ct_ge('z', c) & (c - ('a' - 26))) |
+        (ct_ge(c, '0') & ct_ge('9', c) & (c - ('0' - 52))) |
+        (ct_eq(c, c62) & 62) |
+        (ct_eq(c, c63) & 63);
+    return x | (ct_eq(x, 0) & (ct_eq(c, 'A') ^ 0xFF));
+}
+
+static inline bool base64_padded(Codecs::Base64Variant variant) {
+    return variant == Codecs::BASE64_ORIGINAL || variant == Codecs::BASE64_URLSAFE;
+}
+
+static inline bool base64_urlsafe(Codecs::Base64Variant variant) {
+    return variant == Codecs::BASE64_URLSAFE || variant == Codecs::BASE64_URLSAFE_NO_PADDING;
+}
+
+/*
+* Number of characters of b64 that carry data, without the padding, or (size_t) -1 if the length
+* or the padding isn't valid for the variant. Only looks at the length and the last 2 characters
+*/
+static size_t base64_payload(const char* b64, size_t b64Length, Codecs::Base64Variant variant) {
+    size_t payload = b64Length;
+    if (base64_padded(variant)) {
+        if (b64Length % 4 != 0) return (size_t) -1;
+        if (payload > 0 && b64[payload - 1] == '=') payload--;
+        if (payload > 0 && b64[payload - 1] == '=') payload--;
+    }
+    if (payload % 4 == 1) return (size_t) -1;
+    return payload;
+}
+
+bool Codecs::IsBase64Variant(int variant) {
+    return variant == BASE64_ORIGINAL || variant == BASE64_ORIGINAL_NO_PADDING ||
+        variant == BASE64_URLSAFE || variant == BASE64_URLSAFE_NO_PADDING;
+}
+
+void Codecs::HexEncode(char* hex, const unsigned char* bin, size_t binLength) {
+    for (size_t i = 0; i < binLength; i++) {
+        hex[i * 2] = hex_char(bin[i] >> 4);
+        hex[i * 2 + 1] = hex_char(bin[i] & 0xF);
+    }
+}
+
+bool Codecs::HexDecode(unsigned char* bin, const char* hex, size_t hexLength) {
+    if (hexLength % 2 != 0) return false;
+    const unsigned char* in = (const unsigned char*) hex;
+    unsigned int invalid = 0;
+    for (size_t i = 0; i < hexLength / 2; i++) {
+        unsigned int high = hex_value(in[i * 2], &invalid);
+        unsigned int low = hex_value(in[i * 2 + 1], &invalid);
+        bin[i] = (unsigned char) ((high << 4) | low);
+    }
+    if (invalid != 0) {
+        memset(bin, 0, hexLength / 2);
+        return false;
+    }
+    return true;
+}
+
+size_t Codecs::Base64EncodedLength(size_t binLength, Base64Variant variant) {
+    size_t remainder = binLength % 3;
+    if (base64_padded(variant)) {
+        return (binLength / 3 + (remainder != 0 ? 1 : 0)) * 4;
+    }
+    return binLength / 3 * 4 + (remainder != 0 ? remainder + 1 : 0);
+}
+
+void Codecs::Base64Encode(char* b64, const unsigned char* bin, size_t binLength, Base64Variant variant) {
+    const unsigned int c62 = base64_urlsafe(variant) ? '-' : '+';
+    const unsigned int c63 = base64_urlsafe(variant) ? '_' : '/';
+    const size_t groups = binLength / 3;
+
+    for (size_t i = 0; i < groups; i++) {
+        const unsigned char* in = bin + i * 3;
+        char* out = b64 + i * 4;
+        out[0] = base64_char(in[0] >> 2, c62, c63);
+        out[1] = base64_char(((in[0] & 3) << 4) | (in[1] >> 4), c62, c63);
+        out[2] = base64_char(((in[1] & 15) << 2) | (in[2] >> 6), c62, c63);
+        out[3] = base64_char(in[2] & 63, c62, c63);
+    }
+
+    const unsigned char* in = bin + groups * 3;
+    char* out = b64 + groups * 4;
+    switch (binLength % 3) {
+        case 1:
+            out[0] = base64_char(in[0] >> 2, c62, c63);
+            out[1] = base64_char((in[0] & 3) << 4, c62, c63);
+            if (base64_padded(variant)) {
+                out[2] = '=';
+                out[3] = '=';
+            }
+            break;
+        case 2:
+            out[0] = base64_char(in[0] >> 2, c62, c63);
+            out[1] = base64_char(((in[0] & 3) << 4) | (in[1] >> 4), c62, c63);
+            out[2] = base64_char((in[1] & 15) << 2, c62, c63);
+            if (base64_padded(variant)) {
+                out[3] = '=';
+            }
+            break;
+    }
+}
+
+size_t Codecs::Base64DecodedLength(const char* b64, size_t b64Length, Base64Variant variant) {
+    size_t payload = base64_payload(b64, b64Length, variant);
+    if (payload == (size_t) -1) return payload;
+    return payload / 4 * 3 + (payload % 4 != 0 ? payload % 4 - 1 : 0);
+}
+
+bool Codecs::Base64Decode(unsigned char* bin, const char* b64, size_t b64Length, Base64Variant variant) {
+    size_t payload = base64_payload(b64, b64Length, variant);
+    if (payload == (size_t) -1) return false;
+
+    const unsigned int c62 = base64_urlsafe(variant) ? '-' : '+';
+    const unsigned int c63 = base64_urlsafe(variant) ? '_' : '/';
+    const unsigned char* chars = (const unsigned char*) b64;
+    const size_t groups = payload / 4;
+    // Invalid characters decode to 0xFF: any of the 2 high bits set means an error
+    unsigned int invalid = 0;
+
+    for (size_t i = 0; i < groups; i++) {
+        const unsigned char* in = chars + i * 4;
+        unsigned char* out = bin + i * 3;
+        unsigned int v0 = base64_value(in[0], c62, c63);
+        unsigned int v1 = base64_value(in[1], c62, c63);
+        unsigned int v2 = base64_value(in[2], c62, c63);
+        unsigned int v3 = base64_value(in[3], c62, c63);
+        invalid |= v0 | v1 | v2 | v3;
+        out[0] = (unsigned char) ((v0 << 2) | (v1 >> 4));
+        out[1] = (unsigned char) ((v1 << 4) | (v2 >> 2));
+        out[2] = (unsigned char) ((v2 << 6) | v3);
+    }
+    invalid &= 0xC0;
+
+    const unsigned char* in = chars + groups * 4;
+    unsigned char* out = bin + groups * 3;
+    unsigned int v0, v1, v2;
+    switch (payload % 4) {
+        case 2:
+            v0 = base64_value(in[0], c62, c63);
+            v1 = base64_value(in[1], c62, c63);
+            // The bits of the last character that don't make a byte must be zeros
+            invalid |= ((v0 | v1) & 0xC0) | (v1 & 15);
+            out[0] = (unsigned char) ((v0 << 2) | (v1 >> 4));
+            break;
+        case 3:
+            v0 = base64_value(in[0], c62, c63);
+            v1 = base64_value(in[1], c62, c63);
+            v2 = base64_value(in[2], c62, c63);
+            invalid |= ((v0 | v1 | v2) & 0xC0) | (v2 & 3);
+            out[0] = (unsigned char) ((v0 << 2) | (v1 >> 4));
+            out[1] = (unsigned char) ((v1 << 4) | (v2 >> 2));
+            break;
+    }
+
+    if (invalid != 0) {
+        memset(bin, 0, Base64DecodedLength(b64, b64Length, variant));
+        return false;
+    }
+    return true;
+}
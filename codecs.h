@@ -0,0 +1,49 @@
+#ifndef CODECS_H
+#define CODECS_H
+
+#include <stddef.h>
+
+/**
+ * Hex and base64 codecs for secret data (keys, nonces, tokens).
+ *
+ * Constant time: no branch and no table lookup depends on the bytes being
+ * encoded or decoded, only on their length. The loops handle one byte or one
+ * 3 bytes group at a time without branches, so that the compiler can vectorize them.
+ *
+ * The variants have the values of the sodium_base64_VARIANT_* constants of later libsodium versions
+ */
+class Codecs {
+public:
+    enum Base64Variant {
+        BASE64_ORIGINAL = 1,
+        BASE64_ORIGINAL_NO_PADDING = 3,
+        BASE64_URLSAFE = 5,
+        BASE64_URLSAFE_NO_PADDING = 7
+    };
+
+    static bool IsBase64Variant(int variant);
+
+    // Writes 2 * binLength lowercase hex characters to hex
+    static void HexEncode(char* hex, const unsigned char* bin, size_t binLength);
+
+    // Decodes hexLength characters (an even number) to hexLength / 2 bytes.
+    // Returns false if any of them isn't a hex digit; bin is zeroed in that case
+    static bool HexDecode(unsigned char* bin, const char* hex, size_t hexLength);
+
+    // Number of characters Base64Encode writes for binLength bytes
+    static size_t Base64EncodedLength(size_t binLength, Base64Variant variant);
+
+    // Writes Base64EncodedLength(binLength, variant) characters to b64
+    static void Base64Encode(char* b64, const unsigned char* bin, size_t binLength, Base64Variant variant);
+
+    // Number of bytes b64Length characters decode to, or (size_t) -1 if that length
+    // (or the padding, which is not secret) isn't valid for the variant
+    static size_t Base64DecodedLength(const char* b64, size_t b64Length, Base64Variant variant);
+
+    // Decodes b64Length characters to Base64DecodedLength(b64, b64Length, variant) bytes.
+    // Returns false if a character isn't in the alphabet of the variant or the unused bits
+    // of the last character aren't zeros; bin is zeroed in that case
+    static bool Base64Decode(unsigned char* bin, const char* b64, size_t b64Length, Base64Variant variant);
+};
+
+#endif
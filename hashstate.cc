@@ -0,0 +1,328 @@
+/**
+ * Incremental hashing and authentication states
+ */
+#include <string.h>
+
+#include <node_buffer.h>
+
+#include "hashstate.h"
+#include "bytes.h"
+#include "classdata.h"
+
+using namespace v8;
+using namespace node;
+
+HashState::HashState(Algorithm algorithm) : algorithm(algorithm), finalized(false) {
+    if (algorithm == SHA256) {
+        crypto_hash_sha256_init(&state.sha256);
+    } else {
+        crypto_hash_sha512_init(&state.sha512);
+    }
+}
+
+HashState::~HashState() {
+    sodium_memzero(&state, sizeof state);
+}
+
+NAN_MODULE_INIT(HashState::Init) {
+    ClassData* data = ClassData::New();
+    Local<FunctionTemplate> tpl = data->NewTemplate(New, "HashState", 1);
+
+    Nan::SetPrototypeMethod(tpl, "update", Update);
+    Nan::SetPrototypeMethod(tpl, "final", Final);
+
+    data->Export(target, tpl);
+}
+
+/*
+* new HashState([algorithm])
+* algorithm: 'sha512' (default) or 'sha256'
+*/
+NAN_METHOD(HashState::New) {
+    if (ClassData::ForwardPlainCall(info, 1)) {
+        return;
+    }
+
+    Algorithm algorithm = SHA512;
+    if (info.Length() > 0 && !info[0]->IsUndefined()) {
+        Nan::Utf8String name(info[0]);
+        if (*name != NULL && strcmp(*name, "sha256") == 0) {
+            algorithm = SHA256;
+        } else if (*name == NULL || strcmp(*name, "sha512") != 0) {
+            return Nan::ThrowTypeError("algorithm must be 'sha256' or 'sha512'");
+        }
+    }
+
+    HashState* hash = new HashState(algorithm);
+    hash->Wrap(info.This());
+    info.GetReturnValue().Set(info.This());
+}
+
+/*
+* update(message)
+* Returns the state, to chain calls
+*/
+NAN_METHOD(HashState::Update) {
+    HashState* hash = ObjectWrap::Unwrap<HashState>(info.This());
+    if (hash->finalized) {
+        return Nan::ThrowError("final() has already been called on this hash state");
+    }
+    unsigned char* message;
+    size_t messageLength;
+    if (info.Length() < 1 || !get_bytes(info[0], &message, &messageLength)) {
+        return Nan::ThrowTypeError("argument message must be a buffer, a typed array or an ArrayBuffer");
+    }
+    if (hash->algorithm == SHA256) {
+        crypto_hash_sha256_update(&hash->state.sha256, message, messageLength);
+    } else {
+        crypto_hash_sha512_update(&hash->state.sha512, message, messageLength);
+    }
+    info.GetReturnValue().Set(info.This());
+}
+
+/*
+* final()
+* Returns the digest, and wipes the state
+*/
+NAN_METHOD(HashState::Final) {
+    HashState* hash = ObjectWrap::Unwrap<HashState>(info.This());
+    if (hash->finalized) {
+        return Nan::ThrowError("final() has already been called on this hash state");
+    }
+
+    const size_t digestLength = hash->algorithm == SHA256 ? crypto_hash_sha256_BYTES : crypto_hash_sha512_BYTES;
+    Local<Object> digest = Nan::NewBuffer(digestLength).ToLocalChecked();
+    unsigned char* digestPtr = (unsigned char*) Buffer::Data(digest);
+    if (hash->algorithm == SHA256) {
+        crypto_hash_sha256_final(&hash->state.sha256, digestPtr);
+    } else {
+        crypto_hash_sha512_final(&hash->state.sha512, digestPtr);
+    }
+
+    sodium_memzero(&hash->state, sizeof hash->state);
+    hash->finalized = true;
+    info.GetReturnValue().Set(digest);
+}
+
+AuthState::AuthState(Algorithm algorithm, const unsigned char* key, size_t keyLength) : algorithm(algorithm), finalized(false) {
+    if (algorithm == HMACSHA256) {
+        crypto_auth_hmacsha256_init(&state.hmacsha256, key, keyLength);
+    } else {
+        crypto_auth_hmacsha512256_init(&state.hmacsha512256, key, keyLength);
+    }
+}
+
+AuthState::~AuthState() {
+    sodium_memzero(&state, sizeof state);
+}
+
+void AuthState::Finish(unsigned char* tag) {
+    if (algorithm == HMACSHA256) {
+        crypto_auth_hmacsha256_final(&state.hmacsha256, tag);
+    } else {
+        crypto_auth_hmacsha512256_final(&state.hmacsha512256, tag);
+    }
+    sodium_memzero(&state, sizeof state);
+    finalized = true;
+}
+
+NAN_MODULE_INIT(AuthState::Init) {
+    ClassData* data = ClassData::New();
+    Local<FunctionTemplate> tpl = data->NewTemplate(New, "AuthState", 1);
+
+    Nan::SetPrototypeMethod(tpl, "update", Update);
+    Nan::SetPrototypeMethod(tpl, "final", Final);
+    Nan::SetPrototypeMethod(tpl, "verify", Verify);
+
+    data->Export(target, tpl);
+}
+
+/*
+* new AuthState(key [, algorithm])
+* algorithm: 'hmacsha512256' (default) or 'hmacsha256'
+*/
+NAN_METHOD(AuthState::New) {
+    if (ClassData::ForwardPlainCall(info, 2)) {
+        return;
+    }
+
+    Algorithm algorithm = HMACSHA512256;
+    if (info.Length() > 1 && !info[1]->IsUndefined()) {
+        Nan::Utf8String name(info[1]);
+        if (*name != NULL && strcmp(*name, "hmacsha256") == 0) {
+            algorithm = HMACSHA256;
+        } else if (*name == NULL || strcmp(*name, "hmacsha512256") != 0) {
+            return Nan::ThrowTypeError("algorithm must be 'hmacsha512256' or 'hmacsha256'");
+        }
+    }
+
+    const size_t keyBytes = algorithm == HMACSHA256 ? crypto_auth_hmacsha256_KEYBYTES : crypto_auth_hmacsha512256_KEYBYTES;
+    unsigned char* key;
+    size_t keyLength;
+    if (info.Length() < 1 || !get_bytes(info[0], &key, &keyLength) || keyLength != keyBytes) {
+        return Nan::ThrowTypeError("argument key must be a 32 bytes buffer");
+    }
+
+    AuthState* auth = new AuthState(algorithm, key, keyBytes);
+    auth->Wrap(info.This());
+    info.GetReturnValue().Set(info.This());
+}
+
+/*
+* update(message)
+* Returns the state, to chain calls
+*/
+NAN_METHOD(AuthState::Update) {
+    AuthState* auth = ObjectWrap::Unwrap<AuthState>(info.This());
+    if (auth->finalized) {
+        return Nan::ThrowError("final() or verify() has already been called on this auth state");
+    }
+    unsigned char* message;
+    size_t messageLength;
+    if (info.Length() < 1 || !get_bytes(info[0], &message, &messageLength)) {
+        return Nan::ThrowTypeError("argument message must be a buffer, a typed array or an ArrayBuffer");
+    }
+    if (auth->algorithm == HMACSHA256) {
+        crypto_auth_hmacsha256_update(&auth->state.hmacsha256, message, messageLength);
+    } else {
+        crypto_auth_hmacsha512256_update(&auth->state.hmacsha512256, message, messageLength);
+    }
+    info.GetReturnValue().Set(info.This());
+}
+
+/*
+* final()
+* Returns the tag, and wipes the state
+*/
+NAN_METHOD(AuthState::Final) {
+    AuthState* auth = ObjectWrap::Unwrap<AuthState>(info.This());
+    if (auth->finalized) {
+        return Nan::ThrowError("final() or verify() has already been called on this auth state");
+    }
+
+    Local<Object> tag = Nan::NewBuffer(32).ToLocalChecked();
+    auth->Finish((unsigned char*) Buffer::Data(tag));
+    info.GetReturnValue().Set(tag);
+}
+
+/*
+* verify(tag)
+* Returns true if tag authenticates the data passed to update(), in constant time. Wipes the state
+*/
+NAN_METHOD(AuthState::Verify) {
+    AuthState* auth = ObjectWrap::Unwrap<AuthState>(info.This());
+    if (auth->finalized) {
+        return Nan::ThrowError("final() or verify() has already been called on this auth state");
+    }
+    unsigned char* tag;
+    size_t tagLength;
+    if (info.Length() < 1 || !get_bytes(info[0], &tag, &tagLength) || tagLength != 32) {
+        return Nan::ThrowTypeError("argument tag must be a 32 bytes buffer");
+    }
+
+    unsigned char expected[32];
+    auth->Finish(expected);
+    bool valid = crypto_verify_32(expected, tag) == 0;
+    sodium_memzero(expected, sizeof expected);
+    info.GetReturnValue().Set(Nan::New<Boolean>(valid));
+}
+
+OnetimeAuthState::OnetimeAuthState(const unsigned char* key) : finalized(false) {
+    crypto_onetimeauth_poly1305_init(&state, key);
+}
+
+OnetimeAuthState::~OnetimeAuthState() {
+    sodium_memzero(&state, sizeof state);
+}
+
+void OnetimeAuthState::Finish(unsigned char* tag) {
+    crypto_onetimeauth_poly1305_final(&state, tag);
+    sodium_memzero(&state, sizeof state);
+    finalized = true;
+}
+
+NAN_MODULE_INIT(OnetimeAuthState::Init) {
+    ClassData* data = ClassData::New();
+    Local<FunctionTemplate> tpl = data->NewTemplate(New, "OnetimeAuthState", 1);
+
+    Nan::SetPrototypeMethod(tpl, "update", Update);
+    Nan::SetPrototypeMethod(tpl, "final", Final);
+    Nan::SetPrototypeMethod(tpl, "verify", Verify);
+
+    data->Export(target, tpl);
+}
+
+/*
+* new OnetimeAuthState(key)
+*/
+NAN_METHOD(OnetimeAuthState::New) {
+    if (ClassData::ForwardPlainCall(info, 1)) {
+        return;
+    }
+
+    unsigned char* key;
+    size_t keyLength;
+    if (info.Length() < 1 || !get_bytes(info[0], &key, &keyLength) || keyLength != crypto_onetimeauth_KEYBYTES) {
+        return Nan::ThrowTypeError("argument key must be a crypto_onetimeauth_KEYBYTES bytes buffer");
+    }
+
+    OnetimeAuthState* auth = new OnetimeAuthState(key);
+    auth->Wrap(info.This());
+    info.GetReturnValue().Set(info.This());
+}
+
+/*
+* update(message)
+* Returns the state, to chain calls
+*/
+NAN_METHOD(OnetimeAuthState::Update) {
+    OnetimeAuthState* auth = ObjectWrap::Unwrap<OnetimeAuthState>(info.This());
+    if (auth->finalized) {
+        return Nan::ThrowError("final() or verify() has already been called on this onetimeauth state");
+    }
+    unsigned char* message;
+    size_t messageLength;
+    if (info.Length() < 1 || !get_bytes(info[0], &message, &messageLength)) {
+        return Nan::ThrowTypeError("argument message must be a buffer, a typed array or an ArrayBuffer");
+    }
+
+    crypto_onetimeauth_poly1305_update(&auth->state, message, messageLength);
+    info.GetReturnValue().Set(info.This());
+}
+
+/*
+* final()
+* Returns the tag, and wipes the state
+*/
+NAN_METHOD(OnetimeAuthState::Final) {
+    OnetimeAuthState* auth = ObjectWrap::Unwrap<OnetimeAuthState>(info.This());
+    if (auth->finalized) {
+        return Nan::ThrowError("final() or verify() has already been called on this onetimeauth state");
+    }
+
+    Local<Object> tag = Nan::NewBuffer(crypto_onetimeauth_BYTES).ToLocalChecked();
+    auth->Finish((unsigned char*) Buffer::Data(tag));
+    info.GetReturnValue().Set(tag);
+}
+
+/*
+* verify(tag)
+* Returns true if tag authenticates the data passed to update(), in constant time. Wipes the state
+*/
+NAN_METHOD(OnetimeAuthState::Verify) {
+    OnetimeAuthState* auth = ObjectWrap::Unwrap<OnetimeAuthState>(info.This());
+    if (auth->finalized) {
+        return Nan::ThrowError("final() or verify() has already been called on this onetimeauth state");
+    }
+    unsigned char* tag;
+    size_t tagLength;
+    if (info.Length() < 1 || !get_bytes(info[0], &tag, &tagLength) || tagLength != crypto_onetimeauth_BYTES) {
+        return Nan::ThrowTypeError("argument tag must be a crypto_onetimeauth_BYTES bytes buffer");
+    }
+
+    unsigned char expected[crypto_onetimeauth_BYTES];
+    auth->Finish(expected);
+    bool valid = crypto_verify_16(expected, tag) == 0;
+    sodium_memzero(expected, sizeof expected);
+    info.GetReturnValue().Set(Nan::New<Boolean>(valid));
+}
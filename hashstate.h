@@ -0,0 +1,116 @@
+#ifndef HASHSTATE_H
+#define HASHSTATE_H
+
+#include <node.h>
+#include <nan.h>
+
+#include "sodium.h"
+
+/**
+ * Incremental SHA-256/SHA-512 hashing, so that large inputs can be hashed as
+ * they arrive, in constant memory:
+ *
+ *   var state = new HashState('sha256');
+ *   state.update(chunk1).update(chunk2);
+ *   var digest = state.final();
+ *
+ * The algorithm is 'sha512' by default, as crypto_hash. The state is wiped by
+ * final(); update() and final() throw when called after it.
+ */
+class HashState : public node::ObjectWrap {
+public:
+    static NAN_MODULE_INIT(Init);
+
+private:
+    enum Algorithm {
+        SHA256,
+        SHA512
+    };
+
+    explicit HashState(Algorithm algorithm);
+    ~HashState();
+
+    Algorithm algorithm;
+    bool finalized;
+    union {
+        crypto_hash_sha256_state sha256;
+        crypto_hash_sha512_state sha512;
+    } state;
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Update);
+    static NAN_METHOD(Final);
+};
+
+/**
+ * Incremental HMAC, so that long-lived streams and large objects can be
+ * authenticated in constant memory:
+ *
+ *   var state = new AuthState(key);
+ *   state.update(chunk1).update(chunk2);
+ *   var tag = state.final();       // or state.verify(tag)
+ *
+ * The algorithm is 'hmacsha512256' by default, as crypto_auth, or 'hmacsha256'.
+ * The key must be 32 bytes long (the KEYBYTES of both), as for crypto_auth.
+ * Both final() and verify() wipe the state.
+ */
+class AuthState : public node::ObjectWrap {
+public:
+    static NAN_MODULE_INIT(Init);
+
+private:
+    enum Algorithm {
+        HMACSHA512256,
+        HMACSHA256
+    };
+
+    AuthState(Algorithm algorithm, const unsigned char* key, size_t keyLength);
+    ~AuthState();
+
+    // Computes the 32 bytes tag into tag, and wipes the state
+    void Finish(unsigned char* tag);
+
+    Algorithm algorithm;
+    bool finalized;
+    union {
+        crypto_auth_hmacsha512256_state hmacsha512256;
+        crypto_auth_hmacsha256_state hmacsha256;
+    } state;
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Update);
+    static NAN_METHOD(Final);
+    static NAN_METHOD(Verify);
+};
+
+/**
+ * Incremental Poly1305 one-time authenticator, for records arriving in pieces:
+ *
+ *   var state = new OnetimeAuthState(key);
+ *   state.update(piece1).update(piece2);
+ *   var tag = state.final();       // or state.verify(tag)
+ *
+ * Same tags as crypto_onetimeauth. The key must never be used for another message.
+ * Both final() and verify() wipe the state.
+ */
+class OnetimeAuthState : public node::ObjectWrap {
+public:
+    static NAN_MODULE_INIT(Init);
+
+private:
+    explicit OnetimeAuthState(const unsigned char* key);
+    ~OnetimeAuthState();
+
+    // Computes the tag (crypto_onetimeauth_BYTES long) into tag, and wipes the state
+    void Finish(unsigned char* tag);
+
+    bool finalized;
+    crypto_onetimeauth_poly1305_state state;
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Update);
+    static NAN_METHOD(Final);
+    static NAN_METHOD(Verify);
+};
+
+#endif
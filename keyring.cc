@@ -15,6 +15,8 @@
 #include <node.h>
 #include <node_buffer.h>
 #include "keyring.h"
+#include "classdata.h"
+#include "workerpool.h"
 
 //Including libsodium export headers
 #include "sodium.h"
@@ -63,7 +65,6 @@ using namespace std;
 	Nan::SetPrototypeMethod(tpl, name, function);
 	//tpl->PrototypeTemplate()->Set(String::NewSymbol(name), FunctionTemplate::New(function)->GetFunction());
 
-//Persistent<Function> KeyRing::constructor;
 
 KeyRing::KeyRing(string const& filename, unsigned char* password, size_t passwordSize) : _filename(filename), _privateKey(0), _publicKey(0), _altPrivateKey(0), _altPublicKey(0){
 	_keyLock = false;
@@ -75,11 +76,13 @@ KeyRing::KeyRing(string const& filename, unsigned char* password, size_t passwor
 		loadKeyPair(filename, &_keyType, _privateKey, _publicKey, password, passwordSize);
 		_filename = filename;
 	}
-	globalObj = Nan::GetCurrentContext()->Global();
-	bufferConstructor = Local<Function>::Cast(globalObj->Get(Nan::New<String>("Buffer").ToLocalChecked()));
 }
 
 KeyRing::~KeyRing(){
+	resetKeys();
+}
+
+void KeyRing::resetKeys(){
 	if (_privateKey != 0){
 		if (_keyType == "ed25519") sodium_memzero(_privateKey, crypto_sign_SECRETKEYBYTES);
 		else sodium_memzero(_privateKey, crypto_box_SECRETKEYBYTES);
@@ -103,16 +106,153 @@ KeyRing::~KeyRing(){
 		delete _altPublicKey;
 		_altPublicKey = 0;
 	}
+	_keyType = "";
+	_filename = "";
 }
 
+/*
+* Does the file I/O and the scrypt derivation of load, save and createKeyPair on a worker thread.
+* The worker holds its own copy of the keys; they are only swapped into the KeyRing
+* once the work is done, back on the main thread.
+*/
+class KeyRingWorker : public Nan::AsyncWorker {
+public:
+	enum Operation { LOAD, SAVE };
+
+	KeyRingWorker(Nan::Callback* callback, Local<Object> keyRingObj, Operation operation, string const& filename, const unsigned char* password, size_t passwordSize)
+		: Nan::AsyncWorker(callback), _operation(operation), _filename(filename), _passwordSize(passwordSize),
+		_opsLimit(16384), _r(8), _p(1), _maxOpsLimit(4194304), _replyWithKeyInfo(false){
+		SaveToPersistent("keyring", keyRingObj);
+		_instance = ObjectWrap::Unwrap<KeyRing>(keyRingObj);
+		_password = new unsigned char[passwordSize > 0 ? passwordSize : 1];
+		if (passwordSize > 0) memcpy(_password, password, passwordSize);
+		//Large enough for both key types
+		memset(_privateKey, 0, sizeof(_privateKey));
+		memset(_publicKey, 0, sizeof(_publicKey));
+		memset(_altPrivateKey, 0, sizeof(_altPrivateKey));
+		memset(_altPublicKey, 0, sizeof(_altPublicKey));
+	}
+
+	~KeyRingWorker(){
+		sodium_memzero(_password, _passwordSize);
+		delete[] _password;
+		sodium_memzero(_privateKey, sizeof(_privateKey));
+		sodium_memzero(_altPrivateKey, sizeof(_altPrivateKey));
+	}
+
+	void SetScryptParams(unsigned long opsLimit, unsigned int r, unsigned int p){
+		_opsLimit = opsLimit;
+		_r = r;
+		_p = p;
+	}
+
+	void SetMaxOpsLimit(unsigned long maxOpsLimit){
+		_maxOpsLimit = maxOpsLimit;
+	}
+
+	//Key pair to be saved. Copied, so that the instance can be cleared meanwhile
+	void SetKeyPair(string const& keyType, const unsigned char* privateKey, const unsigned char* publicKey){
+		_keyType = keyType;
+		if (keyType == "ed25519"){
+			memcpy(_privateKey, privateKey, crypto_sign_SECRETKEYBYTES);
+			memcpy(_publicKey, publicKey, crypto_sign_PUBLICKEYBYTES);
+		} else {
+			memcpy(_privateKey, privateKey, crypto_box_SECRETKEYBYTES);
+			memcpy(_publicKey, publicKey, crypto_box_PUBLICKEYBYTES);
+		}
+	}
+
+	//Pass the PublicKeyInfo object to the callback once saved (createKeyPair)
+	void ReplyWithKeyInfo(){
+		_replyWithKeyInfo = true;
+	}
+
+	void Execute(){
+		try {
+			if (_operation == LOAD){
+				loadKeyPair(_filename, &_keyType, _privateKey, _publicKey, _passwordSize > 0 ? _password : 0, _passwordSize, _maxOpsLimit);
+				if (_keyType == "ed25519"){
+					deriveAltKeys(_publicKey, _privateKey, _altPublicKey, _altPrivateKey);
+				}
+			} else if (_filename != ""){
+				if (_passwordSize > 0) saveKeyPair(_filename, _keyType, _privateKey, _publicKey, _password, _passwordSize, _opsLimit, _r, _p);
+				else saveKeyPair(_filename, _keyType, _privateKey, _publicKey);
+			}
+		} catch (runtime_error* e){
+			SetErrorMessage(e->what());
+			delete e;
+		}
+	}
+
+	void HandleOKCallback(){
+		Nan::HandleScope scope;
+		KeyRing* instance = _instance;
+
+		if (_operation == LOAD){
+			instance->resetKeys();
+			if (_keyType == "ed25519"){
+				instance->_privateKey = new unsigned char[crypto_sign_SECRETKEYBYTES];
+				instance->_publicKey = new unsigned char[crypto_sign_PUBLICKEYBYTES];
+				memcpy(instance->_privateKey, _privateKey, crypto_sign_SECRETKEYBYTES);
+				memcpy(instance->_publicKey, _publicKey, crypto_sign_PUBLICKEYBYTES);
+
+				instance->_altPublicKey = new unsigned char[crypto_box_PUBLICKEYBYTES];
+				instance->_altPrivateKey = new unsigned char[crypto_box_SECRETKEYBYTES];
+				memcpy(instance->_altPrivateKey, _altPrivateKey, crypto_box_SECRETKEYBYTES);
+				memcpy(instance->_altPublicKey, _altPublicKey, crypto_box_PUBLICKEYBYTES);
+			} else {
+				instance->_privateKey = new unsigned char[crypto_box_SECRETKEYBYTES];
+				instance->_publicKey = new unsigned char[crypto_box_PUBLICKEYBYTES];
+				memcpy(instance->_privateKey, _privateKey, crypto_box_SECRETKEYBYTES);
+				memcpy(instance->_publicKey, _publicKey, crypto_box_PUBLICKEYBYTES);
+			}
+			instance->_keyType = _keyType;
+			instance->_filename = _filename;
+		} else if (_replyWithKeyInfo && _filename != ""){
+			instance->_filename = _filename;
+		}
+
+		if (_operation == LOAD || _replyWithKeyInfo){
+			if (instance->_keyType == ""){
+				//The key pair has been cleared while the worker was running
+				Local<Value> argv[] = { Nan::Error("The key ring has been cleared") };
+				callback->Call(1, argv);
+				return;
+			}
+			Local<Value> argv[] = { instance->PPublicKeyInfo() };
+			callback->Call(1, argv);
+		} else {
+			callback->Call(0, 0);
+		}
+	}
+
+private:
+	Operation _operation;
+	KeyRing* _instance;
+	string _filename;
+	unsigned char* _password;
+	size_t _passwordSize;
+	unsigned long _opsLimit;
+	unsigned int _r;
+	unsigned int _p;
+	unsigned long _maxOpsLimit;
+	bool _replyWithKeyInfo;
+	string _keyType;
+	unsigned char _privateKey[crypto_sign_SECRETKEYBYTES];
+	unsigned char _publicKey[crypto_sign_PUBLICKEYBYTES];
+	unsigned char _altPrivateKey[crypto_box_SECRETKEYBYTES];
+	unsigned char _altPublicKey[crypto_box_PUBLICKEYBYTES];
+};
+
 NAN_MODULE_INIT(KeyRing::Init){
 	//Prepare constructor template
-	Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(KeyRing::New);
-	tpl->SetClassName(Nan::New("KeyRing").ToLocalChecked());
-	tpl->InstanceTemplate()->SetInternalFieldCount(4);
+	ClassData* data = ClassData::New();
+	Local<FunctionTemplate> tpl = data->NewTemplate(KeyRing::New, "KeyRing", 4);
 	//Prototype
 	BIND_METHOD("encrypt", Encrypt);
 	BIND_METHOD("decrypt", Decrypt);
+	BIND_METHOD("encryptEasy", EncryptEasy);
+	BIND_METHOD("decryptEasy", DecryptEasy);
 	BIND_METHOD("sign", Sign);
 	BIND_METHOD("agree", Agree);
 	BIND_METHOD("publicKeyInfo", PublicKeyInfo);
@@ -124,8 +264,7 @@ NAN_MODULE_INIT(KeyRing::Init){
 	BIND_METHOD("getKeyBuffer", GetKeyBuffer);
 	BIND_METHOD("lockKeyBuffer", LockKeyBuffer);
 
-	constructor().Reset(Nan::GetFunction(tpl).ToLocalChecked());
-	Nan::Set(target, Nan::New("KeyRing").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+	data->Export(target, tpl);
 
 	//cout << "KeyRing::Init" << endl;
 }
@@ -166,85 +305,69 @@ NAN_METHOD(KeyRing::New){
 			info.GetReturnValue().Set(Nan::Undefined());
 			return;
 		}
-		Local<Function> cons = Nan::New(constructor());
-
-		if (info.Length() > 0){
-			unsigned int infoLength = info.Length();
-			Local<Value> * argvPtr = NULL;
-			if (infoLength == 1){
-				Local<Value> argv[1] = {info[0]};
-				argvPtr = argv;
-			} else if (infoLength == 2){
-				Local<Value> argv[2] = {info[0], info[1]};
-				argvPtr = argv;
-			}
-			info.GetReturnValue().Set(Nan::NewInstance(cons, infoLength, argvPtr).ToLocalChecked());
-		} else {
-			Local<Value> argv[0] = {};
-			info.GetReturnValue().Set(Nan::NewInstance(cons, 0, argv).ToLocalChecked());
-		}
-
-
-		/*if (info.Length() == 1){
-			Local<Value> argv[1] = { info[0] };
-			return scope.Close(constructor->NewInstance(1, argv));
-		} else {
-			return scope.Close(constructor->NewInstance());
-		}*/
+		ClassData::ForwardPlainCall(info, 2);
 	}
 }
 
-/**
-* Make a Curve25519 key exchange for a given public key, then encrypt the message (crypto_box)
-* Parameters Buffer message, Buffer publicKey, Buffer nonce, callback (optional)
-* Returns Buffer
+/*
+* Checks the publicKey (info[1]) and nonce (info[2]) arguments of the encryption methods. Throws and returns false if invalid
 */
-NAN_METHOD(KeyRing::Encrypt){
-	PREPARE_FUNC_VARS();
-	MANDATORY_ARGS(3, "Mandatory args : message, counterpartPubKey, nonce\nOptional args: callback");
-	//CHECK_KEYPAIR("curve25519");
-
-	Local<Object> messageVal = info[0]->ToObject();
-	Local<Object> publicKeyVal = info[1]->ToObject();
-	Local<Object> nonceVal = info[2]->ToObject();
-
-	const unsigned char* message = (unsigned char*) Buffer::Data(messageVal);
-	const size_t messageLength = Buffer::Length(messageVal);
-
-	const unsigned char* publicKey = (unsigned char*) Buffer::Data(publicKeyVal);
-	const size_t publicKeyLength = Buffer::Length(publicKeyVal);
-	if (publicKeyLength != crypto_box_PUBLICKEYBYTES){
+static bool checkBoxArgs(const Nan::FunctionCallbackInfo<v8::Value>& info){
+	for (int i = 0; i < 3; i++){
+		if (!Buffer::HasInstance(info[i])){
+			Nan::ThrowTypeError("message/cipher, counterpartPubKey and nonce must be buffers");
+			return false;
+		}
+	}
+	if (Buffer::Length(info[1]) != crypto_box_PUBLICKEYBYTES){
 		stringstream errMsg;
 		errMsg << "Public key must be " << crypto_box_PUBLICKEYBYTES << " bytes long";
 		Nan::ThrowTypeError(errMsg.str().c_str());
-		info.GetReturnValue().Set(Nan::Undefined());
-		return;
+		return false;
 	}
-	const unsigned char* nonce = (unsigned char*) Buffer::Data(nonceVal);
-	const size_t nonceLength = Buffer::Length(nonceVal);
-	if (nonceLength != crypto_box_NONCEBYTES){
+	if (Buffer::Length(info[2]) != crypto_box_NONCEBYTES){
 		stringstream errMsg;
 		errMsg << "The nonce must be " << crypto_box_NONCEBYTES << " bytes long";
 		Nan::ThrowTypeError(errMsg.str().c_str());
-		info.GetReturnValue().Set(Nan::Undefined());
-		return;
+		return false;
 	}
+	return true;
+}
 
-	unsigned char* paddedMessage = new unsigned char[messageLength + crypto_box_ZEROBYTES];
-	for (unsigned int i = 0; i < crypto_box_ZEROBYTES; i++){
-		paddedMessage[i] = 0;
+/*
+* Returns result, or passes it to the callback in info[3] if there is one
+*/
+static void replyWith(const Nan::FunctionCallbackInfo<v8::Value>& info, Local<Value> result){
+	if (!(info.Length() > 3 && info[3]->IsFunction())){
+		info.GetReturnValue().Set(result);
+	} else {
+		Local<Function> callback = Local<Function>::Cast(info[3]);
+		const int argc = 1;
+		Local<Value> argv[argc] = { result };
+		callback->Call(Nan::GetCurrentContext()->Global(), argc, argv);
+		info.GetReturnValue().Set(Nan::Undefined());
 	}
-	memcpy((void*) (paddedMessage + crypto_box_ZEROBYTES), (void*) message, messageLength);
+}
 
-	Local<Object> cipherBuf = Nan::NewBuffer(messageLength + crypto_box_ZEROBYTES).ToLocalChecked();
-	unsigned char* cipher = (unsigned char*)Buffer::Data(cipherBuf);
+/*
+* Shared by encrypt and encryptEasy: crypto_box_easy, written after zeroPrefix zero bytes in the only buffer allocated.
+* With zeroPrefix = crypto_box_BOXZEROBYTES, the result is the crypto_box format
+*/
+void KeyRing::BoxEncrypt(const Nan::FunctionCallbackInfo<v8::Value>& info, size_t zeroPrefix){
+	PREPARE_FUNC_VARS();
+	if (!checkBoxArgs(info)) return;
 
-	int boxResult;
-	if (instance->_keyType == "curve25519"){
-		boxResult = crypto_box(cipher, paddedMessage, messageLength + crypto_box_ZEROBYTES, nonce, publicKey, instance->_privateKey);
-	} else {
-		boxResult = crypto_box(cipher, paddedMessage, messageLength + crypto_box_ZEROBYTES, nonce, publicKey, instance->_altPrivateKey);
-	}
+	const unsigned char* message = (unsigned char*) Buffer::Data(info[0]);
+	const size_t messageLength = Buffer::Length(info[0]);
+	const unsigned char* publicKey = (unsigned char*) Buffer::Data(info[1]);
+	const unsigned char* nonce = (unsigned char*) Buffer::Data(info[2]);
+
+	Local<Object> cipherBuf = Nan::NewBuffer(zeroPrefix + crypto_box_MACBYTES + messageLength).ToLocalChecked();
+	unsigned char* cipher = (unsigned char*) Buffer::Data(cipherBuf);
+	memset(cipher, 0, zeroPrefix);
+
+	const unsigned char* privateKey = instance->_keyType == "curve25519" ? instance->_privateKey : instance->_altPrivateKey;
+	int boxResult = crypto_box_easy(cipher + zeroPrefix, message, messageLength, nonce, publicKey, privateKey);
 	if (boxResult != 0){
 		stringstream errMsg;
 		errMsg << "Error while encrypting message. Error code : " << boxResult;
@@ -253,61 +376,49 @@ NAN_METHOD(KeyRing::Encrypt){
 		return;
 	}
 
-	//BUILD_BUFFER(string((char*) cipher, message.length()).c_str());
-	if (!(info.Length() > 3 && info[3]->IsFunction())){
-		info.GetReturnValue().Set(cipherBuf);
-	} else {
-		//BUILD_BUFFER_CHAR(result, (char*)cipher, messageLength + crypto_box_ZEROBYTES);
-		Local<Function> callback = Local<Function>::Cast(info[3]);
-		const int argc = 1;
-		Local<Value> argv[argc] = { cipherBuf };
-		callback->Call(instance->globalObj, argc, argv);
-		info.GetReturnValue().Set(Nan::Undefined());
-		return;
-	}
+	replyWith(info, cipherBuf);
 }
 
 /*
-* Decrypt a message, using crypto_box_open
-* Args : Buffer cipher, Buffer publicKey, Buffer nonce, Function callback (optional)
+* Shared by decrypt and decryptEasy: crypto_box_open_easy on what follows the zeroPrefix zero bytes,
+* straight into the only buffer allocated
 */
-NAN_METHOD(KeyRing::Decrypt){
+void KeyRing::BoxDecrypt(const Nan::FunctionCallbackInfo<v8::Value>& info, size_t zeroPrefix){
 	PREPARE_FUNC_VARS();
-	MANDATORY_ARGS(3, "Mandatory args : cipher, counterpartPubKey, nonce\nOptional args: callback");
-	//CHECK_KEYPAIR("curve25519");
+	if (!checkBoxArgs(info)) return;
 
-	Local<Object> cipherVal = info[0]->ToObject();
-	Local<Object> publicKeyVal = info[1]->ToObject();
-	Local<Object> nonceVal = info[2]->ToObject();
+	const unsigned char* cipher = (unsigned char*) Buffer::Data(info[0]);
+	const size_t cipherLength = Buffer::Length(info[0]);
+	const unsigned char* publicKey = (unsigned char*) Buffer::Data(info[1]);
+	const unsigned char* nonce = (unsigned char*) Buffer::Data(info[2]);
 
-	const unsigned char* cipher = (unsigned char*) Buffer::Data(cipherVal);
-	const size_t cipherLength = Buffer::Length(cipherVal);
+	if (cipherLength < zeroPrefix + crypto_box_MACBYTES){
+		stringstream errMsg;
+		errMsg << "The cipher argument must be at least " << zeroPrefix + crypto_box_MACBYTES << " bytes long";
+		Nan::ThrowTypeError(errMsg.str().c_str());
+		info.GetReturnValue().Set(Nan::Undefined());
+		return;
+	}
 
-	//Checking that the first crypto_box_BOXZEROBYTES are zeros
+	//Checking that the first zeroPrefix bytes are zeros
 	unsigned int i = 0;
-	for (i = 0; i < crypto_box_BOXZEROBYTES; i++){
+	for (i = 0; i < zeroPrefix; i++){
 		if (cipher[i]) break;
 	}
-	if (i < crypto_box_BOXZEROBYTES){
+	if (i < zeroPrefix){
 		stringstream errMsg;
-		errMsg << "The first " << crypto_box_BOXZEROBYTES << " bytes of the cipher argument must be zeros";
+		errMsg << "The first " << zeroPrefix << " bytes of the cipher argument must be zeros";
 		Nan::ThrowTypeError(errMsg.str().c_str());
 		info.GetReturnValue().Set(Nan::Undefined());
 		return;
 	}
 
-	const unsigned char* publicKey = (unsigned char*) Buffer::Data(publicKeyVal);
+	const size_t plaintextLength = cipherLength - zeroPrefix - crypto_box_MACBYTES;
+	Local<Object> plaintextBuf = Nan::NewBuffer(plaintextLength).ToLocalChecked();
+	unsigned char* plaintext = (unsigned char*) Buffer::Data(plaintextBuf);
 
-	const unsigned char* nonce = (unsigned char*) Buffer::Data(nonceVal);
-
-	unsigned char* message = new unsigned char[cipherLength];
-
-	int boxResult;
-	if (instance->_keyType == "curve25519"){
-		boxResult = crypto_box_open(message, cipher, cipherLength, nonce, publicKey, instance->_privateKey);
-	} else {
-		boxResult = crypto_box_open(message, cipher, cipherLength, nonce, publicKey, instance->_altPrivateKey);
-	}
+	const unsigned char* privateKey = instance->_keyType == "curve25519" ? instance->_privateKey : instance->_altPrivateKey;
+	int boxResult = crypto_box_open_easy(plaintext, cipher + zeroPrefix, cipherLength - zeroPrefix, nonce, publicKey, privateKey);
 	if (boxResult != 0){
 		stringstream errMsg;
 		errMsg << "Error while decrypting message. Error code : " << boxResult;
@@ -316,22 +427,47 @@ NAN_METHOD(KeyRing::Decrypt){
 		return;
 	}
 
-	unsigned char* plaintext = new unsigned char[cipherLength - crypto_box_ZEROBYTES];
-	memcpy(plaintext, (void*) (message + crypto_box_ZEROBYTES), cipherLength - crypto_box_ZEROBYTES);
+	replyWith(info, plaintextBuf);
+}
 
+/**
+* Make a Curve25519 key exchange for a given public key, then encrypt the message (crypto_box)
+* Parameters Buffer message, Buffer publicKey, Buffer nonce, callback (optional)
+* Returns Buffer, in the crypto_box format: crypto_box_BOXZEROBYTES zeros, the MAC, then the encrypted message
+*/
+NAN_METHOD(KeyRing::Encrypt){
+	MANDATORY_ARGS(3, "Mandatory args : message, counterpartPubKey, nonce\nOptional args: callback");
+	//CHECK_KEYPAIR("curve25519");
+	BoxEncrypt(info, crypto_box_BOXZEROBYTES);
+}
 
-	//BUILD_BUFFER_CHAR(result, (char*)plaintext, cipherLength - crypto_box_ZEROBYTES);
-	if (!(info.Length() > 3 && info[3]->IsFunction())){
-		info.GetReturnValue().Set(Nan::NewBuffer((char*) plaintext, cipherLength - crypto_box_ZEROBYTES).ToLocalChecked());
-		return;
-	} else {
-		Local<Function> callback = Local<Function>::Cast(info[3]);
-		const int argc = 1;
-		Local<Value> argv[argc] = { Nan::NewBuffer((char*) plaintext, cipherLength - crypto_box_ZEROBYTES).ToLocalChecked() };
-		callback->Call(instance->globalObj, argc, argv);
-		info.GetReturnValue().Set(Nan::Undefined());
-		return;
-	}
+/*
+* Decrypt a message, using crypto_box_open
+* Args : Buffer cipher, Buffer publicKey, Buffer nonce, Function callback (optional)
+*/
+NAN_METHOD(KeyRing::Decrypt){
+	MANDATORY_ARGS(3, "Mandatory args : cipher, counterpartPubKey, nonce\nOptional args: callback");
+	//CHECK_KEYPAIR("curve25519");
+	BoxDecrypt(info, crypto_box_BOXZEROBYTES);
+}
+
+/**
+* Same as encrypt, in the crypto_box_easy format: the MAC, then the encrypted message.
+* 16 bytes shorter than the output of encrypt
+* Parameters Buffer message, Buffer publicKey, Buffer nonce, callback (optional)
+*/
+NAN_METHOD(KeyRing::EncryptEasy){
+	MANDATORY_ARGS(3, "Mandatory args : message, counterpartPubKey, nonce\nOptional args: callback");
+	BoxEncrypt(info, 0);
+}
+
+/*
+* Decrypt a message produced by encryptEasy, using crypto_box_open_easy
+* Args : Buffer cipher, Buffer publicKey, Buffer nonce, Function callback (optional)
+*/
+NAN_METHOD(KeyRing::DecryptEasy){
+	MANDATORY_ARGS(3, "Mandatory args : cipher, counterpartPubKey, nonce\nOptional args: callback");
+	BoxDecrypt(info, 0);
 }
 
 /*
@@ -382,7 +518,7 @@ NAN_METHOD(KeyRing::Sign){
 		Local<Function> callback = Local<Function>::Cast(info[1]);
 		const int argc = 1;
 		Local<Value> argv[argc] = { signatureBuf };
-		callback->Call(instance->globalObj, argc, argv);
+		callback->Call(Nan::GetCurrentContext()->Global(), argc, argv);
 		info.GetReturnValue().Set(Nan::Undefined());
 		return;
 	}
@@ -416,7 +552,7 @@ NAN_METHOD(KeyRing::Agree){
 		Local<Function> callback = Local<Function>::Cast(info[1]);
 		const int argc = 1;
 		Local<Value> argv[argc] = { sharedSecretBuf };
-		callback->Call(instance->globalObj, argc, argv);
+		callback->Call(Nan::GetCurrentContext()->Global(), argc, argv);
 		info.GetReturnValue().Set(Nan::Undefined());
 		return;
 	}
@@ -439,7 +575,7 @@ NAN_METHOD(KeyRing::PublicKeyInfo){
 		Local<Function> callback = Local<Function>::Cast(info[0]);
 		const unsigned argc = 1;
 		Local<Value> argv[argc] = { instance->PPublicKeyInfo() };
-		callback->Call(instance->globalObj, argc, argv);
+		callback->Call(Nan::GetCurrentContext()->Global(), argc, argv);
 		info.GetReturnValue().Set(Nan::Undefined());
 		return;
 	}
@@ -478,33 +614,7 @@ NAN_METHOD(KeyRing::CreateKeyPair){
 		return;
 	}
 	//Delete the keypair loaded in memory, part by part, if any
-	if (instance->_privateKey != 0){
-		if (instance->_keyType == "ed25519") sodium_memzero(instance->_privateKey, crypto_sign_SECRETKEYBYTES);
-		else sodium_memzero(instance->_privateKey, crypto_box_SECRETKEYBYTES);
-		delete instance->_privateKey;
-		instance->_privateKey = 0;
-	}
-	if (instance->_publicKey != 0){
-		if (instance->_keyType == "ed25519") sodium_memzero(instance->_publicKey, crypto_sign_PUBLICKEYBYTES);
-		else sodium_memzero(instance->_publicKey, crypto_box_PUBLICKEYBYTES);
-		delete instance->_publicKey;
-		instance->_publicKey = 0;
-	}
-	//Note : altKeys are always curve25519
-	if (instance->_altPrivateKey != 0){
-		sodium_memzero(instance->_altPrivateKey, crypto_box_SECRETKEYBYTES);
-		delete instance->_altPrivateKey;
-		instance->_altPrivateKey = 0;
-	}
-	if (instance->_altPublicKey != 0){
-		sodium_memzero(instance->_altPublicKey, crypto_box_PUBLICKEYBYTES);
-		delete instance->_altPublicKey;
-		instance->_altPublicKey = 0;
-	}
-	if (instance->_keyType != ""){
-		instance->_keyType = "";
-	}
-	instance->_filename = "";
+	instance->resetKeys();
 	//Generating keypairs
 	if (keyType == "ed25519"){
 		unsigned char* privateKey = new unsigned char[crypto_sign_SECRETKEYBYTES];
@@ -527,6 +637,40 @@ NAN_METHOD(KeyRing::CreateKeyPair){
 		instance->_keyType = "curve25519";
 	}
 
+	if (info.Length() > 2 && info[2]->IsFunction()){ //Callback. Saving (if needed) on a worker thread
+		string filename = "";
+		if (!info[1]->IsUndefined()){
+			String::Utf8Value filenameVal(info[1]->ToString());
+			filename = string(*filenameVal);
+		}
+		const unsigned char* password = 0;
+		size_t passwordSize = 0;
+		if (info.Length() > 3 && !info[3]->IsUndefined()){
+			Local<Value> passwordVal = info[3]->ToObject();
+			password = (unsigned char*) Buffer::Data(passwordVal);
+			passwordSize = Buffer::Length(passwordVal);
+		}
+		KeyRingWorker* worker = new KeyRingWorker(new Nan::Callback(info[2].As<Function>()), info.This(), KeyRingWorker::SAVE, filename, password, passwordSize);
+		worker->SetKeyPair(keyType, instance->_privateKey, instance->_publicKey);
+		worker->ReplyWithKeyInfo();
+		unsigned long opsLimit = 16384;
+		unsigned short r = 8;
+		unsigned short p = 1;
+		if (info.Length() > 4 && info[4]->IsNumber()){
+			opsLimit = (unsigned long) info[4]->IntegerValue();
+		}
+		if (info.Length() > 5 && info[5]->IsNumber()){
+			r = (unsigned short) info[5]->Int32Value();
+		}
+		if (info.Length() > 6 && info[6]->IsNumber()){
+			p = (unsigned short) info[6]->Int32Value();
+		}
+		worker->SetScryptParams(opsLimit, r, p);
+		WorkerPool::QueueWorker(worker);
+		info.GetReturnValue().Set(Nan::Undefined());
+		return;
+	}
+
 	if (info.Length() >= 2 && !info[1]->IsUndefined()){ //Save keypair to file
 		String::Utf8Value filenameVal(info[1]->ToString());
 		string filename(*filenameVal);
@@ -542,27 +686,18 @@ NAN_METHOD(KeyRing::CreateKeyPair){
 					opsLimit = (unsigned long) info[4]->IntegerValue();
 				}
 				if (info.Length() > 5 && info[5]->IsNumber()){
-					r = (unsigned short) info[4]->Int32Value();
+					r = (unsigned short) info[5]->Int32Value();
 				}
 				if (info.Length() > 6 && info[6]->IsNumber()){
-					p = (unsigned short) info[5]->Int32Value();
+					p = (unsigned short) info[6]->Int32Value();
 				}
 				saveKeyPair(filename, keyType, instance->_privateKey, instance->_publicKey, password, passwordSize, opsLimit, r, p);
 			} else saveKeyPair(filename, keyType, instance->_privateKey, instance->_publicKey, password, passwordSize);
 		} else saveKeyPair(filename, keyType, instance->_privateKey, instance->_publicKey);
 		instance->_filename = filename;
 	}
-	if (info.Length() >= 3 && info[3]->IsFunction()){ //Callback
-		Local<Function> callback = Local<Function>::Cast(info[2]);
-		const unsigned argc = 1;
-		Local<Value> argv[argc] = { instance->PPublicKeyInfo() };
-		callback->Call(instance->globalObj, argc, argv);
-		info.GetReturnValue().Set(Nan::Undefined());
-		return;
-	} else {
-		info.GetReturnValue().Set(instance->PPublicKeyInfo());
-		return;
-	}
+	info.GetReturnValue().Set(instance->PPublicKeyInfo());
+	return;
 }
 
 // String filename, Function callback (optional), password, maxOpsLimit
@@ -573,30 +708,24 @@ NAN_METHOD(KeyRing::Load){
 	String::Utf8Value filenameVal(info[0]->ToString());
 	string filename(*filenameVal);
 
-	if (instance->_privateKey != 0){
-		if (instance->_keyType == "ed25519") sodium_memzero(instance->_privateKey, crypto_sign_SECRETKEYBYTES);
-		else sodium_memzero(instance->_privateKey, crypto_box_SECRETKEYBYTES);
-		delete instance->_privateKey;
-		instance->_privateKey = 0;
-	}
-	if (instance->_publicKey != 0){
-		if (instance->_keyType == "ed25519") sodium_memzero(instance->_publicKey, crypto_sign_PUBLICKEYBYTES);
-		else sodium_memzero(instance->_publicKey, crypto_box_PUBLICKEYBYTES);
-		delete instance->_publicKey;
-		instance->_publicKey = 0;
-	}
-	//Note : altKeys are always curve25519
-	if (instance->_altPrivateKey != 0){
-		sodium_memzero(instance->_altPrivateKey, crypto_box_SECRETKEYBYTES);
-		delete instance->_altPrivateKey;
-		instance->_altPrivateKey = 0;
-	}
-	if (instance->_altPublicKey != 0){
-		sodium_memzero(instance->_altPublicKey, crypto_box_PUBLICKEYBYTES);
-		delete instance->_altPublicKey;
-		instance->_altPublicKey = 0;
+	instance->resetKeys();
+
+	if (info.Length() > 1 && info[1]->IsFunction()){ //Reading and decrypting the file on a worker thread
+		const unsigned char* password = 0;
+		size_t passwordSize = 0;
+		if (info.Length() > 2 && !info[2]->IsUndefined()){
+			Local<Value> passwordVal = info[2]->ToObject();
+			password = (unsigned char*) Buffer::Data(passwordVal);
+			passwordSize = Buffer::Length(passwordVal);
+		}
+		KeyRingWorker* worker = new KeyRingWorker(new Nan::Callback(info[1].As<Function>()), info.This(), KeyRingWorker::LOAD, filename, password, passwordSize);
+		if (info.Length() > 3 && info[3]->IsNumber()){
+			worker->SetMaxOpsLimit((unsigned long) info[3]->IntegerValue());
+		}
+		WorkerPool::QueueWorker(worker);
+		info.GetReturnValue().Set(Nan::Undefined());
+		return;
 	}
-	instance->_filename = "";
 
 	fstream fileReader(filename.c_str(), ios::in);
 	string keyStr;
@@ -669,7 +798,7 @@ NAN_METHOD(KeyRing::Load){
 		Local<Function> callback = Local<Function>::Cast(info[1]);
 		const int argc = 1;
 		Local<Value> argv[argc] = { instance->PPublicKeyInfo() };
-		callback->Call(instance->globalObj, argc, argv);
+		callback->Call(Nan::GetCurrentContext()->Global(), argc, argv);
 		info.GetReturnValue().Set(Nan::Undefined());
 		return;
 	}
@@ -689,6 +818,39 @@ NAN_METHOD(KeyRing::Save){
 	String::Utf8Value filenameVal(info[0]);
 	string filename(*filenameVal);
 
+	if (info.Length() > 1 && info[1]->IsFunction()){ //Writing the file (and deriving the password) on a worker thread
+		const unsigned char* password = 0;
+		size_t passwordSize = 0;
+		if (info.Length() > 2){
+			if (info[2]->IsUndefined()){
+				Nan::ThrowTypeError("When using encryption, the password can't be null");
+				info.GetReturnValue().Set(Nan::Undefined());
+				return;
+			}
+			Local<Value> passwordVal = info[2]->ToObject();
+			password = (unsigned char*) Buffer::Data(passwordVal);
+			passwordSize = Buffer::Length(passwordVal);
+		}
+		KeyRingWorker* worker = new KeyRingWorker(new Nan::Callback(info[1].As<Function>()), info.This(), KeyRingWorker::SAVE, filename, password, passwordSize);
+		worker->SetKeyPair(instance->_keyType, instance->_privateKey, instance->_publicKey);
+		unsigned long opsLimit = 16384;
+		unsigned short r = 8;
+		unsigned short p = 1;
+		if (info.Length() > 3 && info[3]->IsNumber()){
+			opsLimit = (unsigned long) info[3]->IntegerValue();
+		}
+		if (info.Length() > 4 && info[4]->IsNumber()){
+			r = (unsigned short) info[4]->Int32Value();
+		}
+		if (info.Length() > 5 && info[5]->IsNumber()){
+			p = (unsigned short) info[5]->Int32Value();
+		}
+		worker->SetScryptParams(opsLimit, r, p);
+		WorkerPool::QueueWorker(worker);
+		info.GetReturnValue().Set(Nan::Undefined());
+		return;
+	}
+
 	if (info.Length() > 2){
 		if (info[2]->IsUndefined()){
 			Nan::ThrowTypeError("When using encryption, the password can't be null");
@@ -760,7 +922,7 @@ NAN_METHOD(KeyRing::Save){
 		Local<Function> callback = Local<Function>::Cast(info[1]);
 		const int argc = 0;
 		Local<Value> argv[argc];
-		callback->Call(instance->globalObj, argc, argv);
+		callback->Call(Nan::GetCurrentContext()->Global(), argc, argv);
 		info.GetReturnValue().Set(Nan::Undefined());
 		return;
 	}
@@ -769,33 +931,7 @@ NAN_METHOD(KeyRing::Save){
 NAN_METHOD(KeyRing::Clear){
 	Nan::HandleScope scope;
 	KeyRing* instance = ObjectWrap::Unwrap<KeyRing>(info.This());
-	if (instance->_privateKey != 0){
-		if (instance->_keyType == "ed25519") sodium_memzero(instance->_privateKey, crypto_sign_SECRETKEYBYTES);
-		else sodium_memzero(instance->_privateKey, crypto_box_SECRETKEYBYTES);
-		delete instance->_privateKey;
-		instance->_privateKey = 0;
-	}
-	if (instance->_publicKey != 0){
-		if (instance->_keyType == "ed25519") sodium_memzero(instance->_publicKey, crypto_sign_PUBLICKEYBYTES);
-		else sodium_memzero(instance->_publicKey, crypto_box_PUBLICKEYBYTES);
-		delete instance->_publicKey;
-		instance->_publicKey = 0;
-	}
-	//Note : altKeys are always curve25519
-	if (instance->_altPrivateKey != 0){
-		sodium_memzero(instance->_altPrivateKey, crypto_box_SECRETKEYBYTES);
-		delete instance->_altPrivateKey;
-		instance->_altPrivateKey = 0;
-	}
-	if (instance->_altPublicKey != 0){
-		sodium_memzero(instance->_altPublicKey, crypto_box_PUBLICKEYBYTES);
-		delete instance->_altPublicKey;
-		instance->_altPublicKey = 0;
-	}
-	if (instance->_keyType != ""){
-		instance->_keyType = "";
-	}
-	instance->_filename = "";
+	instance->resetKeys();
 	info.GetReturnValue().Set(Nan::Undefined());
 	return;
 }
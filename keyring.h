@@ -7,6 +7,7 @@
 #include <nan.h>
 
 class KeyRing : public node::ObjectWrap{
+	friend class KeyRingWorker;
 
 public:
 	//static void Init(v8::Handle<v8::Object> exports);
@@ -23,8 +24,6 @@ private:
 	unsigned char* _altPublicKey;
 	std::string _keyType;
 	bool _keyLock;
-	v8::Local<v8::Object> globalObj;
-	v8::Local<v8::Function> bufferConstructor;
 	/*
 	* Internal methods
 	*/
@@ -39,13 +38,15 @@ private:
 	static std::string encodeKeyBuffer(std::string const& keyType, const unsigned char* privateKey, const unsigned char* publicKey);
 	static void deriveAltKeys(unsigned char* edPub, unsigned char* edSec, unsigned char* cPub, unsigned char* cSec); //Called whenever an Ed25519 key is loaded/generated. Used to calculate the Curve25519 version of it and put in memory
 
+	//Zeroes and frees the key pair currently held by the instance
+	void resetKeys();
+
 	//private PubKeyInfo object constructor
 	v8::Local<v8::Object> PPublicKeyInfo();
 
-	static inline Nan::Persistent<v8::Function> & constructor() {
-		static Nan::Persistent<v8::Function> my_constructor;
-		return my_constructor;
-	}
+	//Shared by the encrypt/decrypt methods. zeroPrefix: number of zero bytes before the crypto_box_easy format cipher text
+	static void BoxEncrypt(const Nan::FunctionCallbackInfo<v8::Value>& info, size_t zeroPrefix);
+	static void BoxDecrypt(const Nan::FunctionCallbackInfo<v8::Value>& info, size_t zeroPrefix);
 
 	/*
 	* JS Methods
@@ -53,6 +54,8 @@ private:
 	static NAN_METHOD(New);
 	static NAN_METHOD(Encrypt);
 	static NAN_METHOD(Decrypt);
+	static NAN_METHOD(EncryptEasy);
+	static NAN_METHOD(DecryptEasy);
 	static NAN_METHOD(Sign);
 	static NAN_METHOD(Agree);
 	static NAN_METHOD(PublicKeyInfo);
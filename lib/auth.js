@@ -4,6 +4,7 @@
 var binding = require('../build/Release/sodium');
 var AuthKey = require('./keys/auth-key');
 var toBuffer = require('./toBuffer');
+var toMessage = require('./toMessage');
 var should = require('should');
 
 /**
@@ -86,7 +87,7 @@ module.exports = function  Auth(secretKey, encoding) {
      */
     self.generate = function(message, encoding) {
         encoding = encoding || self.defaultEncoding;
-        var messageBuf = toBuffer(message, encoding);
+        var messageBuf = toMessage(message, encoding);
         return binding.crypto_auth(messageBuf, self.secretKey.get());
     };
 
@@ -105,7 +106,7 @@ module.exports = function  Auth(secretKey, encoding) {
         encoding = encoding || self.defaultEncoding;
 
         var tokenBuf = toBuffer(token, encoding);
-        var messageBuf = toBuffer(message, encoding);
+        var messageBuf = toMessage(message, encoding);
 
         return binding.crypto_auth_verify(tokenBuf, messageBuf, self.secretKey.get()) ? false : true;
     };
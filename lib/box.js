@@ -7,7 +7,7 @@
 'use strict';
 
 var binding = require('../build/Release/sodium');
-var toBuffer = require('./toBuffer');
+var toMessage = require('./toMessage');
 var BoxKey = require('./keys/box-key');
 var Nonce = require('./nonces/box-nonce');
 var should = require('should');
@@ -114,7 +114,7 @@ module.exports = function Box(publicKey, secretKey) {
         // generate a new random nonce
         var nonce = new Nonce();
 
-        var buf = toBuffer(plainText, encoding);
+        var buf = toMessage(plainText, encoding);
 
         var cipherText = binding.crypto_box(
             buf,
@@ -5,7 +5,7 @@
  */
 var binding = require('../build/Release/sodium');
 var should = require('should');
-var toBuffer = require('./toBuffer');
+var toMessage = require('./toMessage');
 var CryptoBase = require('./crypto-base');
 var Nonce = require('./nonces/box-nonce');
 var util = require('util');
@@ -45,7 +45,7 @@ var Box = function(publicKey, secretKey) {
         // generate a new random nonce
         var nonce = new Nonce();
 
-        var buf = toBuffer(plainText, encoding);
+        var buf = toMessage(plainText, encoding);
 
         var cipherText = binding.crypto_box(
             buf,
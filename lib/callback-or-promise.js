@@ -0,0 +1,35 @@
+/**
+ * Helper for the asynchronous bindings
+ *
+ * Native asynchronous bindings take a node-style callback(err, result) as
+ * their last argument. This helper passes the user's callback through when
+ * there is one, and otherwise wraps the call into a Promise.
+ */
+/* jslint node: true */
+'use strict';
+
+/**
+ * @param {Function} fn          native binding to call
+ * @param {Array} args           arguments of the binding, without the callback
+ * @param {Function} [callback]  node-style callback
+ * @returns {Promise|undefined}  a Promise when no callback was given
+ */
+function callbackOrPromise(fn, args, callback) {
+    if (callback) {
+        fn.apply(null, args.concat([callback]));
+        return;
+    }
+
+    if (typeof Promise !== 'function') {
+        throw new TypeError('Promises are not supported by this version of node, please provide a callback');
+    }
+
+    return new Promise(function(resolve, reject) {
+        fn.apply(null, args.concat([function(err, result) {
+            if (err) reject(err);
+            else resolve(result);
+        }]));
+    });
+}
+
+module.exports = callbackOrPromise;
@@ -275,6 +275,13 @@ module.exports =  function CryptoBaseBuffer() {
             throw self.error('buffer has not been generated or set yet.');
         }
 
+        // Constant time encoding, the buffer is usually a key
+        if( encoding === 'hex' && Buffer.isBuffer(self.baseBuffer) ) {
+            return binding.sodium_bin2hex(self.baseBuffer);
+        }
+        if( encoding === 'base64' && Buffer.isBuffer(self.baseBuffer) ) {
+            return binding.sodium_bin2base64(self.baseBuffer);
+        }
         return self.baseBuffer.toString(encoding);
     };
 
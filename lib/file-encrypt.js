@@ -1,24 +1,141 @@
 var binding = require('../build/Release/sodium');
-var fs = require('fs');
-var path = require('path');
 var Buffer = require('buffer').Buffer;
+var callbackOrPromise = require('./callback-or-promise');
 
 /**
 * Encrypts the provided fileContent based on the provided password and stores the result at the given filename
+* When a callback is given, the key derivation, the encryption and the file writing (and the creation of the missing
+* folders of filename) are done on a worker thread
 *
 * @param {String|Buffer} fileContent
 * @param {String|Buffer} password
 * @param {String} filename
-* @param {Function} [callback]
+* @param {Function} [callback] - callback(err), called once the file is written
 * @throws {TypeError} invalid parameter types
 */
 exports.encryptFile = function(fileContent, password, filename, callback){
+	if (callback && typeof callback != 'function') throw new TypeError('When defined, callback must be a function');
+
+	var args = encryptArgs(fileContent, password, filename);
+
+	if (callback){
+		binding.encrypt_file(args[0], args[1], args[2], callback);
+	} else return binding.encrypt_file(args[0], args[1], args[2]);
+
+};
+
+/**
+* Asynchronous version of encryptFile, returning a Promise when no callback is given
+*
+* @param {String|Buffer} fileContent - must not be modified until the returned Promise settles
+* @param {String|Buffer} password
+* @param {String} filename
+* @param {Function} [callback] - callback(err)
+* @returns {Promise|undefined}
+*/
+exports.encryptFileAsync = function(fileContent, password, filename, callback){
+	if (callback && typeof callback != 'function') throw new TypeError('When defined, callback must be a function');
+
+	return callbackOrPromise(binding.encrypt_file, encryptArgs(fileContent, password, filename), callback);
+};
+
+/**
+* Decrypts a file that was encrypted with encryptFile
+* When a callback is given, the file reading, the key derivation and the decryption are done on a worker thread
+*
+* @param {String} filename
+* @param {String|Buffer} password
+* @param {Function} [callback] - callback(err, plaintext)
+* @returns {Buffer} the plaintext, if no callback is given
+*/
+exports.decryptFile = function(filename, password, callback){
+	if (callback && typeof callback != 'function') throw new TypeError('when defined, callback must be a function');
+
+	var args = decryptArgs(filename, password);
+
+	if (callback){
+		binding.decrypt_file(args[0], args[1], callback);
+	} else return binding.decrypt_file(args[0], args[1]);
+
+};
+
+/**
+* Asynchronous version of decryptFile, returning a Promise when no callback is given
+*
+* @param {String} filename
+* @param {String|Buffer} password
+* @param {Function} [callback] - callback(err, plaintext)
+* @returns {Promise|undefined}
+*/
+exports.decryptFileAsync = function(filename, password, callback){
+	if (callback && typeof callback != 'function') throw new TypeError('when defined, callback must be a function');
+
+	return callbackOrPromise(binding.decrypt_file, decryptArgs(filename, password), callback);
+};
+
+/**
+* Encrypts the input file to the output file in the streaming file format, in constant memory whatever the file size
+* When a callback is given, the key derivation and the encryption are done on a worker thread
+*
+* @param {String|Buffer|Number} input - path or file descriptor of the file to encrypt
+* @param {String|Buffer|Number} output - path or file descriptor of the encrypted file
+* @param {String|Buffer} password
+* @param {Function} [callback] - callback(err), called once the output is written
+* @throws {TypeError} invalid parameter types
+*/
+exports.encryptFileStream = function(input, output, password, callback){
+	if (callback && typeof callback != 'function') throw new TypeError('When defined, callback must be a function');
+
+	var args = streamArgs(input, output, password);
+
+	if (callback){
+		binding.encrypt_file_stream(args[0], args[1], args[2], callback);
+	} else return binding.encrypt_file_stream(args[0], args[1], args[2]);
+};
+
+/**
+* Decrypts the input file, encrypted with encryptFileStream, to the output file, in constant memory whatever the file size
+* When a callback is given, the key derivation and the decryption are done on a worker thread
+*
+* @param {String|Buffer|Number} input - path or file descriptor of the encrypted file
+* @param {String|Buffer|Number} output - path or file descriptor of the decrypted file
+* @param {String|Buffer} password
+* @param {Function} [callback] - callback(err), called once the output is written
+* @throws {TypeError} invalid parameter types
+*/
+exports.decryptFileStream = function(input, output, password, callback){
+	if (callback && typeof callback != 'function') throw new TypeError('When defined, callback must be a function');
+
+	var args = streamArgs(input, output, password);
+
+	if (callback){
+		binding.decrypt_file_stream(args[0], args[1], args[2], callback);
+	} else return binding.decrypt_file_stream(args[0], args[1], args[2]);
+};
+
+/**
+* Asynchronous version of encryptFileStream, returning a Promise when no callback is given
+*/
+exports.encryptFileStreamAsync = function(input, output, password, callback){
+	if (callback && typeof callback != 'function') throw new TypeError('When defined, callback must be a function');
+
+	return callbackOrPromise(binding.encrypt_file_stream, streamArgs(input, output, password), callback);
+};
+
+/**
+* Asynchronous version of decryptFileStream, returning a Promise when no callback is given
+*/
+exports.decryptFileStreamAsync = function(input, output, password, callback){
+	if (callback && typeof callback != 'function') throw new TypeError('When defined, callback must be a function');
+
+	return callbackOrPromise(binding.decrypt_file_stream, streamArgs(input, output, password), callback);
+};
+
+function encryptArgs(fileContent, password, filename){
 	if (!(typeof fileContent == 'string' || Buffer.isBuffer(fileContent))) throw new TypeError('fileContent must either be a string or a buffer');
 	if (!(typeof password == 'string' || Buffer.isBuffer(password))) throw new TypeError('password must either be a string or a buffer');
 	if (!(typeof filename == 'string' || Buffer.isBuffer(filename))) throw new TypeError('filename must either be a string or a buffer');
 
-	if (callback && typeof callback != 'function') throw new TypeError('When defined, callback must be a function');
-
 	var fileBuf, passBuf, filenameStr;
 	if (Buffer.isBuffer(fileContent)){
 		fileBuf = fileContent;
@@ -36,21 +153,14 @@ exports.encryptFile = function(fileContent, password, filename, callback){
 		filenameStr = filename;
 	}
 
-	//Check that the path to the folder that will contain the resulting file exists; and if not, build it
-	buildPath(path.join(filenameStr, '..'));
-
-	if (callback){
-		binding.encrypt_file(fileBuf, passBuf, filenameStr, callback);
-	} else return binding.encrypt_file(fileBuf, passBuf, filenameStr);
-
-};
+	//The missing folders of the path of the resulting file are built by the binding, on the worker thread when asynchronous
+	return [fileBuf, passBuf, filenameStr];
+}
 
-exports.decryptFile = function(filename, password, callback){
+function decryptArgs(filename, password){
 	if (!(typeof filename == 'string' || Buffer.isBuffer(filename))) throw new TypeError('filename must either be a string or a buffer');
 	if (!(typeof password == 'string' || Buffer.isBuffer(password))) throw new TypeError('password must either be a string or a buffer');
 
-	if (callback && typeof callback != 'function') throw new TypeError('when defined, callback must be a function');
-
 	var passBuf, filenameStr;
 	if (Buffer.isBuffer(password)){
 		passBuf = password;
@@ -60,34 +170,22 @@ exports.decryptFile = function(filename, password, callback){
 	if (Buffer.isBuffer(filename)){
 		filenameStr = filename.toString();
 	} else {
-		filenameStr = filename
+		filenameStr = filename;
 	}
 
-	//Check that the file exists
-	if (!(fs.existsSync(filenameStr) && fs.statSync(filenameStr).isFile())){
-		var err = new Error('file cannot be found');
-		if (callback) callback(err);
-		else throw err;
-	}
+	//A missing file is reported by the binding ('file cannot be found'), through the callback when asynchronous
+	return [filenameStr, passBuf];
+}
 
-	var plaintext;
-	try {
-		plaintext = binding.decrypt_file(filenameStr, password);
-	} catch (e){
-		if (callback){
-			callback(e);
-			return;
-		} else throw e;
-	}
-	if (callback) callback(null, plaintext);
-	else return plaintext;
+function streamArgs(input, output, password){
+	if (!(typeof input == 'string' || typeof input == 'number' || Buffer.isBuffer(input))) throw new TypeError('input must either be a path or a file descriptor');
+	if (!(typeof output == 'string' || typeof output == 'number' || Buffer.isBuffer(output))) throw new TypeError('output must either be a path or a file descriptor');
+	if (!(typeof password == 'string' || Buffer.isBuffer(password))) throw new TypeError('password must either be a string or a buffer');
 
-};
+	if (Buffer.isBuffer(input)) input = input.toString();
+	if (Buffer.isBuffer(output)) output = output.toString();
+	var passBuf = Buffer.isBuffer(password) ? password : new Buffer(password);
 
-//Build a directory path for a given directory path (and not filepath)
-function buildPath(folderPath){
-	if (!(fs.existsSync(folderPath) && fs.statSync(folderPath).isDirectory())){
-		if (!fs.existsSync(path.join(folderPath, '..'))) buildPath(path.join(folderPath, '..'));
-		else fs.mkdirSync(folderPath);
-	}
+	//The missing folders of an output path are built by the binding, on the worker thread when asynchronous
+	return [input, output, passBuf];
 }
@@ -0,0 +1,50 @@
+/* jslint node: true */
+'use strict';
+
+var binding = require('../build/Release/sodium');
+var Transform = require('stream').Transform;
+var util = require('util');
+
+/**
+ * Hash a stream in constant memory
+ *
+ * Data written to the stream is hashed as it arrives, with a native HashState.
+ * Once the input ends, the digest is pushed as the only output chunk and kept
+ * in the digest property.
+ *
+ *     fs.createReadStream(path).pipe(new HashStream('sha256')).on('data', function(digest) { ... });
+ *
+ * @param {String} [algorithm]  'sha512' (default) or 'sha256'
+ * @param {Object} [options]    options of the Transform stream
+ * @constructor
+ */
+function HashStream(algorithm, options) {
+    if( !(this instanceof HashStream) ) {
+        return new HashStream(algorithm, options);
+    }
+    Transform.call(this, options);
+
+    this.state = new binding.HashState(algorithm);
+
+    /** Digest, once the input has ended */
+    this.digest = undefined;
+}
+util.inherits(HashStream, Transform);
+
+HashStream.prototype._transform = function(chunk, encoding, callback) {
+    try {
+        this.state.update(Buffer.isBuffer(chunk) ? chunk : new Buffer(chunk, encoding));
+    }
+    catch (e) {
+        return callback(e);
+    }
+    callback();
+};
+
+HashStream.prototype._flush = function(callback) {
+    this.digest = this.state.final();
+    this.push(this.digest);
+    callback();
+};
+
+module.exports = HashStream;
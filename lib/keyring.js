@@ -63,19 +63,30 @@ module.exports = function(filename, password){
 				continue;
 			}
 			//fs.unlinkSync('./temp.key');
-			if (filename){
-				if (password){
-					var passwordBuf;
-					if (Buffer.isBuffer(password)) passwordBuf = password;
-					else passwordBuf = new Buffer(password, 'utf8');
-					var _opsLimit = opsLimit || 16384;
-					var _r = r || 8;
-					var _p = p || 1;
-					_keyRing.save(filename, undefined, passwordBuf, _opsLimit, _r, _p);
-				} else _keyRing.save(filename);
-			}
 			isValidKeyFile = true;
 		}
+
+		if (filename){
+			//When a callback is given, the key file is written (and the password derived) on a worker thread
+			var saveCallback;
+			if (callback){
+				saveCallback = function(err){
+					if (err instanceof Error) callback(err);
+					else callback(pubKey);
+				};
+			}
+			if (password){
+				var passwordBuf;
+				if (Buffer.isBuffer(password)) passwordBuf = password;
+				else passwordBuf = new Buffer(password, 'utf8');
+				var _opsLimit = opsLimit || 16384;
+				var _r = r || 8;
+				var _p = p || 1;
+				_keyRing.save(filename, saveCallback, passwordBuf, _opsLimit, _r, _p);
+			} else _keyRing.save(filename, saveCallback);
+			if (callback) return;
+		}
+
 		if (callback){
 			callback(pubKey);
 		} else return pubKey;
@@ -130,6 +141,34 @@ module.exports = function(filename, password){
 		}
 	};
 
+	this.encryptEasy = function(message, publicKey, nonce, callback){
+		if (!_keyRing) throw new TypeError('No key pair is loaded into the key ring');
+		if (!Buffer.isBuffer(message)) throw new TypeError('"message" must be a buffer');
+		if (!Buffer.isBuffer(publicKey)) throw new TypeError('"publicKey" must be a buffer');
+		if (!Buffer.isBuffer(nonce)) throw new TypeError('"nonce" must be a buffer');
+		if (callback && typeof callback !== 'function') throw new TypeError('When defined, callback must be a function');
+
+		if (!callback){
+			return _keyRing.encryptEasy(message, publicKey, nonce);
+		} else {
+			_keyRing.encryptEasy(message, publicKey, nonce, callback);
+		}
+	};
+
+	this.decryptEasy = function(cipher, publicKey, nonce, callback){
+		if (!_keyRing) throw new TypeError('No key pair is loaded into the key ring');
+		if (!Buffer.isBuffer(cipher)) throw new TypeError('"cipher" must be a buffer');
+		if (!Buffer.isBuffer(publicKey)) throw new TypeError('"publicKey" must be a buffer');
+		if (!Buffer.isBuffer(nonce)) throw new TypeError('"nonce" must be a buffer');
+		if (callback && typeof callback !== 'function') throw new TypeError('When defined, callback must be a function');
+
+		if (!callback){
+			return _keyRing.decryptEasy(cipher, publicKey, nonce);
+		} else {
+			_keyRing.decryptEasy(cipher, publicKey, nonce, callback);
+		}
+	};
+
 	this.sign = function(message, callback, detached){
 		if (!_keyRing) throw new TypeError('No key pair is loaded in the key ring');
 		if (!Buffer.isBuffer(message)) throw new TypeError('The "message" to be signed must be a buffer');
@@ -5,6 +5,7 @@ var binding = require('../build/Release/sodium');
 var should = require('should');
 var OneTimeKey = require('./keys/onetime-key');
 var toBuffer = require('./toBuffer');
+var toMessage = require('./toMessage');
 
 /**
  * One Time Message Authentication
@@ -70,7 +71,7 @@ module.exports = function OneTimeAuth(secretKey, encoding) {
      */
     self.generate = function(message, encoding) {
         encoding = encoding || self.defaultEncoding;
-        var messageBuf = toBuffer(message, encoding);
+        var messageBuf = toMessage(message, encoding);
         return binding.crypto_onetimeauth(messageBuf, self.secretKey.get());
     };
 
@@ -89,7 +90,7 @@ module.exports = function OneTimeAuth(secretKey, encoding) {
         encoding = encoding || self.defaultEncoding;
 
         var tokenBuf = toBuffer(token, encoding);
-        var messageBuf = toBuffer(message, encoding);
+        var messageBuf = toMessage(message, encoding);
 
         return binding.crypto_onetimeauth_verify(tokenBuf, messageBuf, self.secretKey.get()) ? false : true;
     };
@@ -1,5 +1,6 @@
 var binding = require('../build/Release/sodium');
 var Buffer = require('buffer').Buffer;
+var callbackOrPromise = require('./callback-or-promise');
 
 /**
 * Derives a password into a cryptographic key of a given length. High-level call
@@ -13,6 +14,30 @@ var Buffer = require('buffer').Buffer;
 */
 exports.crypto_pwhash_scryptsalsa208sha256 = function(password, salt, keyLength, opsLimit, memLimit){
 
+	return binding.crypto_pwhash_scryptsalsa208sha256.apply(null, hlArgs(password, salt, keyLength, opsLimit, memLimit));
+
+};
+
+/**
+* Asynchronous version of crypto_pwhash_scryptsalsa208sha256. The derivation runs on a worker thread
+*
+* @param {String|Buffer} password - the password to be derived
+* @param {String|Buffer} salt - the salt to be appended to the password before derivation. Must be 32 bytes long
+* @param {Number} keyLength - the resulting key length. Optional. Defaults to 32 bytes
+* @param {Number} opsLimit - the threshold of scrypt iterations. Optional
+* @param {Number} memLimit - the upper memory usage (in bytes) limit to be used in the key derivation. Optional
+* @param {Function} [callback] - callback(err, key). If omitted, a Promise is returned
+* @throws {TypeError} if the salt isn't 32 bytes long, or if the numeric parameters aren't positive integers
+*/
+exports.crypto_pwhash_scryptsalsa208sha256_async = function(password, salt, keyLength, opsLimit, memLimit, callback){
+	if (callback && typeof callback != 'function') throw new TypeError('when defined, callback must be a function');
+
+	return callbackOrPromise(binding.crypto_pwhash_scryptsalsa208sha256_async, hlArgs(password, salt, keyLength, opsLimit, memLimit), callback);
+
+};
+
+function hlArgs(password, salt, keyLength, opsLimit, memLimit){
+
 	if (!(typeof password == 'string' || Buffer.isBuffer(password))){
 		throw new TypeError('password must either be a string or a buffer');
 	}
@@ -35,7 +60,7 @@ exports.crypto_pwhash_scryptsalsa208sha256 = function(password, salt, keyLength,
 		}
 		saltBuf = salt;
 	} else {
-		if (Buffer.byteLength(salt, 'utf8') != binding.crypto_pwhash_scryptsalsa208sha256_SALTBYES){
+		if (Buffer.byteLength(salt, 'utf8') != binding.crypto_pwhash_scryptsalsa208sha256_SALTBYTES){
 			throw new TypeError('salt must be ' + binding.crypto_pwhash_scryptsalsa208sha256_SALTBYTES + ' bytes long');
 		}
 		saltBuf = new Buffer(salt, 'utf8');
@@ -45,9 +70,8 @@ exports.crypto_pwhash_scryptsalsa208sha256 = function(password, salt, keyLength,
 	if (typeof opsLimit != 'undefined' && !(typeof opsLimit == 'number' && opsLimit == Math.round(opsLimit) && opsLimit > 0)) throw new TypeError('when defined, opsLimit must be a positive integer');
 	if (typeof memLimit != 'undefined' && !(typeof memLimit == 'number' && memLimit == Math.round(memLimit) && memLimit > 0)) throw new TypeError('when defined, memLimit must be a positive integer');
 
-	return binding.crypto_pwhash_scryptsalsa208sha256(passwordBuf, saltBuf, keyLength, opsLimit, memLimit);
-
-};
+	return [passwordBuf, saltBuf, keyLength, opsLimit, memLimit];
+}
 
 /**
 * Derives a password into a cryptographic key of a given length. Low-level call
@@ -61,6 +85,30 @@ exports.crypto_pwhash_scryptsalsa208sha256 = function(password, salt, keyLength,
 */
 exports.crypto_pwhash_scryptsalsa208sha256_ll = function(password, salt, _N, _r, _p, _keyLength){
 
+	return binding.crypto_pwhash_scryptsalsa208sha256_ll.apply(null, llArgs(password, salt, _N, _r, _p, _keyLength));
+
+};
+
+/**
+* Asynchronous version of crypto_pwhash_scryptsalsa208sha256_ll. The derivation runs on a worker thread
+*
+* @param {String|Buffer} password - the password to be derived
+* @param {String|Buffer} salt - the salt to be appended to the password before derivation
+* @param {Number} N - the opsLimit. Optional. Defaults to 16384
+* @param {Number} r - the r parameter of the scrypt function. Optional. Defaults to 8
+* @param {Number} p - the p parameter of the scrypt function. Optional. Defaults to 1
+* @param {Number} keyLength - resulting key length, in bytes. Optional. Defaults to 32 bytes
+* @param {Function} [callback] - callback(err, key). If omitted, a Promise is returned
+*/
+exports.crypto_pwhash_scryptsalsa208sha256_ll_async = function(password, salt, _N, _r, _p, _keyLength, callback){
+	if (callback && typeof callback != 'function') throw new TypeError('when defined, callback must be a function');
+
+	return callbackOrPromise(binding.crypto_pwhash_scryptsalsa208sha256_ll_async, llArgs(password, salt, _N, _r, _p, _keyLength), callback);
+
+};
+
+function llArgs(password, salt, _N, _r, _p, _keyLength){
+
 	if (!(typeof password == 'string' || Buffer.isBuffer(password))){
 		throw new TypeError('password must either be a string or a buffer');
 	}
@@ -113,6 +161,5 @@ exports.crypto_pwhash_scryptsalsa208sha256_ll = function(password, salt, _N, _r,
 		}
 	}
 
-	return binding.crypto_pwhash_scryptsalsa208sha256_ll(passwordBuf, saltBuf, N, r, p, keyLength);
-
-};
+	return [passwordBuf, saltBuf, N, r, p, keyLength];
+}
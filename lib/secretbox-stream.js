@@ -0,0 +1,89 @@
+/* jslint node: true */
+'use strict';
+
+var binding = require('../build/Release/sodium');
+var Transform = require('stream').Transform;
+var util = require('util');
+
+/**
+ * Encrypt a stream in constant memory
+ *
+ * The input is cut into chunks of chunkSize bytes, each one encrypted with
+ * crypto_secretbox_easy by a native SecretboxStream. The output starts with a
+ * header (the nonce and the chunk size) and can only be decrypted whole and in
+ * order by a SecretBoxDecryptStream with the same key.
+ *
+ *     fs.createReadStream(path).pipe(new SecretBoxEncryptStream(key)).pipe(fs.createWriteStream(path + '.enc'));
+ *
+ * @param {Buffer} key          crypto_secretbox_KEYBYTES bytes
+ * @param {Object} [options]    options of the Transform stream, and chunkSize
+ *                              (default SecretboxStream.DEFAULT_CHUNKSIZE, 64 KiB)
+ * @constructor
+ */
+function SecretBoxEncryptStream(key, options) {
+    if( !(this instanceof SecretBoxEncryptStream) ) {
+        return new SecretBoxEncryptStream(key, options);
+    }
+    Transform.call(this, options);
+
+    this.state = new binding.SecretboxStream('encrypt', key, options && options.chunkSize);
+}
+util.inherits(SecretBoxEncryptStream, Transform);
+
+/**
+ * Decrypt a stream encrypted by SecretBoxEncryptStream
+ *
+ * Emits an error, and no data from the failing chunk on, if the stream was
+ * modified, reordered or truncated, or encrypted with another key. Data of the
+ * previous chunks has already been pushed by then: don't act on the output
+ * before the stream has ended without an error.
+ *
+ * @param {Buffer} key          crypto_secretbox_KEYBYTES bytes
+ * @param {Object} [options]    options of the Transform stream
+ * @constructor
+ */
+function SecretBoxDecryptStream(key, options) {
+    if( !(this instanceof SecretBoxDecryptStream) ) {
+        return new SecretBoxDecryptStream(key, options);
+    }
+    Transform.call(this, options);
+
+    this.state = new binding.SecretboxStream('decrypt', key);
+}
+util.inherits(SecretBoxDecryptStream, Transform);
+
+function transform(chunk, encoding, callback) {
+    var out;
+    try {
+        out = this.state.update(Buffer.isBuffer(chunk) ? chunk : new Buffer(chunk, encoding));
+    }
+    catch (e) {
+        return callback(e);
+    }
+    if (out.length > 0) {
+        this.push(out);
+    }
+    callback();
+}
+
+function flush(callback) {
+    var out;
+    try {
+        out = this.state.final();
+    }
+    catch (e) {
+        return callback(e);
+    }
+    if (out.length > 0) {
+        this.push(out);
+    }
+    callback();
+}
+
+SecretBoxEncryptStream.prototype._transform = transform;
+SecretBoxEncryptStream.prototype._flush = flush;
+SecretBoxDecryptStream.prototype._transform = transform;
+SecretBoxDecryptStream.prototype._flush = flush;
+
+module.exports.SecretBoxEncryptStream = SecretBoxEncryptStream;
+module.exports.SecretBoxDecryptStream = SecretBoxDecryptStream;
@@ -8,7 +8,7 @@
 
 var binding = require('../build/Release/sodium');
 var should = require('should');
-var toBuffer = require('./toBuffer');
+var toMessage = require('./toMessage');
 var SecretBoxKey = require('./keys/secretbox-key');
 var Nonce = require('./nonces/secretbox-nonce');
 
@@ -104,7 +104,7 @@ module.exports  = function SecretBox(secretKey, encoding) {
         // generate a new random nonce
         var nonce = new Nonce();
 
-        var buf = toBuffer(plainText, encoding);
+        var buf = toMessage(plainText, encoding);
 
         var cipherText = binding.crypto_secretbox(
             buf,
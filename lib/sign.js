@@ -8,7 +8,7 @@
 
 var binding = require('../build/Release/sodium');
 var SignKey = require('./keys/sign-key');
-var toBuffer = require('../lib/toBuffer');
+var toMessage = require('../lib/toMessage');
 
 
 /**
@@ -87,7 +87,7 @@ function Sign(key) {
     self.sign = function (message, encoding) {
         encoding = String(encoding) || self.defaultEncoding || 'utf8';
 
-        var buf = toBuffer(message, encoding);
+        var buf = toMessage(message, encoding);
 
         var signature = binding.crypto_sign(buf, self.iKey.sk().get());
         if( !signature ) {
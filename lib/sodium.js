@@ -34,6 +34,10 @@ var Pwhash = require('./pwhash');
 // File encryption
 var FileEncrypt = require('./file-encrypt');
 
+// Streams
+var HashStream = require('./hash-stream');
+var SecretBoxStream = require('./secretbox-stream');
+
 //Ed25519 -> Curve25519 translation
 var ECTranslation = require('./ed25519_to_curve25519');
 
@@ -153,6 +157,11 @@ module.exports.SecretBox = SecretBox;
 module.exports.Stream = Stream;
 module.exports.OneTimeAuth = OneTimeAuth;
 
+// Streams
+module.exports.HashStream = HashStream;
+module.exports.SecretBoxEncryptStream = SecretBoxStream.SecretBoxEncryptStream;
+module.exports.SecretBoxDecryptStream = SecretBoxStream.SecretBoxDecryptStream;
+
 // Nonces
 module.exports.Nonces = {
     Box: BoxNonce,
@@ -328,6 +337,9 @@ module.exports.Const.SecretBox = {
     /** Size of the Nonce used in encryption/decryption of messages */
     nonceBytes: binding.crypto_secretbox_NONCEBYTES,
 
+    /** SecretBox MAC size in bytes, as in crypto_secretbox_detached */
+    macBytes: binding.crypto_secretbox_MACBYTES,
+
     /** Passing of message. This implementation does message padding automatically */
     zeroBytes: binding.crypto_secretbox_ZEROBYTES,
 
@@ -3,7 +3,7 @@
 
 var binding = require('../build/Release/sodium');
 var StreamKey = require('./keys/stream-key');
-var toBuffer = require('./toBuffer');
+var toMessage = require('./toMessage');
 var Nonce = require('./nonces/stream-nonce');
 
 /**
@@ -74,7 +74,7 @@ module.exports = function Stream(secretKey, encoding) {
     self.encrypt = function(message, encoding) {
         encoding = encoding || self.defaultEncoding || 'utf8';
 
-        var messageBuf = toBuffer(message, encoding);
+        var messageBuf = toMessage(message, encoding);
 
         var nonce = new Nonce();
 
@@ -10,6 +10,49 @@
 /* jslint node: true */
 'use strict';
 
+var binding = require('../build/Release/sodium');
+
+/**
+ * Decode a base64 string in constant time. Like Buffer, accepts both the original and the
+ * URL safe alphabets, with or without padding
+ *
+ * @param {String} value    base64 string
+ * @returns {Buffer|undefined} undefined if value isn't valid base64
+ */
+function fromBase64(value) {
+    var padded = value.length % 4 === 0;
+    return binding.sodium_base642bin(value, padded ?
+            binding.sodium_base64_VARIANT_ORIGINAL : binding.sodium_base64_VARIANT_ORIGINAL_NO_PADDING) ||
+        binding.sodium_base642bin(value, padded ?
+            binding.sodium_base64_VARIANT_URLSAFE : binding.sodium_base64_VARIANT_URLSAFE_NO_PADDING);
+}
+
+/**
+ * Decode a hex or base64 string, in constant time when it is well formed.
+ *
+ * Base64 strings Buffer accepts but the strict decoder doesn't (wrapped PEM-style lines, padding
+ * that doesn't match the length, both alphabets mixed) are normalized and decoded again.
+ * What still isn't valid is decoded by Buffer, as it always was, so that no string that used
+ * to be accepted is rejected now.
+ *
+ * @param {String} value     hex or base64 string
+ * @param {String} encoding  'hex' or 'base64'
+ * @returns {Buffer}
+ */
+function decodeText(value, encoding) {
+    var decode = encoding === 'hex' ? binding.sodium_hex2bin : fromBase64;
+    var buf = decode(value);
+    if( buf ) {
+        return buf;
+    }
+
+    if( encoding === 'base64' ) {
+        // Buffer skips whitespace, and takes any padding and both alphabets
+        buf = fromBase64(value.replace(/\s+/g, '').replace(/=+$/, '').replace(/-/g, '+').replace(/_/g, '/'));
+    }
+    return buf || new Buffer(value, encoding);
+}
+
 /**
  * Convert value into a buffer
  *
@@ -25,6 +68,10 @@ function toBuffer(value, encoding) {
         encoding.should.have.type('string').match(/^(?:utf8|ascii|binary|hex|utf16le|ucs2|base64)$/);
 
         try {
+            // Keys, nonces and tokens are hex or base64: decode them without data dependent branches
+            if( encoding === 'hex' || encoding === 'base64' ) {
+                return decodeText(value, encoding);
+            }
             return new Buffer(value, encoding);
         }
         catch (e) {
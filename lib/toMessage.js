@@ -0,0 +1,25 @@
+/**
+ * toMessage Module
+ * Convert a message argument for the bindings
+ */
+/* jslint node: true */
+'use strict';
+
+var toBuffer = require('./toBuffer');
+
+/**
+ * Convert a message for the bindings. UTF-8 strings are passed as they are: the bindings encode
+ * them natively, without a temporary Buffer. Everything else goes through toBuffer
+ *
+ * @param {String|Buffer|Array} value  the message
+ * @param {String} [encoding]          encoding of value if it is a string. Defaults to 'hex'
+ * @returns {String|Buffer}
+ */
+function toMessage(value, encoding) {
+    if( typeof value === 'string' && (encoding === 'utf8' || encoding === 'utf-8') ) {
+        return value;
+    }
+    return toBuffer(value, encoding);
+}
+
+module.exports = toMessage;
@@ -0,0 +1,313 @@
+/**
+ * Chunked secretbox stream encryption
+ */
+#include <string.h>
+
+#include <node_buffer.h>
+
+#include "secretboxstream.h"
+#include "bytes.h"
+#include "classdata.h"
+#include "workerpool.h"
+
+using namespace v8;
+using namespace node;
+
+// Smallest amount of data worth handing to another thread
+#define SECRETBOX_STREAM_PARALLEL_BYTES (256 * 1024)
+
+// State of a Process call, shared by the ParallelFor ranges
+struct SecretboxChunkerRange {
+    const SecretboxChunker* chunker;
+    const unsigned char* in;
+    unsigned char* out;
+    std::vector<unsigned char> results;
+};
+
+SecretboxChunker::SecretboxChunker(Mode mode, const unsigned char* key)
+    : mode(mode), chunkSize(0), chunkNumber(0) {
+    memcpy(this->key, key, crypto_secretbox_KEYBYTES);
+    memset(nonce, 0, sizeof nonce);
+}
+
+SecretboxChunker::~SecretboxChunker() {
+    sodium_memzero(key, sizeof key);
+}
+
+void SecretboxChunker::NewHeader(unsigned char* header, uint32_t chunkSize) {
+    randombytes_buf(nonce, crypto_secretbox_NONCEBYTES);
+    this->chunkSize = chunkSize;
+    memcpy(header, nonce, crypto_secretbox_NONCEBYTES);
+    for (int i = 0; i < 4; i++) {
+        header[crypto_secretbox_NONCEBYTES + i] = (unsigned char) (chunkSize >> (8 * i));
+    }
+}
+
+bool SecretboxChunker::ReadHeader(const unsigned char* header) {
+    uint32_t size = 0;
+    for (int i = 0; i < 4; i++) {
+        size |= (uint32_t) header[crypto_secretbox_NONCEBYTES + i] << (8 * i);
+    }
+    if (size == 0 || size > MAX_CHUNK_SIZE) {
+        return false;
+    }
+    memcpy(nonce, header, crypto_secretbox_NONCEBYTES);
+    chunkSize = size;
+    return true;
+}
+
+size_t SecretboxChunker::InChunkSize() const {
+    return mode == ENCRYPT ? chunkSize : chunkSize + crypto_secretbox_MACBYTES;
+}
+
+size_t SecretboxChunker::OutChunkSize() const {
+    return mode == ENCRYPT ? chunkSize + crypto_secretbox_MACBYTES : chunkSize;
+}
+
+void SecretboxChunker::ChunkNonce(unsigned char* chunkNonce, unsigned long long number, bool last) const {
+    memcpy(chunkNonce, nonce, crypto_secretbox_NONCEBYTES);
+    for (int i = 0; i < 8; i++) {
+        chunkNonce[i] ^= (unsigned char) (number >> (8 * i));
+    }
+    if (last) {
+        chunkNonce[8] ^= 1;
+    }
+}
+
+void SecretboxChunker::ProcessRange(size_t begin, size_t end, void* data) {
+    SecretboxChunkerRange* range = static_cast<SecretboxChunkerRange*>(data);
+    const SecretboxChunker* chunker = range->chunker;
+    const size_t inChunk = chunker->InChunkSize();
+    const size_t outChunk = chunker->OutChunkSize();
+    unsigned char chunkNonce[crypto_secretbox_NONCEBYTES];
+
+    for (size_t i = begin; i < end; i++) {
+        chunker->ChunkNonce(chunkNonce, chunker->chunkNumber + i, false);
+        if (chunker->mode == ENCRYPT) {
+            crypto_secretbox_easy(range->out + i * outChunk, range->in + i * inChunk, inChunk, chunkNonce, chunker->key);
+            range->results[i] = 1;
+        } else {
+            range->results[i] = crypto_secretbox_open_easy(range->out + i * outChunk, range->in + i * inChunk, inChunk, chunkNonce, chunker->key) == 0;
+        }
+    }
+}
+
+bool SecretboxChunker::Process(const unsigned char* in, unsigned char* out, size_t count) {
+    SecretboxChunkerRange range;
+    range.chunker = this;
+    range.in = in;
+    range.out = out;
+    range.results.resize(count);
+
+    size_t grain = SECRETBOX_STREAM_PARALLEL_BYTES / chunkSize;
+    WorkerPool::ParallelFor(count, grain > 0 ? grain : 1, ProcessRange, &range);
+
+    for (size_t i = 0; i < count; i++) {
+        if (!range.results[i]) return false;
+    }
+    chunkNumber += count;
+    return true;
+}
+
+bool SecretboxChunker::ProcessLast(const unsigned char* in, size_t inLength, unsigned char* out) {
+    unsigned char chunkNonce[crypto_secretbox_NONCEBYTES];
+    ChunkNonce(chunkNonce, chunkNumber, true);
+    if (mode == ENCRYPT) {
+        crypto_secretbox_easy(out, in, inLength, chunkNonce, key);
+        return true;
+    }
+    return inLength >= crypto_secretbox_MACBYTES &&
+        crypto_secretbox_open_easy(out, in, inLength, chunkNonce, key) == 0;
+}
+
+SecretboxStream::SecretboxStream(SecretboxChunker::Mode mode, const unsigned char* key, uint32_t chunkSize)
+    : chunker(mode, key), headerBytes(0), finished(false) {
+    memset(header, 0, sizeof header);
+    if (mode == SecretboxChunker::ENCRYPT) {
+        chunker.NewHeader(header, chunkSize);
+        // Never reallocated afterwards: no copy of the plain text is left behind
+        pending.reserve(chunker.InChunkSize());
+    }
+}
+
+SecretboxStream::~SecretboxStream() {
+    if (!pending.empty()) {
+        sodium_memzero(&pending[0], pending.size());
+    }
+}
+
+NAN_MODULE_INIT(SecretboxStream::Init) {
+    ClassData* data = ClassData::New();
+    Local<FunctionTemplate> tpl = data->NewTemplate(New, "SecretboxStream", 1);
+
+    Nan::SetPrototypeMethod(tpl, "update", Update);
+    Nan::SetPrototypeMethod(tpl, "final", Final);
+
+    Local<Function> cons = data->Export(target, tpl);
+    Nan::Set(cons, Nan::New("HEADERBYTES").ToLocalChecked(), Nan::New<Integer>(SecretboxChunker::HEADER_BYTES));
+    Nan::Set(cons, Nan::New("DEFAULT_CHUNKSIZE").ToLocalChecked(), Nan::New<Integer>(SecretboxChunker::DEFAULT_CHUNK_SIZE));
+    Nan::Set(cons, Nan::New("MAX_CHUNKSIZE").ToLocalChecked(), Nan::New<Integer>(SecretboxChunker::MAX_CHUNK_SIZE));
+}
+
+/*
+* new SecretboxStream(mode, key [, chunkSize])
+* mode: 'encrypt' or 'decrypt'. chunkSize: encryption only, read from the header when decrypting
+*/
+NAN_METHOD(SecretboxStream::New) {
+    if (ClassData::ForwardPlainCall(info, 3)) {
+        return;
+    }
+
+    Nan::Utf8String modeName(info[0]);
+    SecretboxChunker::Mode mode;
+    if (*modeName != NULL && strcmp(*modeName, "encrypt") == 0) {
+        mode = SecretboxChunker::ENCRYPT;
+    } else if (*modeName != NULL && strcmp(*modeName, "decrypt") == 0) {
+        mode = SecretboxChunker::DECRYPT;
+    } else {
+        return Nan::ThrowTypeError("mode must be 'encrypt' or 'decrypt'");
+    }
+
+    unsigned char* key;
+    size_t keyLength;
+    if (info.Length() < 2 || !get_bytes(info[1], &key, &keyLength) || keyLength != crypto_secretbox_KEYBYTES) {
+        return Nan::ThrowTypeError("argument key must be a crypto_secretbox_KEYBYTES bytes buffer");
+    }
+
+    uint32_t chunkSize = SecretboxChunker::DEFAULT_CHUNK_SIZE;
+    if (mode == SecretboxChunker::ENCRYPT && info.Length() > 2 && !info[2]->IsUndefined()) {
+        if (!info[2]->IsUint32() || info[2]->Uint32Value() == 0 || info[2]->Uint32Value() > SecretboxChunker::MAX_CHUNK_SIZE) {
+            return Nan::ThrowRangeError("chunkSize must be an integer between 1 and SecretboxStream.MAX_CHUNKSIZE");
+        }
+        chunkSize = info[2]->Uint32Value();
+    }
+
+    SecretboxStream* stream = new SecretboxStream(mode, key, chunkSize);
+    stream->Wrap(info.This());
+    info.GetReturnValue().Set(info.This());
+}
+
+/*
+* update(data)
+* Returns the output of the whole chunks completed by data (the header too, on the first encryption call).
+* When decrypting, throws if a chunk doesn't authenticate
+*/
+NAN_METHOD(SecretboxStream::Update) {
+    SecretboxStream* stream = ObjectWrap::Unwrap<SecretboxStream>(info.This());
+    if (stream->finished) {
+        return Nan::ThrowError("the stream has been finalized");
+    }
+    unsigned char* data;
+    size_t inLength;
+    if (info.Length() < 1 || !get_bytes(info[0], &data, &inLength)) {
+        return Nan::ThrowTypeError("argument data must be a buffer, a typed array or an ArrayBuffer");
+    }
+    const unsigned char* in = data;
+    SecretboxChunker& chunker = stream->chunker;
+    const size_t headerSize = SecretboxChunker::HEADER_BYTES;
+
+    size_t headerOut = 0;
+    if (chunker.GetMode() == SecretboxChunker::DECRYPT && stream->headerBytes < headerSize) {
+        size_t take = headerSize - stream->headerBytes < inLength ? headerSize - stream->headerBytes : inLength;
+        memcpy(stream->header + stream->headerBytes, in, take);
+        stream->headerBytes += take;
+        in += take;
+        inLength -= take;
+        if (stream->headerBytes < headerSize) {
+            return info.GetReturnValue().Set(Nan::NewBuffer(0).ToLocalChecked());
+        }
+        if (!chunker.ReadHeader(stream->header)) {
+            stream->finished = true;
+            return Nan::ThrowError("invalid stream header");
+        }
+        stream->pending.reserve(chunker.InChunkSize());
+    } else if (chunker.GetMode() == SecretboxChunker::ENCRYPT && stream->headerBytes == 0) {
+        headerOut = headerSize;
+    }
+
+    const size_t inChunk = chunker.InChunkSize();
+    const size_t outChunk = chunker.OutChunkSize();
+    const size_t chunks = (stream->pending.size() + inLength) / inChunk;
+
+    Local<Object> outBuf = Nan::NewBuffer(headerOut + chunks * outChunk).ToLocalChecked();
+    unsigned char* out = (unsigned char*) Buffer::Data(outBuf);
+    if (headerOut > 0) {
+        memcpy(out, stream->header, headerSize);
+        out += headerSize;
+        stream->headerBytes = headerSize;
+    }
+
+    // Complete the pending chunk first, then process the whole chunks of data where they are
+    size_t done = 0;
+    bool ok = true;
+    if (chunks > 0 && !stream->pending.empty()) {
+        size_t take = inChunk - stream->pending.size();
+        stream->pending.insert(stream->pending.end(), in, in + take);
+        in += take;
+        inLength -= take;
+        ok = chunker.Process(&stream->pending[0], out, 1);
+        sodium_memzero(&stream->pending[0], stream->pending.size());
+        stream->pending.clear();
+        done = 1;
+    }
+    if (ok && chunks > done) {
+        ok = chunker.Process(in, out + done * outChunk, chunks - done);
+        in += (chunks - done) * inChunk;
+        inLength -= (chunks - done) * inChunk;
+    }
+    if (!ok) {
+        // Don't hand out unauthenticated data
+        sodium_memzero(Buffer::Data(outBuf), Buffer::Length(outBuf));
+        stream->finished = true;
+        return Nan::ThrowError("chunk failed to authenticate: the stream is corrupted, reordered or was encrypted with another key");
+    }
+
+    stream->pending.insert(stream->pending.end(), in, in + inLength);
+    info.GetReturnValue().Set(outBuf);
+}
+
+/*
+* final()
+* Returns the output of the last chunk (and of the header, if update() was never called when encrypting).
+* When decrypting, throws if the stream is truncated or the last chunk doesn't authenticate
+*/
+NAN_METHOD(SecretboxStream::Final) {
+    SecretboxStream* stream = ObjectWrap::Unwrap<SecretboxStream>(info.This());
+    if (stream->finished) {
+        return Nan::ThrowError("the stream has been finalized");
+    }
+    stream->finished = true;
+
+    SecretboxChunker& chunker = stream->chunker;
+    const size_t headerSize = SecretboxChunker::HEADER_BYTES;
+    // Any valid pointer will do for an empty last chunk
+    const unsigned char* in = stream->pending.empty() ? stream->header : &stream->pending[0];
+    const size_t inLength = stream->pending.size();
+
+    if (chunker.GetMode() == SecretboxChunker::DECRYPT) {
+        if (stream->headerBytes < headerSize || inLength < crypto_secretbox_MACBYTES) {
+            return Nan::ThrowError("the stream is truncated");
+        }
+        Local<Object> plainText = Nan::NewBuffer(inLength - crypto_secretbox_MACBYTES).ToLocalChecked();
+        if (!chunker.ProcessLast(in, inLength, (unsigned char*) Buffer::Data(plainText))) {
+            return Nan::ThrowError("last chunk failed to authenticate: the stream is corrupted or truncated");
+        }
+        sodium_memzero(&stream->pending[0], inLength);
+        stream->pending.clear();
+        return info.GetReturnValue().Set(plainText);
+    }
+
+    const size_t headerOut = stream->headerBytes == 0 ? headerSize : 0;
+    Local<Object> outBuf = Nan::NewBuffer(headerOut + inLength + crypto_secretbox_MACBYTES).ToLocalChecked();
+    unsigned char* out = (unsigned char*) Buffer::Data(outBuf);
+    if (headerOut > 0) {
+        memcpy(out, stream->header, headerSize);
+        stream->headerBytes = headerSize;
+    }
+    chunker.ProcessLast(in, inLength, out + headerOut);
+    if (inLength > 0) {
+        sodium_memzero(&stream->pending[0], inLength);
+    }
+    stream->pending.clear();
+    info.GetReturnValue().Set(outBuf);
+}
@@ -0,0 +1,107 @@
+#ifndef SECRETBOXSTREAM_H
+#define SECRETBOXSTREAM_H
+
+#include <vector>
+
+#include <node.h>
+#include <nan.h>
+
+#include "sodium.h"
+
+/**
+ * Chunked authenticated encryption of a stream with crypto_secretbox_easy.
+ *
+ * Format: a header (a random nonce and the chunk size, a uint32 little endian),
+ * then the chunks, each one crypto_secretbox_easy of chunkSize bytes of the plain
+ * text. The last chunk is always shorter (0 to chunkSize - 1 bytes), so that it is
+ * known to be the last one without looking ahead.
+ *
+ * The nonce of a chunk is the header nonce XOR its number (uint64 little endian,
+ * bytes 0-7), and XOR 1 on byte 8 for the last chunk. Reordered, dropped or
+ * duplicated chunks fail to authenticate; a stream truncated after a chunk
+ * boundary is missing its last chunk. Either way decryption fails.
+ *
+ * SecretboxChunker does the chunks crypto and doesn't use V8, so that it can run on
+ * a worker thread (the streaming file encryption does). Whole chunks are processed
+ * on the worker pool threads (WorkerPool::ParallelFor).
+ */
+class SecretboxChunker {
+public:
+    enum Mode {
+        ENCRYPT,
+        DECRYPT
+    };
+
+    enum {
+        HEADER_BYTES = crypto_secretbox_NONCEBYTES + 4,
+        DEFAULT_CHUNK_SIZE = 64 * 1024,
+        // Bounds the memory a decrypted header can make us allocate
+        MAX_CHUNK_SIZE = 16 * 1024 * 1024
+    };
+
+    SecretboxChunker(Mode mode, const unsigned char* key);
+    ~SecretboxChunker();
+
+    Mode GetMode() const { return mode; }
+
+    // Encryption: draws the nonce, and writes the header of a stream of chunkSize bytes chunks
+    void NewHeader(unsigned char* header, uint32_t chunkSize);
+
+    // Decryption: reads the header. Returns false if its chunk size isn't valid
+    bool ReadHeader(const unsigned char* header);
+
+    // Size of the input and output of a whole chunk
+    size_t InChunkSize() const;
+    size_t OutChunkSize() const;
+
+    // Encrypts or decrypts the next count whole chunks from in to out.
+    // Returns false if one doesn't authenticate
+    bool Process(const unsigned char* in, unsigned char* out, size_t count);
+
+    // Encrypts or decrypts the last chunk, inLength < InChunkSize() bytes, to out
+    // (inLength + crypto_secretbox_MACBYTES bytes when encrypting, inLength - crypto_secretbox_MACBYTES
+    // when decrypting). Returns false if it is too short or doesn't authenticate
+    bool ProcessLast(const unsigned char* in, size_t inLength, unsigned char* out);
+
+private:
+    void ChunkNonce(unsigned char* nonce, unsigned long long number, bool last) const;
+    static void ProcessRange(size_t begin, size_t end, void* data);
+
+    Mode mode;
+    unsigned char key[crypto_secretbox_KEYBYTES];
+    unsigned char nonce[crypto_secretbox_NONCEBYTES];
+    uint32_t chunkSize;
+    unsigned long long chunkNumber;
+};
+
+/**
+ * SecretboxChunker as a JS object, fed with buffers of any size:
+ *
+ *   var stream = new SecretboxStream('encrypt', key [, chunkSize]);   // or 'decrypt', key
+ *   out1 = stream.update(in1); out2 = stream.update(in2); ...
+ *   outLast = stream.final();
+ *
+ * The partial chunk of each update() is kept for the next call.
+ */
+class SecretboxStream : public node::ObjectWrap {
+public:
+    static NAN_MODULE_INIT(Init);
+
+private:
+    SecretboxStream(SecretboxChunker::Mode mode, const unsigned char* key, uint32_t chunkSize);
+    ~SecretboxStream();
+
+    SecretboxChunker chunker;
+    unsigned char header[SecretboxChunker::HEADER_BYTES];
+    // Encryption: whether the header has been output. Decryption: header bytes received
+    size_t headerBytes;
+    // Partial chunk, until the next update() or final()
+    std::vector<unsigned char> pending;
+    bool finished;
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Update);
+    static NAN_METHOD(Final);
+};
+
+#endif
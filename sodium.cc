@@ -8,6 +8,7 @@
 #include <node.h>
 #include <node_buffer.h>
 
+#include <cmath>
 #include <cstdlib>
 #include <ctime>
 #include <cstring>
@@ -15,28 +16,37 @@
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <new>
+
+#include <fcntl.h>
 
 #include <nan.h>
 
 #include "sodium.h"
 
+#include "bytes.h"
 #include "keyring.h"
+#include "workerpool.h"
+#include "codecs.h"
+#include "hashstate.h"
+#include "secretboxstream.h"
 
 using namespace node;
 using namespace v8;
 
+// No per-isolate handles are kept at file scope: the module is context-aware and
+// may be loaded in several worker_threads at the same time.
 
-//Get the handle to the global object
-Local<Object> globalObj = Nan::GetCurrentContext()->Global();
-
-//Get the buffer constructor function
-Local<Function> bufferConstructor = Local<Function>::Cast(globalObj->Get(Nan::New<String>("Buffer").ToLocalChecked()));
-
-// Check if a function argument is a node Buffer. If not throw V8 exception
-#define ARG_IS_BUFFER(i,msg) \
-    if (!Buffer::HasInstance(info[i])) { \
+// Get the bytes of a function argument in NAME ## _data and NAME ## _length (see get_bytes).
+// If it has none throw V8 exception
+#define GET_ARG_BYTES(i, NAME) \
+    unsigned char* NAME ## _data = 0; \
+    size_t NAME ## _length = 0; \
+    if (!get_bytes(info[i], &NAME ## _data, &NAME ## _length)) { \
         std::ostringstream oss; \
-        oss << "argument " << msg << " must be a buffer"; \
+        oss << "argument " << #NAME << " must be a buffer, a typed array or an ArrayBuffer"; \
         return Nan::ThrowError(oss.str().c_str()); \
     }
 
@@ -44,10 +54,229 @@ Local<Function> bufferConstructor = Local<Function>::Cast(globalObj->Get(Nan::Ne
     Local<Object> name = Nan::NewBuffer(size).ToLocalChecked(); \
     unsigned char* name ## _ptr = (unsigned char*)Buffer::Data(name);
 
+/*
+* Result slab. Small results that are not secret (one-time MACs, box and secretbox MACs, signatures,
+* short hashes) are carved out of a shared ArrayBuffer, as Node does for small Buffers, instead of one
+* malloc and one external memory update each. A slab is freed by the GC once no result refers to it
+* anymore, and is not wiped.
+* As with Node's pool, result.buffer is the whole slab: never use it for anything that may be key
+* material. Keys, plain texts, hashes and HMACs (which callers derive keys from, see lib/ecdh.js)
+* always get their own allocation (NEW_BUFFER_AND_PTR), freed and not shared.
+*
+* One slab state per thread, hence per isolate: it is kept in thread local storage.
+*/
+#define RESULT_SLAB_SIZE 8192
+#define RESULT_SLAB_MAX_ITEM 256
+#define RESULT_SLAB_ALIGN 8
+
+struct ResultSlab {
+    Nan::Persistent<ArrayBuffer> buffer;
+    // Bytes of the current slab already carved
+    size_t used;
+    bool enabled;
+    unsigned long long slabs;
+    unsigned long long results;
+};
+
+static uv_once_t resultSlabOnce = UV_ONCE_INIT;
+static uv_key_t resultSlabKey;
+
+static void result_slab_create_key() {
+    uv_key_create(&resultSlabKey);
+}
+
+static ResultSlab* result_slab() {
+    return static_cast<ResultSlab*>(uv_key_get(&resultSlabKey));
+}
+
+static void result_slab_delete(void* arg) {
+    ResultSlab* slab = static_cast<ResultSlab*>(arg);
+    slab->buffer.Reset();
+    uv_key_set(&resultSlabKey, 0);
+    delete slab;
+}
+
+static void result_slab_init() {
+    uv_once(&resultSlabOnce, result_slab_create_key);
+    if (result_slab() != 0) return;
+
+    ResultSlab* slab = new ResultSlab();
+    slab->used = RESULT_SLAB_SIZE;
+    slab->enabled = true;
+    slab->slabs = 0;
+    slab->results = 0;
+    uv_key_set(&resultSlabKey, slab);
+#ifdef SODIUM_HAS_CLEANUP_HOOKS
+    node::AddEnvironmentCleanupHook(v8::Isolate::GetCurrent(), result_slab_delete, slab);
+#endif
+}
+
+// A Buffer of size bytes for a non secret result, from the slab when small enough
+static Local<Object> new_result_buffer(size_t size) {
+    ResultSlab* slab = result_slab();
+    if (slab == 0 || !slab->enabled || size > RESULT_SLAB_MAX_ITEM) {
+        return Nan::NewBuffer(size).ToLocalChecked();
+    }
+
+    v8::Isolate* isolate = v8::Isolate::GetCurrent();
+    if (slab->used + size > RESULT_SLAB_SIZE) {
+        Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate, RESULT_SLAB_SIZE);
+        slab->buffer.Reset(buffer);
+        slab->used = 0;
+        slab->slabs++;
+    }
+
+    Local<Object> result = Buffer::New(isolate, Nan::New(slab->buffer), slab->used, size).ToLocalChecked();
+    slab->used += (size + RESULT_SLAB_ALIGN - 1) & ~((size_t) RESULT_SLAB_ALIGN - 1);
+    slab->results++;
+    return result;
+}
+
+// Same as NEW_BUFFER_AND_PTR, for small non secret results (see new_result_buffer)
+#define NEW_RESULT_BUFFER_AND_PTR(name, size) \
+    Local<Object> name = new_result_buffer(size); \
+    unsigned char* name ## _ptr = (unsigned char*)Buffer::Data(name);
+
+/*
+* String message arguments. The core bindings take messages as JS strings too: they are encoded to
+* UTF-8 (as Buffer does) in a scratch buffer of the current thread, instead of a temporary Buffer
+* allocated by the JS wrapper. The scratch buffer is wiped after each call, and freed when a large
+* message made it grow beyond MESSAGE_SCRATCH_KEEP bytes.
+*/
+#define MESSAGE_SCRATCH_KEEP (1024 * 1024)
+// Strings up to this many UTF-16 code units are encoded without measuring them first: 3 bytes per unit at most
+#define MESSAGE_SCRATCH_NO_MEASURE (16 * 1024)
+
+struct MessageScratch {
+    unsigned char* data;
+    size_t capacity;
+    // Only one message argument per call, but be safe
+    bool inUse;
+};
+
+static uv_once_t messageScratchOnce = UV_ONCE_INIT;
+static uv_key_t messageScratchKey;
+
+static void message_scratch_create_key() {
+    uv_key_create(&messageScratchKey);
+}
+
+static MessageScratch* message_scratch() {
+    return static_cast<MessageScratch*>(uv_key_get(&messageScratchKey));
+}
+
+static void message_scratch_delete(void* arg) {
+    MessageScratch* scratch = static_cast<MessageScratch*>(arg);
+    free(scratch->data);
+    uv_key_set(&messageScratchKey, 0);
+    delete scratch;
+}
+
+static void message_scratch_init() {
+    uv_once(&messageScratchOnce, message_scratch_create_key);
+    if (message_scratch() != 0) return;
+
+    MessageScratch* scratch = new MessageScratch();
+    scratch->data = 0;
+    scratch->capacity = 0;
+    scratch->inUse = false;
+    uv_key_set(&messageScratchKey, scratch);
+#ifdef SODIUM_HAS_CLEANUP_HOOKS
+    node::AddEnvironmentCleanupHook(v8::Isolate::GetCurrent(), message_scratch_delete, scratch);
+#endif
+}
+
+/*
+* Bytes of a message argument: binary arguments as get_bytes, strings encoded to UTF-8.
+* Must live until the end of the call: it owns the encoded string
+*/
+class MessageArg {
+public:
+    unsigned char* data;
+    size_t length;
+
+    MessageArg() : data(0), length(0), scratch(0), owned(0) {}
+
+    ~MessageArg() {
+        if (scratch != 0) {
+            sodium_memzero(scratch->data, length);
+            if (scratch->capacity > MESSAGE_SCRATCH_KEEP) {
+                free(scratch->data);
+                scratch->data = 0;
+                scratch->capacity = 0;
+            }
+            scratch->inUse = false;
+        } else if (owned != 0) {
+            sodium_memzero(owned, length);
+            free(owned);
+        }
+    }
+
+    // Returns false if arg is neither binary nor a string, or it couldn't be encoded
+    bool Get(Local<Value> arg) {
+        if (get_bytes(arg, &data, &length)) return true;
+        if (!arg->IsString()) return false;
+
+        Local<String> str = arg.As<String>();
+        size_t units = str->Length();
+        if (units == 0) {
+            data = (unsigned char*) "";
+            return true;
+        }
+        size_t needed = units <= MESSAGE_SCRATCH_NO_MEASURE ? units * 3 : (size_t) Nan::DecodeBytes(str, Nan::UTF8);
+        unsigned char* buffer = Reserve(needed);
+        if (buffer == 0) return false;
+
+        ssize_t written = Nan::DecodeWrite((char*) buffer, needed, str, Nan::UTF8);
+        data = buffer;
+        length = written > 0 ? (size_t) written : 0;
+        return true;
+    }
+
+private:
+    MessageScratch* scratch;
+    unsigned char* owned;
+
+    unsigned char* Reserve(size_t size) {
+        MessageScratch* threadScratch = message_scratch();
+        if (threadScratch != 0 && !threadScratch->inUse) {
+            if (threadScratch->capacity < size) {
+                // Wiped at the end of the previous call
+                free(threadScratch->data);
+                threadScratch->data = (unsigned char*) malloc(size);
+                threadScratch->capacity = threadScratch->data != 0 ? size : 0;
+            }
+            if (threadScratch->data != 0) {
+                threadScratch->inUse = true;
+                scratch = threadScratch;
+                return threadScratch->data;
+            }
+        }
+        owned = (unsigned char*) malloc(size);
+        return owned;
+    }
+};
+
+// Same as GET_ARG_AS_UCHAR, for the message arguments: also accepts a string (see MessageArg)
+#define GET_ARG_MESSAGE(i, NAME) \
+    MessageArg NAME ## _arg; \
+    if (!NAME ## _arg.Get(info[i])) { \
+        std::ostringstream oss; \
+        oss << "argument " << #NAME << " must be a string, a buffer, a typed array or an ArrayBuffer"; \
+        return Nan::ThrowError(oss.str().c_str()); \
+    } \
+    unsigned char* NAME = NAME ## _arg.data; \
+    unsigned long long NAME ## _size = NAME ## _arg.length; \
+    if( NAME ## _size == 0 ) { \
+        std::ostringstream oss; \
+        oss << "argument " << #NAME << " length cannot be zero" ; \
+        return Nan::ThrowError(oss.str().c_str()); \
+    }
+
 #define GET_ARG_AS(i, NAME, TYPE) \
-    ARG_IS_BUFFER(i,#NAME); \
-    TYPE NAME = (TYPE) Buffer::Data(info[i]->ToObject()); \
-    unsigned long long NAME ## _size = Buffer::Length(info[i]->ToObject()); \
+    GET_ARG_BYTES(i, NAME); \
+    TYPE NAME = (TYPE) NAME ## _data; \
+    unsigned long long NAME ## _size = NAME ## _length; \
     if( NAME ## _size == 0 ) { \
         std::ostringstream oss; \
         oss << "argument " << #NAME << " length cannot be zero" ; \
@@ -80,12 +309,27 @@ Local<Function> bufferConstructor = Local<Function>::Cast(globalObj->Get(Nan::Ne
         return Nan::ThrowError(message);          \
     }
 
-#define TO_REAL_BUFFER(slowBuffer, actualBuffer) \
-    Handle<Value> constructorArgs ## slowBuffer[3] =\
-        { slowBuffer->handle_, \
-          Nan::New<Integer>(Buffer::Length(slowBuffer)), \
-          Nan::New<Integer>(0) }; \
-    Local<Object> actualBuffer = bufferConstructor->NewInstance(3, constructorArgs ## slowBuffer);
+// Get a caller supplied output buffer (info[i]) and the offset to write at (info[i + 1]), for the _into bindings.
+// NAME ## _ptr points at the offset. Throws if SIZE bytes don't fit after it
+#define GET_OUTPUT_ARG(i, NAME, SIZE) \
+    GET_ARG_BYTES(i, NAME); \
+    if (!info[(i) + 1]->IsUint32()) { \
+        return Nan::ThrowTypeError("argument offset must be a positive integer"); \
+    } \
+    size_t NAME ## _offset = info[(i) + 1]->Uint32Value(); \
+    if (NAME ## _offset > NAME ## _length || NAME ## _length - NAME ## _offset < (SIZE)) { \
+        std::ostringstream oss; \
+        oss << "argument " << #NAME << " must have at least " << (SIZE) << " bytes available after offset"; \
+        return Nan::ThrowRangeError(oss.str().c_str()); \
+    } \
+    unsigned char* NAME ## _ptr = NAME ## _data + NAME ## _offset;
+
+// Get the last argument as a callback, for the asynchronous bindings
+#define GET_CALLBACK_LAST(NAME) \
+    if (info.Length() == 0 || !info[info.Length() - 1]->IsFunction()) { \
+        return Nan::ThrowTypeError("the last argument must be a callback function"); \
+    } \
+    Nan::Callback* NAME = new Nan::Callback(info[info.Length() - 1].As<Function>());
 
 //Helper function
 /*static Handle<Value> V8Exception(const char* msg) {
@@ -111,6 +355,48 @@ NAN_METHOD(bind_sodium_library_version_major) {
     return info.GetReturnValue().Set(Nan::New(sodium_library_version_major()));
 }
 
+/**
+ * Counters of the addon's crypto worker pool
+ * Returns { threads, queued, active, completed, parallelTasks }
+ */
+NAN_METHOD(bind_sodium_pool_stats) {
+    Nan::EscapableHandleScope scope;
+
+    WorkerPool::Stats stats = WorkerPool::GetStats();
+    Local<Object> result = Nan::New<Object>();
+    Nan::Set(result, Nan::New<String>("threads").ToLocalChecked(), Nan::New<Uint32>(stats.threads));
+    Nan::Set(result, Nan::New<String>("queued").ToLocalChecked(), Nan::New<Uint32>(stats.queued));
+    Nan::Set(result, Nan::New<String>("active").ToLocalChecked(), Nan::New<Uint32>(stats.active));
+    Nan::Set(result, Nan::New<String>("completed").ToLocalChecked(), Nan::New<Number>((double) stats.completed));
+    Nan::Set(result, Nan::New<String>("parallelTasks").ToLocalChecked(), Nan::New<Number>((double) stats.parallelTasks));
+
+    return info.GetReturnValue().Set(result);
+}
+
+/**
+ * Result slab of the current thread (see new_result_buffer)
+ * Boolean enabled, optional: turns the slab on or off
+ * Returns { enabled, slabs, results }: the slabs allocated, and the results carved out of them
+ */
+NAN_METHOD(bind_sodium_result_slab) {
+    Nan::EscapableHandleScope scope;
+
+    ResultSlab* slab = result_slab();
+    if (slab == 0) {
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+    if (info.Length() > 0 && !info[0]->IsUndefined()) {
+        slab->enabled = info[0]->BooleanValue();
+    }
+
+    Local<Object> result = Nan::New<Object>();
+    Nan::Set(result, Nan::New<String>("enabled").ToLocalChecked(), Nan::New<Boolean>(slab->enabled));
+    Nan::Set(result, Nan::New<String>("slabs").ToLocalChecked(), Nan::New<Number>((double) slab->slabs));
+    Nan::Set(result, Nan::New<String>("results").ToLocalChecked(), Nan::New<Number>((double) slab->results));
+
+    return info.GetReturnValue().Set(result);
+}
+
 // Lib Sodium Utils
 NAN_METHOD(bind_memzero) {
     Nan::EscapableHandleScope scope;
@@ -150,13 +436,210 @@ NAN_METHOD(bind_memcmp) {
     return info.GetReturnValue().Set(Nan::New<Integer>(sodium_memcmp(buffer1, buffer2, size)));
 }
 
+// Hex and base64 codecs. Constant time, unlike Buffer.toString() and Buffer.from(), see codecs.h
+
+// Values of the constants of later libsodium versions, that don't exist in 1.0.0
+#ifndef sodium_base64_VARIANT_ORIGINAL
+#define sodium_base64_VARIANT_ORIGINAL 1
+#define sodium_base64_VARIANT_ORIGINAL_NO_PADDING 3
+#define sodium_base64_VARIANT_URLSAFE 5
+#define sodium_base64_VARIANT_URLSAFE_NO_PADDING 7
+#endif
+
+// Get the input of a decoder: a string, or bytes holding its characters.
+// Non ASCII characters of strings are converted to UTF-8 bytes, which the decoders reject
+#define GET_ARG_TEXT(i, NAME) \
+    Nan::Utf8String NAME ## _string(info[i]->IsString() ? info[i] : Local<Value>(Nan::EmptyString())); \
+    const char* NAME ## _chars = ""; \
+    size_t NAME ## _length = 0; \
+    if (info[i]->IsString()) { \
+        if (*NAME ## _string != NULL) { \
+            NAME ## _chars = *NAME ## _string; \
+            NAME ## _length = NAME ## _string.length(); \
+        } \
+    } else { \
+        unsigned char* NAME ## _bytes; \
+        if (!get_bytes(info[i], &NAME ## _bytes, &NAME ## _length)) { \
+            return Nan::ThrowTypeError("argument " #NAME " must be a string or a buffer"); \
+        } \
+        NAME ## _chars = (const char*) NAME ## _bytes; \
+    }
+
+// Optional base64 variant argument, sodium_base64_VARIANT_ORIGINAL by default
+#define GET_ARG_BASE64_VARIANT(i, NAME) \
+    Codecs::Base64Variant NAME = Codecs::BASE64_ORIGINAL; \
+    if (info.Length() > (i) && !info[i]->IsUndefined()) { \
+        if (!info[i]->IsInt32() || !Codecs::IsBase64Variant(info[i]->Int32Value())) { \
+            return Nan::ThrowTypeError("argument variant must be one of the sodium_base64_VARIANT_ constants"); \
+        } \
+        NAME = (Codecs::Base64Variant) info[i]->Int32Value(); \
+    }
+
+// Run ENCODE with chars pointing to LENGTH characters, and return them as a string.
+// Small outputs are encoded on the stack; the copy is wiped either way, the input may be a key
+#define RETURN_ENCODED_STRING(LENGTH, ENCODE) \
+    size_t chars_length = (LENGTH); \
+    if (chars_length > (size_t) String::kMaxLength) { \
+        return Nan::ThrowRangeError("the encoded string would be too long"); \
+    } \
+    char chars_stack[1024]; \
+    std::vector<char> chars_heap(chars_length > sizeof chars_stack ? chars_length : 0); \
+    char* chars = chars_length > sizeof chars_stack ? &chars_heap[0] : chars_stack; \
+    ENCODE; \
+    Local<String> encoded = Nan::NewOneByteString((const uint8_t*) chars, (int) chars_length).ToLocalChecked(); \
+    sodium_memzero(chars, chars_length); \
+    return info.GetReturnValue().Set(encoded);
+
 /**
- * char *sodium_bin2hex(char * const hex, const size_t hexlen,
- *                    const unsigned char *bin, const size_t binlen);
+ * sodium_bin2hex(bin)
+ * Returns the lowercase hex string of bin
  */
 NAN_METHOD(bind_sodium_bin2hex) {
     Nan::EscapableHandleScope scope;
-    return Nan::ThrowError("use node's native Buffer.toString()");
+
+    NUMBER_OF_MANDATORY_ARGS(1, "argument bin must be a buffer");
+    GET_ARG_BYTES(0, bin);
+
+    RETURN_ENCODED_STRING(bin_length * 2, Codecs::HexEncode(chars, bin_data, bin_length));
+}
+
+/**
+ * sodium_bin2hex_into(out, offset, bin)
+ * Writes the hex characters of bin to out. Returns their number
+ */
+NAN_METHOD(bind_sodium_bin2hex_into) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3, "arguments out, offset and bin are mandatory");
+    GET_ARG_BYTES(2, bin);
+    GET_OUTPUT_ARG(0, out, bin_length * 2);
+
+    Codecs::HexEncode((char*) out_ptr, bin_data, bin_length);
+    return info.GetReturnValue().Set(Nan::New<Uint32>((uint32_t) (bin_length * 2)));
+}
+
+/**
+ * sodium_hex2bin(hex)
+ * Returns a buffer, or undefined if hex has an odd length or holds a character that isn't a hex digit
+ */
+NAN_METHOD(bind_sodium_hex2bin) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(1, "argument hex must be a string or a buffer");
+    GET_ARG_TEXT(0, hex);
+
+    if (hex_length % 2 != 0) {
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+    NEW_BUFFER_AND_PTR(bin, hex_length / 2);
+
+    if (Codecs::HexDecode(bin_ptr, hex_chars, hex_length)) {
+        return info.GetReturnValue().Set(bin);
+    } else {
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+}
+
+/**
+ * sodium_hex2bin_into(out, offset, hex)
+ * Returns the number of bytes written, or undefined if hex isn't valid; the region of out is zeroed then
+ */
+NAN_METHOD(bind_sodium_hex2bin_into) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3, "arguments out, offset and hex are mandatory");
+    GET_ARG_TEXT(2, hex);
+
+    if (hex_length % 2 != 0) {
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+    GET_OUTPUT_ARG(0, out, hex_length / 2);
+
+    if (Codecs::HexDecode(out_ptr, hex_chars, hex_length)) {
+        return info.GetReturnValue().Set(Nan::New<Uint32>((uint32_t) (hex_length / 2)));
+    } else {
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+}
+
+/**
+ * sodium_bin2base64(bin [, variant])
+ * Returns the base64 string of bin
+ */
+NAN_METHOD(bind_sodium_bin2base64) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(1, "argument bin must be a buffer");
+    GET_ARG_BYTES(0, bin);
+    GET_ARG_BASE64_VARIANT(1, variant);
+
+    RETURN_ENCODED_STRING(Codecs::Base64EncodedLength(bin_length, variant),
+        Codecs::Base64Encode(chars, bin_data, bin_length, variant));
+}
+
+/**
+ * sodium_bin2base64_into(out, offset, bin [, variant])
+ * Writes the base64 characters of bin to out. Returns their number
+ */
+NAN_METHOD(bind_sodium_bin2base64_into) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3, "arguments out, offset and bin are mandatory");
+    GET_ARG_BYTES(2, bin);
+    GET_ARG_BASE64_VARIANT(3, variant);
+    size_t b64_length = Codecs::Base64EncodedLength(bin_length, variant);
+    GET_OUTPUT_ARG(0, out, b64_length);
+
+    Codecs::Base64Encode((char*) out_ptr, bin_data, bin_length, variant);
+    return info.GetReturnValue().Set(Nan::New<Uint32>((uint32_t) b64_length));
+}
+
+/**
+ * sodium_base642bin(b64 [, variant])
+ * Returns a buffer, or undefined if b64 isn't valid for the variant
+ */
+NAN_METHOD(bind_sodium_base642bin) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(1, "argument b64 must be a string or a buffer");
+    GET_ARG_TEXT(0, b64);
+    GET_ARG_BASE64_VARIANT(1, variant);
+
+    size_t bin_length = Codecs::Base64DecodedLength(b64_chars, b64_length, variant);
+    if (bin_length == (size_t) -1) {
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+    NEW_BUFFER_AND_PTR(bin, bin_length);
+
+    if (Codecs::Base64Decode(bin_ptr, b64_chars, b64_length, variant)) {
+        return info.GetReturnValue().Set(bin);
+    } else {
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+}
+
+/**
+ * sodium_base642bin_into(out, offset, b64 [, variant])
+ * Returns the number of bytes written, or undefined if b64 isn't valid; the region of out is zeroed then
+ */
+NAN_METHOD(bind_sodium_base642bin_into) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3, "arguments out, offset and b64 are mandatory");
+    GET_ARG_TEXT(2, b64);
+    GET_ARG_BASE64_VARIANT(3, variant);
+
+    size_t bin_length = Codecs::Base64DecodedLength(b64_chars, b64_length, variant);
+    if (bin_length == (size_t) -1) {
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+    GET_OUTPUT_ARG(0, out, bin_length);
+
+    if (Codecs::Base64Decode(out_ptr, b64_chars, b64_length, variant)) {
+        return info.GetReturnValue().Set(Nan::New<Uint32>((uint32_t) bin_length));
+    } else {
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
 }
 
 // Lib Sodium Random
@@ -263,10 +746,10 @@ NAN_METHOD(bind_crypto_shorthash) {
 
     NUMBER_OF_MANDATORY_ARGS(1,"argument message must be a buffer");
 
-    GET_ARG_AS_UCHAR(0,message);
+    GET_ARG_MESSAGE(0, message);
     GET_ARG_AS_UCHAR_LEN(1, key, crypto_shorthash_KEYBYTES);
 
-    NEW_BUFFER_AND_PTR(hash, crypto_shorthash_BYTES);
+    NEW_RESULT_BUFFER_AND_PTR(hash, crypto_shorthash_BYTES);
 
     if( crypto_shorthash(hash_ptr, message, message_size, key) == 0 ) {
         return info.GetReturnValue().Set(hash);
@@ -286,7 +769,7 @@ NAN_METHOD(bind_crypto_hash) {
 
     NUMBER_OF_MANDATORY_ARGS(1,"argument message must be a buffer");
 
-    GET_ARG_AS_UCHAR(0,msg);
+    GET_ARG_MESSAGE(0, msg);
 
     NEW_BUFFER_AND_PTR(hash, crypto_hash_BYTES);
 
@@ -297,6 +780,25 @@ NAN_METHOD(bind_crypto_hash) {
     }
 }
 
+/**
+ * Same as crypto_hash, but writes the crypto_hash_BYTES hash in out at offset
+ * instead of allocating a buffer. Returns the number of bytes written
+ */
+NAN_METHOD(bind_crypto_hash_into) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3,"arguments out, offset and message are mandatory");
+
+    GET_ARG_MESSAGE(2, msg);
+    GET_OUTPUT_ARG(0, out, crypto_hash_BYTES);
+
+    if( crypto_hash(out_ptr, msg, msg_size) == 0 ) {
+        return info.GetReturnValue().Set(Nan::New<Uint32>(crypto_hash_BYTES));
+    } else {
+        return info.GetReturnValue().Set(Nan::Null());
+    }
+}
+
 /**
  * int crypto_hash_sha256(
  *    unsigned char * hbuf,
@@ -307,7 +809,7 @@ NAN_METHOD(bind_crypto_hash_sha256) {
     Nan::EscapableHandleScope scope;
 
     NUMBER_OF_MANDATORY_ARGS(1,"argument message must be a buffer");
-    GET_ARG_AS_UCHAR(0, msg);
+    GET_ARG_MESSAGE(0, msg);
     NEW_BUFFER_AND_PTR(hash, 32);
 
     if( crypto_hash_sha256(hash_ptr, msg, msg_size) == 0 ) {
@@ -317,6 +819,23 @@ NAN_METHOD(bind_crypto_hash_sha256) {
     }
 }
 
+/**
+ * Same as crypto_hash_sha256, writing the hash in out at offset
+ */
+NAN_METHOD(bind_crypto_hash_sha256_into) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3,"arguments out, offset and message are mandatory");
+    GET_ARG_MESSAGE(2, msg);
+    GET_OUTPUT_ARG(0, out, crypto_hash_sha256_BYTES);
+
+    if( crypto_hash_sha256(out_ptr, msg, msg_size) == 0 ) {
+        return info.GetReturnValue().Set(Nan::New<Uint32>(crypto_hash_sha256_BYTES));
+    } else {
+        return info.GetReturnValue().Set(Nan::Null());
+    }
+}
+
 /**
  * int crypto_hash_sha512(
  *    unsigned char * hbuf,
@@ -328,7 +847,7 @@ NAN_METHOD(bind_crypto_hash_sha512) {
 
     NUMBER_OF_MANDATORY_ARGS(1,"argument message must be a buffer");
 
-    GET_ARG_AS_UCHAR(0, msg);
+    GET_ARG_MESSAGE(0, msg);
 
     NEW_BUFFER_AND_PTR(hash, 64);
 
@@ -340,505 +859,1268 @@ NAN_METHOD(bind_crypto_hash_sha512) {
 }
 
 /**
-* int crypto_pwhash_scryptsalsa208sha256(unsigned char * const out,
-*                                      unsigned long long outlen,
-*                                      const char * const passwd,
-*                                      unsigned long long passwdlen,
-*                                      const unsigned char * const salt,
-*                                      unsigned long long opslimit,
-*                                      size_t memlimit);
-*/
-NAN_METHOD(bind_crypto_pwhash_scryptsalsa208sha256) {
+ * Same as crypto_hash_sha512, writing the hash in out at offset
+ */
+NAN_METHOD(bind_crypto_hash_sha512_into) {
     Nan::EscapableHandleScope scope;
 
-    NUMBER_OF_MANDATORY_ARGS(3, "arguments password and salt must be buffers; keyLength, opslimit and memlimit must be integers");
-
-    GET_ARG_AS_UCHAR(0, password);
-    GET_ARG_AS_UCHAR_LEN(1, salt, crypto_pwhash_scryptsalsa208sha256_SALTBYTES);
+    NUMBER_OF_MANDATORY_ARGS(3,"arguments out, offset and message are mandatory");
+    GET_ARG_MESSAGE(2, msg);
+    GET_OUTPUT_ARG(0, out, crypto_hash_sha512_BYTES);
 
-    unsigned int keyLength = 32;
-    unsigned long long opslimit = crypto_pwhash_scryptsalsa208sha256_OPSLIMIT_INTERACTIVE;
-    size_t memlimit = crypto_pwhash_scryptsalsa208sha256_MEMLIMIT_INTERACTIVE;
+    if( crypto_hash_sha512(out_ptr, msg, msg_size) == 0 ) {
+        return info.GetReturnValue().Set(Nan::New<Uint32>(crypto_hash_sha512_BYTES));
+    } else {
+        return info.GetReturnValue().Set(Nan::Null());
+    }
+}
 
+/**
+ * Reads the optional keyLength, opslimit and memlimit arguments of
+ * crypto_pwhash_scryptsalsa208sha256 (info[2] to info[4]). Arguments at or
+ * after index argc are ignored, so that the async variant can keep its
+ * callback last. Returns false when a JS exception has been thrown.
+ */
+static bool get_pwhash_args(NAN_METHOD_ARGS_TYPE info, int argc, unsigned int* keyLength, unsigned long long* opslimit, size_t* memlimit) {
     //Get the key length parameter
-    if (info.Length() >= 3 && !(info[2]->IsUndefined() || info[2]->IsNull())){
+    if (argc >= 3 && !(info[2]->IsUndefined() || info[2]->IsNull())){
         if (!info[2]->IsNumber()){
             Nan::ThrowTypeError("when defined, keyLength must be a positive integer");
-            return info.GetReturnValue().Set(Nan::Undefined());
+            return false;
         } else {
             int keyLengthArg = info[2]->Int32Value();
             //Check parameter value
             if (keyLengthArg <= 0){
                 Nan::ThrowRangeError("when defined, keyLength must be a positive integer");
-                return info.GetReturnValue().Set(Nan::Undefined());
+                return false;
             }
-            keyLength = (unsigned int) keyLengthArg;
+            *keyLength = (unsigned int) keyLengthArg;
         }
     }
 
     //Get the opslimit parameter
-    if (info.Length() >= 4 && !(info[3]->IsUndefined() || info[3]->IsNull())){
+    if (argc >= 4 && !(info[3]->IsUndefined() || info[3]->IsNull())){
         if (!info[3]->IsNumber()){
             Nan::ThrowTypeError("when defined, opslimit must be a positive integer");
-            return info.GetReturnValue().Set(Nan::Undefined());
+            return false;
         } else {
             long long opslimitArg = info[3]->IntegerValue();
             //Check parameter value
             if (opslimitArg <= 0){
                 Nan::ThrowRangeError("when defined, opslimit must be a positive integer");
-                return info.GetReturnValue().Set(Nan::Undefined());
+                return false;
             }
-            opslimit = opslimitArg;
+            *opslimit = opslimitArg;
         }
     }
 
     //Get the memlimit parameter
-    if (info.Length() >= 5 && !(info[4]->IsUndefined() || info[4]->IsNull())){
+    if (argc >= 5 && !(info[4]->IsUndefined() || info[4]->IsNull())){
         if (!info[4]->IsNumber()){
             Nan::ThrowTypeError("when defined, memlimit must be a positive integer");
-            return info.GetReturnValue().Set(Nan::Undefined());
+            return false;
         } else {
-            size_t memlimitArg = info[4]->IntegerValue();
+            long long memlimitArg = info[4]->IntegerValue();
             //Check parameter value
             if (memlimitArg <= 0){
                 Nan::ThrowRangeError("when defined, memlimit must be a positive integer");
-                return info.GetReturnValue().Set(Nan::Undefined());
+                return false;
             }
-            memlimit = memlimitArg;
+            *memlimit = (size_t) memlimitArg;
         }
     }
-
-    NEW_BUFFER_AND_PTR(key, keyLength);
-
-    if (crypto_pwhash_scryptsalsa208sha256(key_ptr, keyLength, (char*) password, password_size, salt, opslimit, memlimit) != 0){
-        Nan::ThrowError("out of memory");
-        return info.GetReturnValue().Set(Nan::Undefined());
-    }
-    return info.GetReturnValue().Set(key);
-
+    return true;
 }
 
 /**
-* int crypto_pwhash_scryptsalsa208sha256_ll(const uint8_t * passwd, size_t passwdlen,
-*                                      const uint8_t * salt, size_t saltlen,
-*                                      uint64_t N, uint32_t r, uint32_t p,
-*                                      uint8_t * buf, size_t buflen)
-*/
-NAN_METHOD(bind_crypto_pwhash_scryptsalsa208sha256_ll){
-    Nan::EscapableHandleScope scope;
-    // scrypt(pass, salt, opsLimit, r, p, keyLength)
-    NUMBER_OF_MANDATORY_ARGS(2, "arguments password and salt must be a buffers");
-
-    unsigned long long N = crypto_pwhash_scryptsalsa208sha256_OPSLIMIT_INTERACTIVE;
-    unsigned int r = 8;
-    unsigned int p = 1;
-    unsigned int keyLength = 32;
-
-    GET_ARG_AS_UCHAR(0, password);
-    GET_ARG_AS_UCHAR(1, salt);
-
-    if (info.Length() >= 3 && !(info[2]->IsUndefined() || info[2]->IsNull())){
+ * Reads the optional N, r, p and keyLength arguments of
+ * crypto_pwhash_scryptsalsa208sha256_ll (info[2] to info[5]). Same conventions
+ * as get_pwhash_args.
+ */
+static bool get_pwhash_ll_args(NAN_METHOD_ARGS_TYPE info, int argc, unsigned long long* N, unsigned int* r, unsigned int* p, unsigned int* keyLength) {
+    if (argc >= 3 && !(info[2]->IsUndefined() || info[2]->IsNull())){
         if (!info[2]->IsNumber()){
             Nan::ThrowTypeError("when defined, N must be a positive number");
-            return info.GetReturnValue().Set(Nan::Undefined());
+            return false;
         } else {
             long long nArg = (long long) info[2]->IntegerValue();
             if (nArg <= 0){
                 Nan::ThrowRangeError("when defined, N must be a positive number");
-                return info.GetReturnValue().Set(Nan::Undefined());
+                return false;
             }
-            N = (unsigned long long) nArg;
+            *N = (unsigned long long) nArg;
         }
     }
 
-    if (info.Length() >= 4 && !(info[3]->IsUndefined() || info[3]->IsNull())){
+    if (argc >= 4 && !(info[3]->IsUndefined() || info[3]->IsNull())){
         if (!info[3]->IsNumber()){
             Nan::ThrowTypeError("when defined, r must be a positive integer");
-            return info.GetReturnValue().Set(Nan::Undefined());
+            return false;
         } else {
             int rArg = info[3]->Int32Value();
             if (rArg <= 0){
                 Nan::ThrowRangeError("when defined, r must be a positive integer");
-                return info.GetReturnValue().Set(Nan::Undefined());
+                return false;
             }
-            r = (unsigned int) rArg;
+            *r = (unsigned int) rArg;
         }
     }
 
-    if (info.Length() >= 5 && !(info[4]->IsUndefined() || info[4]->IsNull())){
+    if (argc >= 5 && !(info[4]->IsUndefined() || info[4]->IsNull())){
         if (!info[4]->IsNumber()){
             Nan::ThrowTypeError("when defined, p must be a positive integer");
-            return info.GetReturnValue().Set(Nan::Undefined());
+            return false;
         } else {
             int pArg = info[4]->Int32Value();
             if (pArg <= 0){
                 Nan::ThrowRangeError("when defined, p must be a positive integer");
-                return info.GetReturnValue().Set(Nan::Undefined());
+                return false;
             }
-            p = (unsigned int) pArg;
+            *p = (unsigned int) pArg;
         }
     }
 
-    if (info.Length() >= 6 && !(info[5]->IsUndefined() || info[5]->IsNull())){
+    if (argc >= 6 && !(info[5]->IsUndefined() || info[5]->IsNull())){
         if (!info[5]->IsNumber()){
             Nan::ThrowTypeError("when defined, keyLength must be a positive integer");
-            return info.GetReturnValue().Set(Nan::Undefined());
+            return false;
         } else {
             int keyLengthArg = info[5]->Int32Value();
             if (keyLengthArg <= 0){
                 Nan::ThrowRangeError("when defined, keyLength must be a positive integer");
-                return info.GetReturnValue().Set(Nan::Undefined());
+                return false;
             }
-            keyLength = (unsigned int) keyLengthArg;
+            *keyLength = (unsigned int) keyLengthArg;
         }
     }
-
-    NEW_BUFFER_AND_PTR(key, keyLength);
-
-    if (crypto_pwhash_scryptsalsa208sha256_ll(password, password_size, salt, salt_size, N, r, p, key_ptr, keyLength) != 0){
-        Nan::ThrowError("out of memory");
-        return info.GetReturnValue().Set(Nan::Undefined());
-    }
-    return info.GetReturnValue().Set(key);
-
+    return true;
 }
 
 /**
- * Password based file encryption with ease of use. scrypt + secretbox. Same format as for encrypted key files produced by KeyRing.save
- * Buffer fileContent
- * Buffer password
- * String filename //Transform it back into a string
- * Function callback
- *
- */
-NAN_METHOD(pw_file_encrypt){
+* int crypto_pwhash_scryptsalsa208sha256(unsigned char * const out,
+*                                      unsigned long long outlen,
+*                                      const char * const passwd,
+*                                      unsigned long long passwdlen,
+*                                      const unsigned char * const salt,
+*                                      unsigned long long opslimit,
+*                                      size_t memlimit);
+*/
+NAN_METHOD(bind_crypto_pwhash_scryptsalsa208sha256) {
     Nan::EscapableHandleScope scope;
 
-    NUMBER_OF_MANDATORY_ARGS(3, "arguments fileContent, password and filename can't be null");
+    NUMBER_OF_MANDATORY_ARGS(3, "arguments password and salt must be buffers; keyLength, opslimit and memlimit must be integers");
 
-    if (info.Length() > 3){
-        if (!info[3]->IsFunction()){
-            Nan::ThrowTypeError("When defined, callback must be a function");
-            return info.GetReturnValue().Set(Nan::Undefined());
+    GET_ARG_AS_UCHAR(0, password);
+    GET_ARG_AS_UCHAR_LEN(1, salt, crypto_pwhash_scryptsalsa208sha256_SALTBYTES);
+
+    unsigned int keyLength = 32;
+    unsigned long long opslimit = crypto_pwhash_scryptsalsa208sha256_OPSLIMIT_INTERACTIVE;
+    size_t memlimit = crypto_pwhash_scryptsalsa208sha256_MEMLIMIT_INTERACTIVE;
+
+    if (!get_pwhash_args(info, info.Length(), &keyLength, &opslimit, &memlimit)){
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+
+    NEW_BUFFER_AND_PTR(key, keyLength);
+
+    if (crypto_pwhash_scryptsalsa208sha256(key_ptr, keyLength, (char*) password, password_size, salt, opslimit, memlimit) != 0){
+        Nan::ThrowError("out of memory");
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+    return info.GetReturnValue().Set(key);
+
+}
+
+/**
+* int crypto_pwhash_scryptsalsa208sha256_ll(const uint8_t * passwd, size_t passwdlen,
+*                                      const uint8_t * salt, size_t saltlen,
+*                                      uint64_t N, uint32_t r, uint32_t p,
+*                                      uint8_t * buf, size_t buflen)
+*/
+NAN_METHOD(bind_crypto_pwhash_scryptsalsa208sha256_ll){
+    Nan::EscapableHandleScope scope;
+    // scrypt(pass, salt, opsLimit, r, p, keyLength)
+    NUMBER_OF_MANDATORY_ARGS(2, "arguments password and salt must be a buffers");
+
+    unsigned long long N = crypto_pwhash_scryptsalsa208sha256_OPSLIMIT_INTERACTIVE;
+    unsigned int r = 8;
+    unsigned int p = 1;
+    unsigned int keyLength = 32;
+
+    GET_ARG_AS_UCHAR(0, password);
+    GET_ARG_AS_UCHAR(1, salt);
+
+    if (!get_pwhash_ll_args(info, info.Length(), &N, &r, &p, &keyLength)){
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+
+    NEW_BUFFER_AND_PTR(key, keyLength);
+
+    if (crypto_pwhash_scryptsalsa208sha256_ll(password, password_size, salt, salt_size, N, r, p, key_ptr, keyLength) != 0){
+        Nan::ThrowError("out of memory");
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+    return info.GetReturnValue().Set(key);
+
+}
+
+/**
+ * Runs one scrypt derivation off the main thread. The password and salt are
+ * copied when the worker is created, so the caller is free to reuse or wipe
+ * its buffers as soon as the binding returns. Copies and the derived key are
+ * zeroed before being released.
+ */
+class PwhashWorker : public Nan::AsyncWorker {
+public:
+    PwhashWorker(Nan::Callback* callback, bool lowLevel,
+                 const unsigned char* password, size_t passwordSize,
+                 const unsigned char* salt, size_t saltSize,
+                 unsigned int keyLength, unsigned long long opslimit, size_t memlimit,
+                 unsigned int r, unsigned int p)
+        : Nan::AsyncWorker(callback), lowLevel(lowLevel),
+          passwordSize(passwordSize), saltSize(saltSize), keyLength(keyLength),
+          opslimit(opslimit), memlimit(memlimit), r(r), p(p), key(0) {
+        this->password = new unsigned char[passwordSize];
+        memcpy(this->password, password, passwordSize);
+        this->salt = new unsigned char[saltSize];
+        memcpy(this->salt, salt, saltSize);
+    }
+
+    ~PwhashWorker() {
+        sodium_memzero(password, passwordSize);
+        sodium_memzero(salt, saltSize);
+        delete[] password;
+        delete[] salt;
+        if (key != 0) {
+            sodium_memzero(key, keyLength);
+            free(key);
         }
     }
 
-    GET_ARG_AS_UCHAR(0, fileContent);
-    GET_ARG_AS_UCHAR(1, password);
-    String::Utf8Value filenameVal(info[2]);
-    std::string filename(*filenameVal);
+    void Execute() {
+        key = (unsigned char*) malloc(keyLength);
+        if (key == 0) {
+            SetErrorMessage("out of memory");
+            return;
+        }
+
+        int result;
+        if (lowLevel) {
+            result = crypto_pwhash_scryptsalsa208sha256_ll(password, passwordSize, salt, saltSize, opslimit, r, p, key, keyLength);
+        } else {
+            result = crypto_pwhash_scryptsalsa208sha256(key, keyLength, (char*) password, passwordSize, salt, opslimit, memlimit);
+        }
+        if (result != 0) {
+            SetErrorMessage("out of memory");
+        }
+    }
+
+    void HandleOKCallback() {
+        Nan::HandleScope scope;
+
+        // The new buffer takes ownership of key
+        Local<Value> argv[] = { Nan::Null(), Nan::NewBuffer((char*) key, keyLength).ToLocalChecked() };
+        key = 0;
+        callback->Call(2, argv);
+    }
+
+private:
+    bool lowLevel;
+    unsigned char* password;
+    size_t passwordSize;
+    unsigned char* salt;
+    size_t saltSize;
+    unsigned int keyLength;
+    unsigned long long opslimit;
+    size_t memlimit;
+    unsigned int r;
+    unsigned int p;
+    unsigned char* key;
+};
+
+/**
+ * Asynchronous version of crypto_pwhash_scryptsalsa208sha256.
+ * Same arguments, followed by Function callback(err, key)
+ */
+NAN_METHOD(bind_crypto_pwhash_scryptsalsa208sha256_async) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3, "arguments password and salt must be buffers; keyLength, opslimit and memlimit must be integers; callback must be a function");
+
+    GET_ARG_AS_UCHAR(0, password);
+    GET_ARG_AS_UCHAR_LEN(1, salt, crypto_pwhash_scryptsalsa208sha256_SALTBYTES);
+
+    unsigned int keyLength = 32;
+    unsigned long long opslimit = crypto_pwhash_scryptsalsa208sha256_OPSLIMIT_INTERACTIVE;
+    size_t memlimit = crypto_pwhash_scryptsalsa208sha256_MEMLIMIT_INTERACTIVE;
+
+    if (!get_pwhash_args(info, info.Length() - 1, &keyLength, &opslimit, &memlimit)){
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+
+    GET_CALLBACK_LAST(callback);
+
+    WorkerPool::QueueWorker(new PwhashWorker(callback, false, password, password_size, salt, salt_size, keyLength, opslimit, memlimit, 0, 0));
+    return info.GetReturnValue().Set(Nan::Undefined());
+}
+
+/**
+ * Asynchronous version of crypto_pwhash_scryptsalsa208sha256_ll.
+ * Same arguments, followed by Function callback(err, key)
+ */
+NAN_METHOD(bind_crypto_pwhash_scryptsalsa208sha256_ll_async) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3, "arguments password and salt must be buffers; callback must be a function");
+
+    unsigned long long N = crypto_pwhash_scryptsalsa208sha256_OPSLIMIT_INTERACTIVE;
+    unsigned int r = 8;
+    unsigned int p = 1;
+    unsigned int keyLength = 32;
+
+    GET_ARG_AS_UCHAR(0, password);
+    GET_ARG_AS_UCHAR(1, salt);
+
+    if (!get_pwhash_ll_args(info, info.Length() - 1, &N, &r, &p, &keyLength)){
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+
+    GET_CALLBACK_LAST(callback);
 
-    //std::string filename((char*)filenameBuffer, filenameBuffer_size);
+    WorkerPool::QueueWorker(new PwhashWorker(callback, true, password, password_size, salt, salt_size, keyLength, N, 0, r, p));
+    return info.GetReturnValue().Set(Nan::Undefined());
+}
+
+/**
+ * Creates the missing parent directories of path, as mkdir -p. Doesn't use V8, so it runs on
+ * the worker thread of the asynchronous calls. Best effort: if a directory can't be created,
+ * opening the file fails and reports it.
+ */
+static void make_parent_dirs(std::string const& path){
+    for (size_t i = path.find_first_of("/\\", 1); i != std::string::npos; i = path.find_first_of("/\\", i + 1)){
+        uv_fs_t req;
+        uv_fs_mkdir(NULL, &req, path.substr(0, i).c_str(), 0777, NULL);
+        uv_fs_req_cleanup(&req);
+    }
+}
+
+// Whether path is a regular file
+static bool is_file(std::string const& path){
+    uv_fs_t req;
+    int result = uv_fs_stat(NULL, &req, path.c_str(), NULL);
+    bool file = result == 0 && (req.statbuf.st_mode & S_IFMT) == S_IFREG;
+    uv_fs_req_cleanup(&req);
+    return file;
+}
+
+/* Encrypted file format. Numbers are in big endian
+* 2 bytes : r (unsigned short)
+* 2 bytes : p (unsigned short)
+* 8 bytes : opsLimit (unsigned long)
+* 2 bytes: salt size (sn, unsigned short)
+* 2 bytes : nonce size (ss, unsigned short)
+* 4 bytes : encrypted content size (x, unsigned long)
+* sn bytes: salt
+* ss bytes : nonce
+* x bytes : encrypted content
+*/
+#define FILE_HEADER_BYTES 20
+
+/**
+ * Encrypts content with a key derived from password, and writes the result
+ * into filename, creating its missing parent directories. Doesn't use V8, so
+ * it can run on a worker thread. Throws a runtime_error* on failure.
+ */
+static void file_encrypt(std::string const& filename, const unsigned char* content, size_t contentSize, const unsigned char* password, size_t passwordSize){
     unsigned int r = 8;
     unsigned int p = 1;
     unsigned long long opsLimit = 16384;
     unsigned short saltSize = 8;
     unsigned short nonceSize = crypto_secretbox_NONCEBYTES;
 
-    std::fstream fileWriter(filename.c_str(), std::ios::out | std::ios::trunc);
+    if (contentSize > 0xffffffffULL - crypto_secretbox_MACBYTES){
+        throw new std::range_error("fileContent is too large for this file format");
+    }
+    unsigned int contentBufferSize = contentSize + crypto_secretbox_MACBYTES;
 
+    unsigned char header[FILE_HEADER_BYTES];
     //Writing r
-    fileWriter << (unsigned char) (r >> 8);
-    fileWriter << (unsigned char) r;
+    header[0] = (unsigned char) (r >> 8);
+    header[1] = (unsigned char) r;
     //Writing p
-    fileWriter << (unsigned char) (p >> 8);
-    fileWriter << (unsigned char) p;
+    header[2] = (unsigned char) (p >> 8);
+    header[3] = (unsigned char) p;
     //Writing opsLimit
-    for (unsigned short i = 8; i > 0; i--){
-        fileWriter << (unsigned char) (opsLimit >> (8 * (i - 1)));
+    for (unsigned short i = 0; i < 8; i++){
+        header[4 + i] = (unsigned char) (opsLimit >> (8 * (7 - i)));
     }
     //Writing saltSize
-    fileWriter << (unsigned char) (saltSize >> 8);
-    fileWriter << (unsigned char) saltSize;
+    header[12] = (unsigned char) (saltSize >> 8);
+    header[13] = (unsigned char) saltSize;
     //Writing nonceSize
-    fileWriter << (unsigned char) (nonceSize >> 8);
-    fileWriter << (unsigned char) nonceSize;
+    header[14] = (unsigned char) (nonceSize >> 8);
+    header[15] = (unsigned char) nonceSize;
     //Writing content size
-    unsigned int contentBufferSize = fileContent_size + crypto_secretbox_MACBYTES;
-    for (unsigned short i = 4; i > 0; i--){
-        fileWriter << (unsigned char) (contentBufferSize >> (8 * (i - 1)));
+    for (unsigned short i = 0; i < 4; i++){
+        header[16 + i] = (unsigned char) (contentBufferSize >> (8 * (3 - i)));
     }
-    //Generate salt and write it
-    unsigned char* salt = new unsigned char[saltSize];
+
+    //Generate salt and nonce
+    unsigned char salt[8];
     randombytes_buf(salt, saltSize);
-    for (unsigned short i = 0; i < saltSize; i++) fileWriter << ((unsigned char) salt[i]);
-    //Generate nonce and write it
-    unsigned char* nonce = new unsigned char[nonceSize];
+    unsigned char nonce[crypto_secretbox_NONCEBYTES];
     randombytes_buf(nonce, nonceSize);
-    for (unsigned short i = 0; i < nonceSize; i++) fileWriter << ((unsigned char) nonce[i]);
-    //Derive password into key
-    unsigned short derivedKeySize = crypto_secretbox_KEYBYTES;
-    unsigned char* derivedKey = new unsigned char[derivedKeySize];
-    crypto_pwhash_scryptsalsa208sha256_ll(password, password_size, salt, saltSize, opsLimit, r, p, derivedKey, derivedKeySize);
 
-    //Encrypt fileContent and write it
-    unsigned char* encryptedContent = new unsigned char[contentBufferSize];
-    crypto_secretbox_easy(encryptedContent, fileContent, fileContent_size, nonce, derivedKey);
-    for (unsigned long i = 0; i < contentBufferSize; i++){
-        fileWriter << ((unsigned char) encryptedContent[i]);
+    //Derive password into key
+    unsigned char derivedKey[crypto_secretbox_KEYBYTES];
+    if (crypto_pwhash_scryptsalsa208sha256_ll(password, passwordSize, salt, saltSize, opsLimit, r, p, derivedKey, crypto_secretbox_KEYBYTES) != 0){
+        sodium_memzero(derivedKey, crypto_secretbox_KEYBYTES);
+        throw new std::runtime_error("out of memory");
     }
 
-    //Close and clean up
+    //Encrypt fileContent
+    unsigned char* encryptedContent = new (std::nothrow) unsigned char[contentBufferSize];
+    if (encryptedContent == 0){
+        sodium_memzero(derivedKey, crypto_secretbox_KEYBYTES);
+        throw new std::runtime_error("out of memory");
+    }
+    crypto_secretbox_easy(encryptedContent, content, contentSize, nonce, derivedKey);
+    sodium_memzero(derivedKey, crypto_secretbox_KEYBYTES);
+
+    //Write header, salt, nonce and encrypted content
+    make_parent_dirs(filename);
+    std::fstream fileWriter(filename.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+    fileWriter.write((const char*) header, FILE_HEADER_BYTES);
+    fileWriter.write((const char*) salt, saltSize);
+    fileWriter.write((const char*) nonce, nonceSize);
+    fileWriter.write((const char*) encryptedContent, contentBufferSize);
+    bool writeFailed = !fileWriter.good();
     fileWriter.close();
 
-    sodium_memzero(salt, saltSize);
-    sodium_memzero(nonce, nonceSize);
-    sodium_memzero(derivedKey, derivedKeySize);
-    sodium_memzero(encryptedContent, contentBufferSize);
-
-    delete salt;
-    delete nonce;
-    delete derivedKey;
-    delete encryptedContent;
-
-    salt = 0;
-    nonce = 0;
-    derivedKey = 0;
-    encryptedContent = 0;
+    delete[] encryptedContent;
 
-    //Either callback or return undefined
-    if (info.Length() > 3){
-        Local<Function> callback = info[3].As<Function>();
-        const int argc = 0;
-        Local<Value> argv[argc];
-        Nan::MakeCallback(globalObj, callback, argc, argv);
+    if (writeFailed){
+        throw new std::runtime_error("Error while writing the encrypted file");
     }
-    return info.GetReturnValue().Set(Nan::Undefined());
 }
 
 /**
- * Password based file decryption with ease of use. scrypt + secretbox. Same format as for encrypted key files produced by KeyRing.save
- * String filename
- * Buffer password
- * Function callback
- *
+ * Reads and decrypts a file produced by file_encrypt. Doesn't use V8, so it
+ * can run on a worker thread. On success, *plaintext is a malloc'd buffer of
+ * *plaintextSize bytes that belongs to the caller.
+ * Throws an invalid_argument* (invalid file), a range_error* (invalid header
+ * values) or a runtime_error* (wrong password, I/O error) on failure.
  */
-NAN_METHOD(pw_file_decrypt){
-    Nan::EscapableHandleScope scope;
-    //Local<Object> globalObj = Context::GetCurrent()->Global();
-
-    //Local<Value> err;
-    //const int argc = 2;
-
-    NUMBER_OF_MANDATORY_ARGS(2, "arguments filename and password must be defined");
+static void file_decrypt(std::string const& filename, const unsigned char* password, size_t passwordSize, unsigned char** plaintext, size_t* plaintextSize){
+    const unsigned long opsLimitBeforeException = 4194304;
 
-    if (info.Length() > 2){
-        if (!info[2]->IsFunction()){
-            Nan::ThrowTypeError("When defined, callback must be a function");
-            return info.GetReturnValue().Set(Nan::Undefined());
-        }
+    if (!is_file(filename)){
+        throw new std::runtime_error("file cannot be found");
     }
-
-    //GET_ARG_AS_UCHAR(0, filename);
-    String::Utf8Value filenameVal(info[0]);
-    std::string filename(*filenameVal);
-    GET_ARG_AS_UCHAR(1, password);
-
-    std::fstream fileReader(filename.c_str(), std::ios::in);
-    std::string fileString = "";
-    std::filebuf* fileBuffer = fileReader.rdbuf();
-    while (fileBuffer->in_avail() > 0){
-        fileString += (char) fileBuffer->sbumpc();
+    std::ifstream fileReader(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!fileReader.good()){
+        throw new std::runtime_error("file cannot be opened");
     }
-    fileReader.close();
-
-    std::stringstream fileStringStream(fileString);
-    std::stringbuf* buf = fileStringStream.rdbuf();
-
-    /* Encrypted file format. Numbers are in big endian
-    * 2 bytes : r (unsigned short)
-    * 2 bytes : p (unsigned short)
-    * 8 bytes : opsLimit (unsigned long)
-    * 2 bytes: salt size (sn, unsigned short)
-    * 2 bytes : nonce size (ss, unsigned short)
-    * 4 bytes : key buffer size (x, unsigned long)
-    * sn bytes: salt
-    * ss bytes : nonce
-    * x bytes : encrypted key buffer
-    */
-
-    //Variable that will be used to check the size of the file; that it corresponds to what the file is supposed to contain.
-    //With this technique, trying to avoid buffer overflows and potential RCEs that might come with them
-    unsigned short minRemainingSize = 20; //16 bytes from the above description + 4 bytes of the MAC of the encrypted key buffer
-    const unsigned long opsLimitBeforeException = 4194304;
-
-    if (buf->in_avail() < minRemainingSize){
-        Nan::ThrowTypeError("Invalid file format");
-        return info.GetReturnValue().Set(Nan::Undefined());
+    fileReader.seekg(0, std::ios::end);
+    std::streamoff fileSize = fileReader.tellg();
+    fileReader.seekg(0, std::ios::beg);
+
+    //Checking the size of the file against what it is supposed to contain,
+    //to avoid buffer overflows and potential RCEs that might come with them
+    if (fileSize < FILE_HEADER_BYTES){
+        throw new std::invalid_argument("Invalid file format");
     }
 
-    //Reading r
-    unsigned short r;
-    r = ((unsigned short) buf->sbumpc()) << 8;
-    r += (unsigned short) buf->sbumpc();
-    minRemainingSize -= 2;
+    unsigned char header[FILE_HEADER_BYTES];
+    fileReader.read((char*) header, FILE_HEADER_BYTES);
 
-    //Reading p
-    unsigned short p;
-    p = ((unsigned short) buf->sbumpc()) << 8;
-    p += (unsigned short) buf->sbumpc();
-    minRemainingSize -= 2;
+    //Reading r and p
+    unsigned short r = (((unsigned short) header[0]) << 8) + header[1];
+    unsigned short p = (((unsigned short) header[2]) << 8) + header[3];
 
     //Reading opsLimit
     unsigned long long opsLimit = 0;
-    for (int i = 7; i >= 0; i--){
-        opsLimit += ((unsigned long long) buf->sbumpc()) << (8 * i);
+    for (int i = 0; i < 8; i++){
+        opsLimit = (opsLimit << 8) + header[4 + i];
     }
-    minRemainingSize -= 8;
-
     if (opsLimit > opsLimitBeforeException){
-        Nan::ThrowRangeError("Encrypted key file asks from more scrypt iterations than is allowed");
-        return info.GetReturnValue().Set(Nan::Undefined());
+        throw new std::range_error("Encrypted key file asks from more scrypt iterations than is allowed");
     }
 
-    //Reading salt size
-    unsigned short saltSize;
-    saltSize = ((unsigned short) buf->sbumpc()) << 8;
-    saltSize += (unsigned short) buf->sbumpc();
-    minRemainingSize -= 2;
-    minRemainingSize += saltSize;
+    //Reading salt and nonce sizes
+    unsigned short saltSize = (((unsigned short) header[12]) << 8) + header[13];
+    unsigned short nonceSize = (((unsigned short) header[14]) << 8) + header[15];
+    if (nonceSize != crypto_secretbox_NONCEBYTES){
+        throw new std::range_error("Invalid nonce size");
+    }
 
-    //Reading nonce size
-    unsigned short nonceSize;
-    nonceSize = ((unsigned short) buf->sbumpc()) << 8;
-    nonceSize += (unsigned short) buf->sbumpc();
-    minRemainingSize -= 2;
-    minRemainingSize += nonceSize;
+    //Reading the supposed encrypted content length and check its validity
+    unsigned int encryptedContentSize = 0;
+    for (int i = 0; i < 4; i++){
+        encryptedContentSize = (encryptedContentSize << 8) + header[16 + i];
+    }
+    if (encryptedContentSize < crypto_secretbox_MACBYTES || fileSize - FILE_HEADER_BYTES < (std::streamoff) saltSize + nonceSize + encryptedContentSize){
+        throw new std::range_error("Invalid encrypted file format");
+    }
 
-    if (buf->in_avail() < minRemainingSize){
-        Nan::ThrowRangeError("Invalid encrypted file format");
-        return info.GetReturnValue().Set(Nan::Undefined());
+    unsigned char* salt = new (std::nothrow) unsigned char[saltSize > 0 ? saltSize : 1];
+    unsigned char nonce[crypto_secretbox_NONCEBYTES];
+    unsigned char* encryptedContent = new (std::nothrow) unsigned char[encryptedContentSize];
+    if (salt == 0 || encryptedContent == 0){
+        delete[] salt;
+        delete[] encryptedContent;
+        throw new std::runtime_error("out of memory");
     }
+    fileReader.read((char*) salt, saltSize);
+    fileReader.read((char*) nonce, nonceSize);
+    fileReader.read((char*) encryptedContent, encryptedContentSize);
+    bool readFailed = !fileReader.good();
+    fileReader.close();
 
-    if (nonceSize != crypto_secretbox_NONCEBYTES){
-        Nan::ThrowRangeError("Invalid nonce size");
-        return info.GetReturnValue().Set(Nan::Undefined());
+    unsigned char derivedKey[crypto_secretbox_KEYBYTES];
+    int derivationResult = -1;
+    if (!readFailed){
+        derivationResult = crypto_pwhash_scryptsalsa208sha256_ll(password, passwordSize, salt, saltSize, opsLimit, r, p, derivedKey, crypto_secretbox_KEYBYTES);
     }
+    sodium_memzero(salt, saltSize);
+    delete[] salt;
 
-    //Reading the supposed encrypted content length and check its validity
-    unsigned int encryptedContentSize = 0;
-    for (int i = 3; i >= 0; i--){
-        encryptedContentSize += ((unsigned int) buf->sbumpc()) << (8 * i);
+    if (readFailed || derivationResult != 0){
+        sodium_memzero(derivedKey, crypto_secretbox_KEYBYTES);
+        delete[] encryptedContent;
+        throw new std::runtime_error(readFailed ? "Error while reading the encrypted file" : "out of memory");
     }
-    minRemainingSize -= 4;
-    minRemainingSize += encryptedContentSize;
 
-    if (buf->in_avail() < minRemainingSize){
-        Nan::ThrowRangeError("Invalid encrypted file format");
-        return info.GetReturnValue().Set(Nan::Undefined());
+    //Decryption
+    size_t plaintextLength = encryptedContentSize - crypto_secretbox_MACBYTES;
+    unsigned char* result = (unsigned char*) malloc(plaintextLength > 0 ? plaintextLength : 1);
+    if (result == 0){
+        sodium_memzero(derivedKey, crypto_secretbox_KEYBYTES);
+        delete[] encryptedContent;
+        throw new std::runtime_error("out of memory");
     }
+    int openResult = crypto_secretbox_open_easy(result, encryptedContent, encryptedContentSize, nonce, derivedKey);
+
+    sodium_memzero(derivedKey, crypto_secretbox_KEYBYTES);
+    delete[] encryptedContent;
 
-    //Reading salt
-    unsigned char* salt = new unsigned char[saltSize];
-    for (int i = 0; i < saltSize; i++){
-        salt[i] = (unsigned char) buf->sbumpc();
+    if (openResult != 0){
+        free(result);
+        throw new std::runtime_error("Invalid password or corrupted file");
     }
-    minRemainingSize -= saltSize;
 
-    //Reading nonce
-    unsigned char* nonce = new unsigned char[nonceSize];
-    for (int i = 0; i < nonceSize; i++){
-        nonce[i] = (unsigned char) buf->sbumpc();
+    *plaintext = result;
+    *plaintextSize = plaintextLength;
+}
+
+/**
+ * Runs file_encrypt or file_decrypt off the main thread.
+ * For encryption, the fileContent buffer is kept alive (but not copied) until
+ * the work is done; it must not be modified in the meantime.
+ */
+class FileCryptWorker : public Nan::AsyncWorker {
+public:
+    FileCryptWorker(Nan::Callback* callback, std::string const& filename, const unsigned char* password, size_t passwordSize)
+        : Nan::AsyncWorker(callback), filename(filename), passwordSize(passwordSize),
+          content(0), contentSize(0), decrypt(true), plaintext(0), plaintextSize(0), errorType(ERROR_PLAIN) {
+        this->password = new unsigned char[passwordSize];
+        memcpy(this->password, password, passwordSize);
     }
-    minRemainingSize -= nonceSize;
 
-    //Reading encrypted content
-    //Length of the remaining data has already been checked before
-    unsigned int encryptedContentLength = buf->in_avail();
-    unsigned char* encryptedContent = new unsigned char[encryptedContentLength];
-    for (unsigned long i = 0; i < encryptedContentSize; i++){
-        encryptedContent[i] = (unsigned char) buf->sbumpc();
+    ~FileCryptWorker() {
+        sodium_memzero(password, passwordSize);
+        delete[] password;
+        if (plaintext != 0) {
+            sodium_memzero(plaintext, plaintextSize);
+            free(plaintext);
+        }
     }
-    minRemainingSize -= encryptedContentSize;
 
-    unsigned short keySize = 32;
-    unsigned char* derivedKey = new unsigned char[keySize];
+    // Switch the worker to encryption of content
+    // contentObject holds contentData, it is kept alive until the worker completes
+    void SetContent(Local<Object> contentObject, const unsigned char* contentData, size_t contentDataSize) {
+        SaveToPersistent("content", contentObject);
+        content = contentData;
+        contentSize = contentDataSize;
+        decrypt = false;
+    }
 
-    //Deriving the password
-    crypto_pwhash_scryptsalsa208sha256_ll(password, password_size, salt, saltSize, opsLimit, r, p, derivedKey, keySize);
+    void Execute() {
+        try {
+            if (decrypt) {
+                file_decrypt(filename, password, passwordSize, &plaintext, &plaintextSize);
+            } else {
+                file_encrypt(filename, content, contentSize, password, passwordSize);
+            }
+        } catch (std::invalid_argument* e) {
+            errorType = ERROR_TYPE;
+            SetErrorMessage(e->what());
+            delete e;
+        } catch (std::range_error* e) {
+            errorType = ERROR_RANGE;
+            SetErrorMessage(e->what());
+            delete e;
+        } catch (std::runtime_error* e) {
+            SetErrorMessage(e->what());
+            delete e;
+        } catch (std::bad_alloc&) {
+            SetErrorMessage("out of memory");
+        }
+    }
 
-    unsigned int plaintextLength = encryptedContentSize - crypto_secretbox_MACBYTES;
-    NEW_BUFFER_AND_PTR(plaintext, plaintextLength);
-    //unsigned char* plaintext = new unsigned char[plaintextLength];
+    void HandleOKCallback() {
+        Nan::HandleScope scope;
 
-    //Decryption
-    if (crypto_secretbox_open_easy(plaintext_ptr, encryptedContent, encryptedContentSize, nonce, derivedKey) != 0){
-        Nan::ThrowError("Invalid password or corrupted file");
-        return info.GetReturnValue().Set(Nan::Undefined());
+        if (decrypt) {
+            // The new buffer takes ownership of plaintext
+            Local<Value> argv[] = { Nan::Null(), Nan::NewBuffer((char*) plaintext, plaintextSize).ToLocalChecked() };
+            plaintext = 0;
+            callback->Call(2, argv);
+        } else {
+            Local<Value> argv[] = { Nan::Null() };
+            callback->Call(1, argv);
+        }
     }
 
-    //Memory clean up
-    sodium_memzero(salt, saltSize);
-    sodium_memzero(nonce, nonceSize);
-    sodium_memzero(derivedKey, keySize);
+    void HandleErrorCallback() {
+        Nan::HandleScope scope;
 
-    delete salt;
-    delete nonce;
-    delete derivedKey;
+        Local<Value> err;
+        if (errorType == ERROR_TYPE) err = Nan::TypeError(ErrorMessage());
+        else if (errorType == ERROR_RANGE) err = Nan::RangeError(ErrorMessage());
+        else err = Nan::Error(ErrorMessage());
 
-    salt = 0;
-    nonce = 0;
-    derivedKey = 0;
+        Local<Value> argv[] = { err };
+        callback->Call(1, argv);
+    }
 
-    /*if (info.Length() > 2){ //Callback has been provided
-        Local<Function> callback = Local<Function>::Cast(info[2]);
-        Local<Value> argv[argc] = {Undefined(), Local<Value>::New(plaintext->handle_)};
-        callback->Call(globalObj, argc, argv);
-        return scope.Close(Undefined());
-    } else*/ return info.GetReturnValue().Set(plaintext);
+private:
+    enum ErrorType { ERROR_PLAIN, ERROR_TYPE, ERROR_RANGE };
 
-}
+    std::string filename;
+    unsigned char* password;
+    size_t passwordSize;
+    const unsigned char* content;
+    size_t contentSize;
+    bool decrypt;
+    unsigned char* plaintext;
+    size_t plaintextSize;
+    ErrorType errorType;
+};
 
 /**
- * int crypto_auth(
- *       unsigned char*  tok,
- *       const unsigned char * msg,
- *       unsigned long long mlen,
- *       const unsigned char * key)
+ * Password based file encryption with ease of use. scrypt + secretbox. Same format as for encrypted key files produced by KeyRing.save
+ * Buffer fileContent
+ * Buffer password
+ * String filename //Transform it back into a string
+ * Function callback
  *
- * Parameters:
- *  [out] 	tok 	the generated authentication token.
- *  [in] 	msg 	the message to be authenticated.
- *  [in] 	mlen 	the length of msg.
- *  [in] 	key 	the key used to compute the token.
+ * When a callback is given, the key derivation, the encryption and the file
+ * writing are done on a worker thread, and callback(err) is called once the
+ * file is written.
  */
-NAN_METHOD(bind_crypto_auth) {
+NAN_METHOD(pw_file_encrypt){
     Nan::EscapableHandleScope scope;
 
-    NUMBER_OF_MANDATORY_ARGS(2,"arguments message, and key must be buffers");
+    NUMBER_OF_MANDATORY_ARGS(3, "arguments fileContent, password and filename can't be null");
 
-    GET_ARG_AS_UCHAR(0, msg);
-    GET_ARG_AS_UCHAR_LEN(1, key, crypto_auth_KEYBYTES);
+    if (info.Length() > 3){
+        if (!info[3]->IsFunction()){
+            Nan::ThrowTypeError("When defined, callback must be a function");
+            return info.GetReturnValue().Set(Nan::Undefined());
+        }
+    }
 
-    NEW_BUFFER_AND_PTR(token, crypto_auth_BYTES);
+    GET_ARG_AS_UCHAR(0, fileContent);
+    GET_ARG_AS_UCHAR(1, password);
+    String::Utf8Value filenameVal(info[2]);
+    std::string filename(*filenameVal);
 
-    if( crypto_auth(token_ptr, msg, msg_size, key) == 0 ) {
-        return info.GetReturnValue().Set(token);
-    } else {
-        return info.GetReturnValue().Set(Nan::Null());
+    //Either go async, or encrypt right away
+    if (info.Length() > 3){
+        FileCryptWorker* worker = new FileCryptWorker(new Nan::Callback(info[3].As<Function>()), filename, password, password_size);
+        worker->SetContent(info[0]->ToObject(), fileContent, fileContent_size);
+        WorkerPool::QueueWorker(worker);
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+
+    try {
+        file_encrypt(filename, fileContent, fileContent_size, password, password_size);
+    } catch (std::range_error* e){
+        Nan::ThrowRangeError(e->what());
+        delete e;
+    } catch (std::runtime_error* e){
+        Nan::ThrowError(e->what());
+        delete e;
+    } catch (std::bad_alloc&){
+        Nan::ThrowError("out of memory");
     }
+    return info.GetReturnValue().Set(Nan::Undefined());
 }
 
 /**
- * int crypto_auth_verify(
- *       unsigned char*  tok,
- *       const unsigned char * msg,
- *       unsigned long long mlen,
- *       const unsigned char * key)
+ * Password based file decryption with ease of use. scrypt + secretbox. Same format as for encrypted key files produced by KeyRing.save
+ * String filename
+ * Buffer password
+ * Function callback
  *
- * Parameters:
- *  [out] 	tok 	the generated authentication token.
- *  [in] 	msg 	the message to be authenticated.
- *  [in] 	mlen 	the length of msg.
- *  [in] 	key 	the key used to compute the token.
+ * When a callback is given, the file reading, the key derivation and the
+ * decryption are done on a worker thread, and the plaintext is passed to
+ * callback(err, plaintext).
  */
-NAN_METHOD(bind_crypto_auth_verify) {
+NAN_METHOD(pw_file_decrypt){
     Nan::EscapableHandleScope scope;
 
-    NUMBER_OF_MANDATORY_ARGS(3,"arguments token, message, and key must be buffers");
+    NUMBER_OF_MANDATORY_ARGS(2, "arguments filename and password must be defined");
+
+    if (info.Length() > 2){
+        if (!info[2]->IsFunction()){
+            Nan::ThrowTypeError("When defined, callback must be a function");
+            return info.GetReturnValue().Set(Nan::Undefined());
+        }
+    }
+
+    String::Utf8Value filenameVal(info[0]);
+    std::string filename(*filenameVal);
+    GET_ARG_AS_UCHAR(1, password);
+
+    if (info.Length() > 2){
+        WorkerPool::QueueWorker(new FileCryptWorker(new Nan::Callback(info[2].As<Function>()), filename, password, password_size));
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+
+    unsigned char* plaintext = 0;
+    size_t plaintextSize = 0;
+    try {
+        file_decrypt(filename, password, password_size, &plaintext, &plaintextSize);
+    } catch (std::invalid_argument* e){
+        Nan::ThrowTypeError(e->what());
+        delete e;
+        return info.GetReturnValue().Set(Nan::Undefined());
+    } catch (std::range_error* e){
+        Nan::ThrowRangeError(e->what());
+        delete e;
+        return info.GetReturnValue().Set(Nan::Undefined());
+    } catch (std::runtime_error* e){
+        Nan::ThrowError(e->what());
+        delete e;
+        return info.GetReturnValue().Set(Nan::Undefined());
+    } catch (std::bad_alloc&){
+        Nan::ThrowError("out of memory");
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+
+    // The new buffer takes ownership of plaintext
+    return info.GetReturnValue().Set(Nan::NewBuffer((char*) plaintext, plaintextSize).ToLocalChecked());
+}
+
+/* Streaming encrypted file format, version 2. Numbers are in big endian, as in version 1
+* 4 bytes : magic, "NSEF"
+* 2 bytes : format version (2, the format of encrypt_file being version 1)
+* 2 bytes : r (unsigned short)
+* 2 bytes : p (unsigned short)
+* 8 bytes : opsLimit (unsigned long)
+* 2 bytes : salt size (sn, unsigned short)
+* sn bytes: salt
+* then a SecretboxChunker stream keyed with the derived key: the stream header (nonce and
+* chunk size) and the encrypted chunks, the last one shorter than the others.
+*
+* There is no content size: the content ends with the last chunk, and a truncated file
+* doesn't authenticate. Files are read and written in blocks of about FILE_STREAM_BLOCK_BYTES,
+* whatever their size.
+*/
+#define FILE_STREAM_HEADER_BYTES 20
+#define FILE_STREAM_VERSION 2
+#define FILE_STREAM_BLOCK_BYTES (1024 * 1024)
+
+static const unsigned char fileStreamMagic[4] = { 'N', 'S', 'E', 'F' };
+
+// Input or output of the streaming file encryption: a path, or an fd (>= 0) owned by the caller
+struct FileStreamTarget {
+    std::string path;
+    int fd;
+};
+
+/**
+ * File descriptor of a FileStreamTarget, opened from its path if it doesn't have one.
+ * An output given as a path is written to a temporary file next to it (its missing
+ * parent directories are created), renamed over it by Commit(): a failed encryption or decryption leaves no partial file behind, and
+ * leaves an existing output untouched. The temporary file is removed if Commit() isn't
+ * called. Throws a runtime_error* if the file can't be opened.
+ */
+class FileStreamFd {
+public:
+    // Input
+    explicit FileStreamFd(FileStreamTarget const& target) : fd(target.fd), owned(false) {
+        if (fd >= 0) return;
+        uv_fs_t req;
+        fd = uv_fs_open(NULL, &req, target.path.c_str(), O_RDONLY, 0, NULL);
+        uv_fs_req_cleanup(&req);
+        if (fd < 0) {
+            throw new std::runtime_error("file cannot be opened");
+        }
+        owned = true;
+    }
+
+    // Output. Throws an invalid_argument* if it is the same file as input, which would be overwritten as it is read
+    FileStreamFd(FileStreamTarget const& target, FileStreamFd const& input) : fd(target.fd), owned(false) {
+        uv_stat_t inStat;
+        uv_stat_t outStat;
+        if (input.Stat(&inStat) && (fd >= 0 ? Stat(&outStat) : StatPath(target.path, &outStat)) &&
+            inStat.st_dev == outStat.st_dev && inStat.st_ino == outStat.st_ino) {
+            throw new std::invalid_argument("input and output are the same file");
+        }
+        if (fd >= 0) return;
+
+        unsigned char suffix[8];
+        char suffixHex[2 * sizeof suffix + 1];
+        randombytes_buf(suffix, sizeof suffix);
+        Codecs::HexEncode(suffixHex, suffix, sizeof suffix);
+        suffixHex[2 * sizeof suffix] = 0;
+
+        make_parent_dirs(target.path);
+        uv_fs_t req;
+        tempPath = target.path + ".tmp-" + suffixHex;
+        fd = uv_fs_open(NULL, &req, tempPath.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666, NULL);
+        uv_fs_req_cleanup(&req);
+        if (fd < 0) {
+            tempPath.clear();
+            throw new std::runtime_error("output file cannot be opened");
+        }
+        path = target.path;
+        owned = true;
+    }
+
+    ~FileStreamFd() {
+        if (!owned) return;
+        uv_fs_t req;
+        uv_fs_close(NULL, &req, fd, NULL);
+        uv_fs_req_cleanup(&req);
+        if (!tempPath.empty()) {
+            uv_fs_unlink(NULL, &req, tempPath.c_str(), NULL);
+            uv_fs_req_cleanup(&req);
+        }
+    }
+
+    // Output: closes it and moves it to its path. Throws a runtime_error* on failure
+    void Commit() {
+        if (!owned) return;
+        uv_fs_t req;
+        int closed = uv_fs_close(NULL, &req, fd, NULL);
+        uv_fs_req_cleanup(&req);
+        owned = false;
+        int renamed = closed < 0 ? closed : uv_fs_rename(NULL, &req, tempPath.c_str(), path.c_str(), NULL);
+        if (closed >= 0) {
+            uv_fs_req_cleanup(&req);
+        }
+        if (renamed < 0) {
+            uv_fs_unlink(NULL, &req, tempPath.c_str(), NULL);
+            uv_fs_req_cleanup(&req);
+            throw new std::runtime_error("Error while writing the file");
+        }
+    }
+
+    // Reads until size bytes or the end of the file. Returns the number of bytes read
+    size_t Read(unsigned char* buf, size_t size) {
+        size_t total = 0;
+        while (total < size) {
+            uv_fs_t req;
+            uv_buf_t uvBuf = uv_buf_init((char*) buf + total, (unsigned int) (size - total));
+            int bytes = uv_fs_read(NULL, &req, fd, &uvBuf, 1, -1, NULL);
+            uv_fs_req_cleanup(&req);
+            if (bytes < 0) {
+                throw new std::runtime_error("Error while reading the file");
+            }
+            if (bytes == 0) break;
+            total += bytes;
+        }
+        return total;
+    }
+
+    void Write(const unsigned char* buf, size_t size) {
+        size_t total = 0;
+        while (total < size) {
+            uv_fs_t req;
+            uv_buf_t uvBuf = uv_buf_init((char*) buf + total, (unsigned int) (size - total));
+            int bytes = uv_fs_write(NULL, &req, fd, &uvBuf, 1, -1, NULL);
+            uv_fs_req_cleanup(&req);
+            if (bytes <= 0) {
+                throw new std::runtime_error("Error while writing the file");
+            }
+            total += bytes;
+        }
+    }
+
+private:
+    bool Stat(uv_stat_t* stat) const {
+        uv_fs_t req;
+        int result = uv_fs_fstat(NULL, &req, fd, NULL);
+        *stat = req.statbuf;
+        uv_fs_req_cleanup(&req);
+        return result == 0;
+    }
+
+    // False if the file doesn't exist
+    static bool StatPath(std::string const& path, uv_stat_t* stat) {
+        uv_fs_t req;
+        int result = uv_fs_stat(NULL, &req, path.c_str(), NULL);
+        *stat = req.statbuf;
+        uv_fs_req_cleanup(&req);
+        return result == 0;
+    }
+
+    int fd;
+    bool owned;
+    // Output given as a path: the final and the temporary path
+    std::string path;
+    std::string tempPath;
+};
+
+// Block of the streaming file encryption, wiped when released: it holds plain text
+struct FileStreamBlock {
+    explicit FileStreamBlock(size_t size) : data(size) {}
+    ~FileStreamBlock() {
+        sodium_memzero(&data[0], data.size());
+    }
+    std::vector<unsigned char> data;
+};
+
+/**
+ * Encrypts or decrypts the chunks of in to out, a block at a time, until the end of in.
+ * Throws a runtime_error* if a chunk doesn't authenticate or on I/O errors.
+ */
+static void file_stream_chunks(SecretboxChunker& chunker, FileStreamFd& in, FileStreamFd& out) {
+    const size_t inChunk = chunker.InChunkSize();
+    const size_t outChunk = chunker.OutChunkSize();
+    size_t blockChunks = FILE_STREAM_BLOCK_BYTES / inChunk;
+    if (blockChunks == 0) blockChunks = 1;
+
+    FileStreamBlock inBlock(blockChunks * inChunk);
+    FileStreamBlock outBlock(blockChunks * outChunk);
+
+    for (;;) {
+        // A block is a whole number of chunks: whatever doesn't fill one is the end of the input
+        size_t filled = in.Read(&inBlock.data[0], inBlock.data.size());
+        size_t chunks = filled / inChunk;
+        if (chunks > 0) {
+            if (!chunker.Process(&inBlock.data[0], &outBlock.data[0], chunks)) {
+                throw new std::runtime_error("Invalid password or corrupted file");
+            }
+            out.Write(&outBlock.data[0], chunks * outChunk);
+        }
+        if (filled < inBlock.data.size()) {
+            size_t rest = filled - chunks * inChunk;
+            if (!chunker.ProcessLast(&inBlock.data[chunks * inChunk], rest, &outBlock.data[0])) {
+                throw new std::runtime_error("Invalid password or corrupted file");
+            }
+            out.Write(&outBlock.data[0], chunker.GetMode() == SecretboxChunker::ENCRYPT ? rest + crypto_secretbox_MACBYTES : rest - crypto_secretbox_MACBYTES);
+            return;
+        }
+    }
+}
+
+/**
+ * Encrypts input to output in the streaming file format, with a key derived from password.
+ * Doesn't use V8, so it can run on a worker thread. Throws a runtime_error* on failure.
+ */
+static void file_stream_encrypt(FileStreamTarget const& input, FileStreamTarget const& output, const unsigned char* password, size_t passwordSize){
+    unsigned int r = 8;
+    unsigned int p = 1;
+    unsigned long long opsLimit = 16384;
+    unsigned short saltSize = 8;
+
+    FileStreamFd in(input);
+    FileStreamFd out(output, in);
+
+    unsigned char header[FILE_STREAM_HEADER_BYTES];
+    memcpy(header, fileStreamMagic, 4);
+    header[4] = (unsigned char) (FILE_STREAM_VERSION >> 8);
+    header[5] = (unsigned char) FILE_STREAM_VERSION;
+    header[6] = (unsigned char) (r >> 8);
+    header[7] = (unsigned char) r;
+    header[8] = (unsigned char) (p >> 8);
+    header[9] = (unsigned char) p;
+    for (unsigned short i = 0; i < 8; i++){
+        header[10 + i] = (unsigned char) (opsLimit >> (8 * (7 - i)));
+    }
+    header[18] = (unsigned char) (saltSize >> 8);
+    header[19] = (unsigned char) saltSize;
+
+    unsigned char salt[8];
+    randombytes_buf(salt, saltSize);
+
+    unsigned char derivedKey[crypto_secretbox_KEYBYTES];
+    if (crypto_pwhash_scryptsalsa208sha256_ll(password, passwordSize, salt, saltSize, opsLimit, r, p, derivedKey, crypto_secretbox_KEYBYTES) != 0){
+        sodium_memzero(derivedKey, crypto_secretbox_KEYBYTES);
+        throw new std::runtime_error("out of memory");
+    }
+    SecretboxChunker chunker(SecretboxChunker::ENCRYPT, derivedKey);
+    sodium_memzero(derivedKey, crypto_secretbox_KEYBYTES);
+
+    unsigned char streamHeader[SecretboxChunker::HEADER_BYTES];
+    chunker.NewHeader(streamHeader, SecretboxChunker::DEFAULT_CHUNK_SIZE);
+
+    out.Write(header, FILE_STREAM_HEADER_BYTES);
+    out.Write(salt, saltSize);
+    out.Write(streamHeader, SecretboxChunker::HEADER_BYTES);
+    file_stream_chunks(chunker, in, out);
+    out.Commit();
+}
+
+/**
+ * Decrypts input, in the streaming file format, to output. Doesn't use V8, so it can run on
+ * a worker thread. Throws an invalid_argument* (invalid file), a range_error* (unsupported
+ * version, invalid header values) or a runtime_error* (wrong password, corrupted or truncated
+ * file, I/O error) on failure.
+ */
+static void file_stream_decrypt(FileStreamTarget const& input, FileStreamTarget const& output, const unsigned char* password, size_t passwordSize){
+    const unsigned long opsLimitBeforeException = 4194304;
+
+    FileStreamFd in(input);
+
+    unsigned char header[FILE_STREAM_HEADER_BYTES];
+    if (in.Read(header, FILE_STREAM_HEADER_BYTES) < FILE_STREAM_HEADER_BYTES || memcmp(header, fileStreamMagic, 4) != 0){
+        throw new std::invalid_argument("Invalid file format");
+    }
+    unsigned short version = (((unsigned short) header[4]) << 8) + header[5];
+    if (version != FILE_STREAM_VERSION){
+        throw new std::range_error("Unsupported file format version");
+    }
+
+    unsigned short r = (((unsigned short) header[6]) << 8) + header[7];
+    unsigned short p = (((unsigned short) header[8]) << 8) + header[9];
+    unsigned long long opsLimit = 0;
+    for (int i = 0; i < 8; i++){
+        opsLimit = (opsLimit << 8) + header[10 + i];
+    }
+    if (opsLimit > opsLimitBeforeException){
+        throw new std::range_error("Encrypted file asks from more scrypt iterations than is allowed");
+    }
+    unsigned short saltSize = (((unsigned short) header[18]) << 8) + header[19];
+
+    std::vector<unsigned char> salt(saltSize > 0 ? saltSize : 1);
+    unsigned char streamHeader[SecretboxChunker::HEADER_BYTES];
+    if (in.Read(&salt[0], saltSize) < saltSize || in.Read(streamHeader, SecretboxChunker::HEADER_BYTES) < SecretboxChunker::HEADER_BYTES){
+        throw new std::invalid_argument("Invalid file format");
+    }
+
+    unsigned char derivedKey[crypto_secretbox_KEYBYTES];
+    if (crypto_pwhash_scryptsalsa208sha256_ll(password, passwordSize, &salt[0], saltSize, opsLimit, r, p, derivedKey, crypto_secretbox_KEYBYTES) != 0){
+        sodium_memzero(derivedKey, crypto_secretbox_KEYBYTES);
+        throw new std::runtime_error("out of memory");
+    }
+    SecretboxChunker chunker(SecretboxChunker::DECRYPT, derivedKey);
+    sodium_memzero(derivedKey, crypto_secretbox_KEYBYTES);
+    if (!chunker.ReadHeader(streamHeader)){
+        throw new std::range_error("Invalid encrypted file format");
+    }
+
+    FileStreamFd out(output, in);
+    file_stream_chunks(chunker, in, out);
+    out.Commit();
+}
+
+/**
+ * Runs file_stream_encrypt or file_stream_decrypt off the main thread.
+ */
+class FileStreamWorker : public Nan::AsyncWorker {
+public:
+    FileStreamWorker(Nan::Callback* callback, bool decrypt, FileStreamTarget const& input, FileStreamTarget const& output, const unsigned char* password, size_t passwordSize)
+        : Nan::AsyncWorker(callback), decrypt(decrypt), input(input), output(output), passwordSize(passwordSize), errorType(ERROR_PLAIN) {
+        this->password = new unsigned char[passwordSize > 0 ? passwordSize : 1];
+        memcpy(this->password, password, passwordSize);
+    }
+
+    ~FileStreamWorker() {
+        sodium_memzero(password, passwordSize);
+        delete[] password;
+    }
+
+    void Execute() {
+        try {
+            if (decrypt) {
+                file_stream_decrypt(input, output, password, passwordSize);
+            } else {
+                file_stream_encrypt(input, output, password, passwordSize);
+            }
+        } catch (std::invalid_argument* e) {
+            errorType = ERROR_TYPE;
+            SetErrorMessage(e->what());
+            delete e;
+        } catch (std::range_error* e) {
+            errorType = ERROR_RANGE;
+            SetErrorMessage(e->what());
+            delete e;
+        } catch (std::runtime_error* e) {
+            SetErrorMessage(e->what());
+            delete e;
+        } catch (std::bad_alloc&) {
+            SetErrorMessage("out of memory");
+        }
+    }
+
+    void HandleErrorCallback() {
+        Nan::HandleScope scope;
+
+        Local<Value> err;
+        if (errorType == ERROR_TYPE) err = Nan::TypeError(ErrorMessage());
+        else if (errorType == ERROR_RANGE) err = Nan::RangeError(ErrorMessage());
+        else err = Nan::Error(ErrorMessage());
+
+        Local<Value> argv[] = { err };
+        callback->Call(1, argv);
+    }
+
+private:
+    enum ErrorType { ERROR_PLAIN, ERROR_TYPE, ERROR_RANGE };
+
+    bool decrypt;
+    FileStreamTarget input;
+    FileStreamTarget output;
+    unsigned char* password;
+    size_t passwordSize;
+    ErrorType errorType;
+};
+
+// Reads a file path (string) or file descriptor (integer) argument. Throws a TypeError and returns false if it is neither
+static bool get_file_stream_target(Local<Value> arg, const char* name, FileStreamTarget* target) {
+    if (arg->IsInt32() && arg->Int32Value() >= 0) {
+        target->fd = arg->Int32Value();
+        return true;
+    }
+    if (arg->IsString()) {
+        Nan::Utf8String path(arg);
+        target->path = *path;
+        target->fd = -1;
+        return true;
+    }
+    Nan::ThrowTypeError((std::string(name) + " must be a file path or a file descriptor").c_str());
+    return false;
+}
+
+// Runs file_stream_encrypt or file_stream_decrypt, on a worker thread when the last argument is a callback
+static void file_stream_call(NAN_METHOD_ARGS_TYPE info, bool decrypt) {
+    NUMBER_OF_MANDATORY_ARGS(3, "arguments input, output and password must be defined");
+
+    if (info.Length() > 3){
+        if (!info[3]->IsFunction()){
+            return Nan::ThrowTypeError("When defined, callback must be a function");
+        }
+    }
+
+    FileStreamTarget input, output;
+    if (!get_file_stream_target(info[0], "input", &input) || !get_file_stream_target(info[1], "output", &output)){
+        return;
+    }
+    GET_ARG_AS_UCHAR(2, password);
+
+    if (info.Length() > 3){
+        WorkerPool::QueueWorker(new FileStreamWorker(new Nan::Callback(info[3].As<Function>()), decrypt, input, output, password, password_size));
+        return;
+    }
+
+    try {
+        if (decrypt) {
+            file_stream_decrypt(input, output, password, password_size);
+        } else {
+            file_stream_encrypt(input, output, password, password_size);
+        }
+    } catch (std::invalid_argument* e){
+        Nan::ThrowTypeError(e->what());
+        delete e;
+    } catch (std::range_error* e){
+        Nan::ThrowRangeError(e->what());
+        delete e;
+    } catch (std::runtime_error* e){
+        Nan::ThrowError(e->what());
+        delete e;
+    } catch (std::bad_alloc&){
+        Nan::ThrowError("out of memory");
+    }
+}
+
+/**
+ * Password based file encryption, in constant memory. scrypt + chunked secretbox, in the streaming file format
+ * String|Number input //path or file descriptor of the file to encrypt
+ * String|Number output //path or file descriptor of the encrypted file
+ * Buffer password
+ * Function callback
+ *
+ * When a callback is given, the key derivation and the encryption are done on a
+ * worker thread, and callback(err) is called once the output is written.
+ * An output given as a path is only replaced once the whole file is encrypted. File descriptors are left open.
+ * input and output can't be the same file.
+ */
+NAN_METHOD(pw_file_stream_encrypt){
+    file_stream_call(info, false);
+}
+
+/**
+ * Password based file decryption, in constant memory, of a file produced by encrypt_file_stream
+ * String|Number input //path or file descriptor of the encrypted file
+ * String|Number output //path or file descriptor of the decrypted file
+ * Buffer password
+ * Function callback
+ *
+ * When a callback is given, the key derivation and the decryption are done on a
+ * worker thread, and callback(err) is called once the output is written.
+ * An output given as a path is only replaced once the whole file is decrypted and authenticated,
+ * so that no partial plain text is left. input and output can't be the same file.
+ */
+NAN_METHOD(pw_file_stream_decrypt){
+    file_stream_call(info, true);
+}
+
+/**
+ * int crypto_auth(
+ *       unsigned char*  tok,
+ *       const unsigned char * msg,
+ *       unsigned long long mlen,
+ *       const unsigned char * key)
+ *
+ * Parameters:
+ *  [out] 	tok 	the generated authentication token.
+ *  [in] 	msg 	the message to be authenticated.
+ *  [in] 	mlen 	the length of msg.
+ *  [in] 	key 	the key used to compute the token.
+ */
+NAN_METHOD(bind_crypto_auth) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(2,"arguments message, and key must be buffers");
+
+    GET_ARG_MESSAGE(0, msg);
+    GET_ARG_AS_UCHAR_LEN(1, key, crypto_auth_KEYBYTES);
+
+    NEW_BUFFER_AND_PTR(token, crypto_auth_BYTES);
+
+    if( crypto_auth(token_ptr, msg, msg_size, key) == 0 ) {
+        return info.GetReturnValue().Set(token);
+    } else {
+        return info.GetReturnValue().Set(Nan::Null());
+    }
+}
+
+/**
+ * int crypto_auth_verify(
+ *       unsigned char*  tok,
+ *       const unsigned char * msg,
+ *       unsigned long long mlen,
+ *       const unsigned char * key)
+ *
+ * Parameters:
+ *  [out] 	tok 	the generated authentication token.
+ *  [in] 	msg 	the message to be authenticated.
+ *  [in] 	mlen 	the length of msg.
+ *  [in] 	key 	the key used to compute the token.
+ */
+NAN_METHOD(bind_crypto_auth_verify) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3,"arguments token, message, and key must be buffers");
 
     GET_ARG_AS_UCHAR_LEN(0, token, crypto_auth_BYTES);
-    GET_ARG_AS_UCHAR(1, message);
+    GET_ARG_MESSAGE(1, message);
     GET_ARG_AS_UCHAR_LEN(2, key, crypto_auth_KEYBYTES);
 
     return info.GetReturnValue().Set(Nan::New<Integer>(crypto_auth_verify(token, message, message_size, key)));
@@ -862,10 +2144,10 @@ NAN_METHOD(bind_crypto_onetimeauth) {
 
     NUMBER_OF_MANDATORY_ARGS(2,"arguments message, and key must be buffers");
 
-    GET_ARG_AS_UCHAR(0, message);
+    GET_ARG_MESSAGE(0, message);
     GET_ARG_AS_UCHAR_LEN(1, key, crypto_onetimeauth_KEYBYTES);
 
-    NEW_BUFFER_AND_PTR(token, crypto_onetimeauth_BYTES);
+    NEW_RESULT_BUFFER_AND_PTR(token, crypto_onetimeauth_BYTES);
 
     if( crypto_onetimeauth(token_ptr, message, message_size, key) == 0 ) {
         return info.GetReturnValue().Set(token);
@@ -893,7 +2175,7 @@ NAN_METHOD(bind_crypto_onetimeauth_verify) {
     NUMBER_OF_MANDATORY_ARGS(3,"arguments token, message, and key must be buffers");
 
     GET_ARG_AS_UCHAR_LEN(0, token, crypto_onetimeauth_BYTES);
-    GET_ARG_AS_UCHAR(1, message);
+    GET_ARG_MESSAGE(1, message);
     GET_ARG_AS_UCHAR_LEN(2, key, crypto_onetimeauth_KEYBYTES);
 
     return info.GetReturnValue().Set(Nan::New<Integer>(crypto_onetimeauth_verify(token, message, message_size, key)));
@@ -966,7 +2248,7 @@ NAN_METHOD(bind_crypto_stream_xor) {
 
     NUMBER_OF_MANDATORY_ARGS(3,"arguments message, nonce, and key must be buffers");
 
-    GET_ARG_AS_UCHAR(0, message);
+    GET_ARG_MESSAGE(0, message);
     GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_stream_NONCEBYTES);
     GET_ARG_AS_UCHAR_LEN(2, key, crypto_stream_KEYBYTES);
 
@@ -979,6 +2261,47 @@ NAN_METHOD(bind_crypto_stream_xor) {
     }
 }
 
+/**
+ * Same as crypto_stream_xor, but writes the message_size result bytes in out at offset.
+ * Returns the number of bytes written
+ */
+NAN_METHOD(bind_crypto_stream_xor_into) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(5,"arguments out, offset, message, nonce, and key are mandatory");
+
+    GET_ARG_MESSAGE(2, message);
+    GET_ARG_AS_UCHAR_LEN(3, nonce, crypto_stream_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(4, key, crypto_stream_KEYBYTES);
+    GET_OUTPUT_ARG(0, out, message_size);
+
+    if( crypto_stream_xor(out_ptr, message, message_size, nonce, key) == 0) {
+        return info.GetReturnValue().Set(Nan::New<Number>((double) message_size));
+    } else {
+        return;
+    }
+}
+
+/**
+ * In place crypto_stream_xor: buffer is replaced by its xor with the key stream.
+ * Returns the number of bytes processed, the length of buffer
+ */
+NAN_METHOD(bind_crypto_stream_xor_inplace) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3,"arguments buffer, nonce, and key must be buffers");
+
+    GET_ARG_AS_UCHAR(0, buffer);
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_stream_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, key, crypto_stream_KEYBYTES);
+
+    if( crypto_stream_xor(buffer, buffer, buffer_size, nonce, key) == 0) {
+        return info.GetReturnValue().Set(Nan::New<Number>((double) buffer_size));
+    } else {
+        return;
+    }
+}
+
 /**
  * Encrypts and authenticates a message using the given secret key, and nonce.
  *
@@ -1011,25 +2334,16 @@ NAN_METHOD(bind_crypto_secretbox) {
 
     NUMBER_OF_MANDATORY_ARGS(3,"arguments message, nonce, and key must be buffers");
 
-    GET_ARG_AS_UCHAR(0, message);
+    GET_ARG_MESSAGE(0, message);
     GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_secretbox_NONCEBYTES);
     GET_ARG_AS_UCHAR_LEN(2, key, crypto_secretbox_KEYBYTES);
 
-    NEW_BUFFER_AND_PTR(pmb, message_size + crypto_secretbox_ZEROBYTES);
-
-    // Fill the first crypto_secretbox_ZEROBYTES with 0
-    unsigned int i;
-    for(i=0; i < crypto_secretbox_ZEROBYTES; i++) {
-        pmb_ptr[i] = 0U;
-    }
-
-    //Copy the message to the new buffer
-    memcpy((void*) (pmb_ptr + crypto_secretbox_ZEROBYTES), (void *) message, message_size);
-    message_size += crypto_secretbox_ZEROBYTES;
-
-    NEW_BUFFER_AND_PTR(ctxt, message_size);
+    // Same output as crypto_secretbox on a zero padded message, without padding a copy of it:
+    // crypto_secretbox_BOXZEROBYTES zeros followed by the crypto_secretbox_easy output (MAC, then cipher text)
+    NEW_BUFFER_AND_PTR(ctxt, message_size + crypto_secretbox_ZEROBYTES);
+    memset(ctxt_ptr, 0, crypto_secretbox_BOXZEROBYTES);
 
-    if( crypto_secretbox(ctxt_ptr, pmb_ptr, message_size, nonce, key) == 0) {
+    if( crypto_secretbox_easy(ctxt_ptr + crypto_secretbox_BOXZEROBYTES, message, message_size, nonce, key) == 0) {
         return info.GetReturnValue().Set(ctxt);
     } else {
         return;
@@ -1076,12 +2390,10 @@ NAN_METHOD(bind_crypto_secretbox_open) {
     GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_secretbox_NONCEBYTES);
     GET_ARG_AS_UCHAR_LEN(2, key, crypto_secretbox_KEYBYTES);
 
-    NEW_BUFFER_AND_PTR(message, cipher_text_size);
-
-    // API requires that the first crypto_secretbox_ZEROBYTES of msg be 0 so lets check
-    if( cipher_text_size < crypto_secretbox_BOXZEROBYTES ) {
+    // API requires that the first crypto_secretbox_BOXZEROBYTES of ctxt be 0, followed by the MAC, so lets check
+    if( cipher_text_size < crypto_secretbox_ZEROBYTES ) {
         std::ostringstream oss;
-        oss << "argument cipherText must have at least " << crypto_secretbox_BOXZEROBYTES << " bytes";
+        oss << "argument cipherText must have at least " << crypto_secretbox_ZEROBYTES << " bytes";
         return Nan::ThrowError(oss.str().c_str());
     }
 
@@ -1095,12 +2407,11 @@ NAN_METHOD(bind_crypto_secretbox_open) {
         return Nan::ThrowError(oss.str().c_str());
     }
 
-    if( crypto_secretbox_open(message_ptr, cipher_text, cipher_text_size, nonce, key) == 0) {
-
-        // Remove the padding at the beginning of the message
-        NEW_BUFFER_AND_PTR(plain_text, cipher_text_size - crypto_secretbox_ZEROBYTES);
-        memcpy(plain_text_ptr,(void*) (message_ptr + crypto_secretbox_ZEROBYTES), cipher_text_size - crypto_secretbox_ZEROBYTES);
+    // What follows the zeros is in the crypto_secretbox_open_easy format: decrypt straight into the unpadded result
+    NEW_BUFFER_AND_PTR(plain_text, cipher_text_size - crypto_secretbox_ZEROBYTES);
 
+    if( crypto_secretbox_open_easy(plain_text_ptr, cipher_text + crypto_secretbox_BOXZEROBYTES,
+                                   cipher_text_size - crypto_secretbox_BOXZEROBYTES, nonce, key) == 0) {
         return info.GetReturnValue().Set(plain_text);
     } else {
         return;
@@ -1138,7 +2449,7 @@ NAN_METHOD(bind_crypto_secretbox_easy) {
 
     NUMBER_OF_MANDATORY_ARGS(3,"arguments message, nonce, and key must be buffers");
 
-    GET_ARG_AS_UCHAR(0, message);
+    GET_ARG_MESSAGE(0, message);
     GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_secretbox_NONCEBYTES);
     GET_ARG_AS_UCHAR_LEN(2, key, crypto_secretbox_KEYBYTES);
 
@@ -1150,23 +2461,77 @@ NAN_METHOD(bind_crypto_secretbox_easy) {
         return;
     }
 }
+
 /**
- * int crypto_secretbox_open_easy(
- *    unsigned char *msg,
- *    const unsigned char *ctxt,
- *    unsigned long long clen,
- *    const unsigned char *nonce,
- *    const unsigned char *key)
- * Parameters:
- *    [out] msg   the buffer to place resulting plaintext.
- *    [in]   ctxt   the ciphertext to be decrypted.
- *    [in]   clen   the length of the ciphertext.
- *    [in]   nonce   a randomly generated nonce.
- *    [in]   key   the shared secret key.
- *
- * Returns:
- *    0 if successful and -1 if verification fails.
- *
+ * Same as crypto_secretbox_easy, but writes the message_size + crypto_secretbox_MACBYTES
+ * cipher text bytes in out at offset. Returns the number of bytes written
+ */
+NAN_METHOD(bind_crypto_secretbox_easy_into) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(5,"arguments out, offset, message, nonce, and key are mandatory");
+
+    GET_ARG_MESSAGE(2, message);
+    GET_ARG_AS_UCHAR_LEN(3, nonce, crypto_secretbox_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(4, key, crypto_secretbox_KEYBYTES);
+    GET_OUTPUT_ARG(0, out, message_size + crypto_secretbox_MACBYTES);
+
+    if (crypto_secretbox_easy(out_ptr, message, message_size, nonce, key) == 0) {
+        return info.GetReturnValue().Set(Nan::New<Number>((double) (message_size + crypto_secretbox_MACBYTES)));
+    } else {
+        return;
+    }
+}
+
+/**
+ * In place crypto_secretbox_easy.
+ * buffer holds the message in its first messageLength bytes, and must have room for the MAC:
+ * at least messageLength + crypto_secretbox_MACBYTES bytes. These are overwritten with the cipher text.
+ * Returns the length of the cipher text
+ */
+NAN_METHOD(bind_crypto_secretbox_easy_inplace) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(4,"arguments buffer, messageLength, nonce, and key are mandatory");
+
+    GET_ARG_AS_UCHAR(0, buffer);
+    if (!info[1]->IsUint32()) {
+        return Nan::ThrowTypeError("argument messageLength must be a positive integer");
+    }
+    size_t message_size = info[1]->Uint32Value();
+    GET_ARG_AS_UCHAR_LEN(2, nonce, crypto_secretbox_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(3, key, crypto_secretbox_KEYBYTES);
+
+    if (buffer_size < crypto_secretbox_MACBYTES || buffer_size - crypto_secretbox_MACBYTES < message_size) {
+        std::ostringstream oss;
+        oss << "argument buffer must be at least messageLength + " << crypto_secretbox_MACBYTES << " bytes long";
+        return Nan::ThrowRangeError(oss.str().c_str());
+    }
+
+    // libsodium moves the message after the MAC itself when input and output overlap
+    if (crypto_secretbox_easy(buffer, buffer, message_size, nonce, key) == 0) {
+        return info.GetReturnValue().Set(Nan::New<Number>((double) (message_size + crypto_secretbox_MACBYTES)));
+    } else {
+        return;
+    }
+}
+/**
+ * int crypto_secretbox_open_easy(
+ *    unsigned char *msg,
+ *    const unsigned char *ctxt,
+ *    unsigned long long clen,
+ *    const unsigned char *nonce,
+ *    const unsigned char *key)
+ * Parameters:
+ *    [out] msg   the buffer to place resulting plaintext.
+ *    [in]   ctxt   the ciphertext to be decrypted.
+ *    [in]   clen   the length of the ciphertext.
+ *    [in]   nonce   a randomly generated nonce.
+ *    [in]   key   the shared secret key.
+ *
+ * Returns:
+ *    0 if successful and -1 if verification fails.
+ *
  * Precondition:
  *    the nonce must be of length crypto_secretbox_NONCEBYTES
  *
@@ -1195,6 +2560,145 @@ NAN_METHOD(bind_crypto_secretbox_open_easy) {
     }
 }
 
+/**
+ * Same as crypto_secretbox_open_easy, but writes the cipher_text_size - crypto_secretbox_MACBYTES
+ * message bytes in out at offset. Returns the number of bytes written, or undefined if the
+ * verification fails, in which case that part of out is zeroed
+ */
+NAN_METHOD(bind_crypto_secretbox_open_easy_into) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(5,"arguments out, offset, cipherText, nonce, and key are mandatory");
+
+    GET_ARG_AS_UCHAR(2, cipher_text);
+    GET_ARG_AS_UCHAR_LEN(3, nonce, crypto_secretbox_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(4, key, crypto_secretbox_KEYBYTES);
+
+    if (cipher_text_size < crypto_secretbox_MACBYTES) {
+        std::ostringstream oss;
+        oss << "argument cipherText must have a length of at least " << crypto_secretbox_MACBYTES << " bytes";
+        return Nan::ThrowError(oss.str().c_str());
+    }
+    size_t message_size = cipher_text_size - crypto_secretbox_MACBYTES;
+    GET_OUTPUT_ARG(0, out, message_size);
+
+    if (crypto_secretbox_open_easy(out_ptr, cipher_text, cipher_text_size, nonce, key) == 0) {
+        return info.GetReturnValue().Set(Nan::New<Number>((double) message_size));
+    } else {
+        sodium_memzero(out_ptr, message_size);
+        return;
+    }
+}
+
+/**
+ * In place crypto_secretbox_open_easy.
+ * buffer holds the cipher text in its first cipherTextLength bytes (all of it if omitted). If it is verified,
+ * the message is written over the first cipherTextLength - crypto_secretbox_MACBYTES bytes and its length is returned.
+ * Otherwise returns undefined, and buffer is left untouched
+ */
+NAN_METHOD(bind_crypto_secretbox_open_easy_inplace) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3,"arguments buffer, nonce, and key are mandatory");
+
+    GET_ARG_AS_UCHAR(0, buffer);
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_secretbox_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, key, crypto_secretbox_KEYBYTES);
+
+    size_t cipher_text_size = buffer_size;
+    if (info.Length() > 3 && !info[3]->IsUndefined()) {
+        if (!info[3]->IsUint32() || info[3]->Uint32Value() > buffer_size) {
+            return Nan::ThrowRangeError("argument cipherTextLength must be a positive integer, at most the length of buffer");
+        }
+        cipher_text_size = info[3]->Uint32Value();
+    }
+
+    if (cipher_text_size < crypto_secretbox_MACBYTES) {
+        std::ostringstream oss;
+        oss << "the cipher text must have a length of at least " << crypto_secretbox_MACBYTES << " bytes";
+        return Nan::ThrowError(oss.str().c_str());
+    }
+
+    // The MAC is verified before anything is written
+    if (crypto_secretbox_open_easy(buffer, buffer, cipher_text_size, nonce, key) == 0) {
+        return info.GetReturnValue().Set(Nan::New<Number>((double) (cipher_text_size - crypto_secretbox_MACBYTES)));
+    } else {
+        return;
+    }
+}
+
+// { cipherText, mac } result of the detached bindings
+static Local<Object> detached_result(Local<Object> cipherText, Local<Object> mac) {
+    Local<Object> result = Nan::New<Object>();
+    Nan::Set(result, Nan::New<String>("cipherText").ToLocalChecked(), cipherText);
+    Nan::Set(result, Nan::New<String>("mac").ToLocalChecked(), mac);
+    return result;
+}
+
+/**
+ * Encrypts and authenticates a message, returning the MAC apart from the cipher text.
+ *
+ * int crypto_secretbox_detached(
+ *    unsigned char *c,
+ *    unsigned char *mac,
+ *    const unsigned char *m,
+ *    unsigned long long mlen,
+ *    const unsigned char *n,
+ *    const unsigned char *k)
+ *
+ * Returns { cipherText, mac }: cipherText has the length of the message, mac is crypto_secretbox_MACBYTES long
+ */
+NAN_METHOD(bind_crypto_secretbox_detached) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3,"arguments message, nonce, and key must be buffers");
+
+    GET_ARG_MESSAGE(0, message);
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_secretbox_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, key, crypto_secretbox_KEYBYTES);
+
+    NEW_BUFFER_AND_PTR(c, message_size);
+    NEW_RESULT_BUFFER_AND_PTR(mac, crypto_secretbox_MACBYTES);
+
+    if (crypto_secretbox_detached(c_ptr, mac_ptr, message, message_size, nonce, key) == 0) {
+        return info.GetReturnValue().Set(detached_result(c, mac));
+    } else {
+        return;
+    }
+}
+
+/**
+ * Verifies and decrypts a cipher text produced by crypto_secretbox_detached.
+ *
+ * int crypto_secretbox_open_detached(
+ *    unsigned char *m,
+ *    const unsigned char *c,
+ *    const unsigned char *mac,
+ *    unsigned long long clen,
+ *    const unsigned char *n,
+ *    const unsigned char *k)
+ *
+ * Returns the message, or undefined if verification fails
+ */
+NAN_METHOD(bind_crypto_secretbox_open_detached) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(4,"arguments cipherText, mac, nonce, and key must be buffers");
+
+    GET_ARG_AS_UCHAR(0, cipher_text);
+    GET_ARG_AS_UCHAR_LEN(1, mac, crypto_secretbox_MACBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, nonce, crypto_secretbox_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(3, key, crypto_secretbox_KEYBYTES);
+
+    NEW_BUFFER_AND_PTR(m, cipher_text_size);
+
+    if (crypto_secretbox_open_detached(m_ptr, cipher_text, mac, cipher_text_size, nonce, key) == 0) {
+        return info.GetReturnValue().Set(m);
+    } else {
+        return;
+    }
+}
+
 /**
  * Signs a given message using the signer's signing key.
  *
@@ -1224,7 +2728,7 @@ NAN_METHOD(bind_crypto_sign) {
 
     NUMBER_OF_MANDATORY_ARGS(2,"arguments message, and secretKey must be buffers");
 
-    GET_ARG_AS_UCHAR(0, message);
+    GET_ARG_MESSAGE(0, message);
     GET_ARG_AS_UCHAR_LEN(1, secretKey, crypto_sign_SECRETKEYBYTES);
 
     NEW_BUFFER_AND_PTR(sig, message_size + crypto_sign_BYTES);
@@ -1266,10 +2770,10 @@ NAN_METHOD(bind_crypto_sign_detached){
 
     NUMBER_OF_MANDATORY_ARGS(2, "arguments message, and secretKey must be buffers");
 
-    GET_ARG_AS_UCHAR(0, message);
+    GET_ARG_MESSAGE(0, message);
     GET_ARG_AS_UCHAR_LEN(1, secretKey, crypto_sign_SECRETKEYBYTES);
 
-    NEW_BUFFER_AND_PTR(sig, crypto_sign_BYTES);
+    NEW_RESULT_BUFFER_AND_PTR(sig, crypto_sign_BYTES);
 
     unsigned long long slen = 0;
     if ( crypto_sign_detached(sig_ptr, &slen, message, message_size, secretKey) == 0){
@@ -1279,6 +2783,27 @@ NAN_METHOD(bind_crypto_sign_detached){
     }
 }
 
+/**
+ * Same as crypto_sign_detached, but writes the crypto_sign_BYTES signature in out at offset.
+ * Returns the number of bytes written
+ */
+NAN_METHOD(bind_crypto_sign_detached_into){
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(4, "arguments out, offset, message, and secretKey are mandatory");
+
+    GET_ARG_MESSAGE(2, message);
+    GET_ARG_AS_UCHAR_LEN(3, secretKey, crypto_sign_SECRETKEYBYTES);
+    GET_OUTPUT_ARG(0, out, crypto_sign_BYTES);
+
+    unsigned long long slen = 0;
+    if ( crypto_sign_detached(out_ptr, &slen, message, message_size, secretKey) == 0){
+        return info.GetReturnValue().Set(Nan::New<Number>((double) slen));
+    } else {
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+}
+
 /**
  * Generates a signing/verification key pair.
  *
@@ -1444,7 +2969,7 @@ NAN_METHOD(bind_crypto_sign_verify_detached){
     NUMBER_OF_MANDATORY_ARGS(3, "arguements signature, message and publicKey must be buffers");
 
     GET_ARG_AS_UCHAR_LEN(0, signature, crypto_sign_BYTES);
-    GET_ARG_AS_UCHAR(1, message);
+    GET_ARG_MESSAGE(1, message);
     GET_ARG_AS_UCHAR_LEN(2, publicKey, crypto_sign_PUBLICKEYBYTES);
 
     if (crypto_sign_verify_detached(signature, message, message_size, publicKey) == 0){
@@ -1454,117 +2979,549 @@ NAN_METHOD(bind_crypto_sign_verify_detached){
     }
 }
 
-/**
-* Translates the Ed25519 public key to Curve25519
-* int crypto_sign_ed25519_pk_to_curve25519  (
-*    unsigned char* curve25519_pk,
-*    const unsigned char* ed25519_pk
-* )
-*
-* Parameters:
-*    [out]  curve25519_pk   the resulting Curve25519 public key
-*    [in]   ed25519_pk      the source Ed25519 public key
-*
-* Returns:
-*    0 if operation is successful.
+/*
+* Batch helpers.
+* A batch argument is either an Array of Buffers, or a single Buffer holding
+* the items back to back, all itemSize bytes long.
 */
-NAN_METHOD(bind_crypto_sign_ed25519_pk_to_curve25519){
-    Nan::EscapableHandleScope scope;
+struct BatchItems {
+    std::vector<const unsigned char*> ptrs;
+    std::vector<size_t> sizes;
+};
+
+// Number of items of a batch argument. itemSize is only used for packed buffers. Throws and returns -1 on error
+static long long batch_count(Local<Value> arg, const char* name, size_t itemSize) {
+    if (arg->IsArray()) {
+        return (long long) Local<Array>::Cast(arg)->Length();
+    }
+    unsigned char* data;
+    size_t length;
+    if (itemSize > 0 && get_bytes(arg, &data, &length)) {
+        if (length % itemSize != 0) {
+            std::ostringstream oss;
+            oss << "argument " << name << " length must be a multiple of " << itemSize << " bytes";
+            Nan::ThrowError(oss.str().c_str());
+            return -1;
+        }
+        return (long long) (length / itemSize);
+    }
+    std::ostringstream oss;
+    oss << "argument " << name << " must be an array of buffers" << (itemSize > 0 ? " or a buffer" : "");
+    Nan::ThrowTypeError(oss.str().c_str());
+    return -1;
+}
 
-    NUMBER_OF_MANDATORY_ARGS(1, "arguments ed25519_pk must be a buffer");
+/*
+* Reads count items of a batch argument. When itemSize > 0, every item must be itemSize bytes long.
+* When shared is true, a single itemSize buffer is also accepted and used for every item.
+* Throws and returns false on error
+*/
+static bool get_batch_items(Local<Value> arg, const char* name, size_t count, size_t itemSize, bool shared, BatchItems* items) {
+    items->ptrs.resize(count);
+    items->sizes.resize(count);
+
+    if (arg->IsArray()) {
+        Local<Array> array = Local<Array>::Cast(arg);
+        if (array->Length() != count) {
+            std::ostringstream oss;
+            oss << "argument " << name << " must have " << count << " items";
+            Nan::ThrowError(oss.str().c_str());
+            return false;
+        }
+        for (size_t i = 0; i < count; i++) {
+            Local<Value> item = Nan::Get(array, (uint32_t) i).ToLocalChecked();
+            unsigned char* data;
+            if (!get_bytes(item, &data, &items->sizes[i])) {
+                std::ostringstream oss;
+                oss << "item " << i << " of argument " << name << " must be a buffer";
+                Nan::ThrowTypeError(oss.str().c_str());
+                return false;
+            }
+            items->ptrs[i] = data;
+            if (itemSize > 0 && items->sizes[i] != itemSize) {
+                std::ostringstream oss;
+                oss << "item " << i << " of argument " << name << " must be " << itemSize << " bytes long";
+                Nan::ThrowError(oss.str().c_str());
+                return false;
+            }
+        }
+        return true;
+    }
 
-    GET_ARG_AS_UCHAR_LEN(0, ed25519_pk, crypto_sign_PUBLICKEYBYTES);
+    unsigned char* data;
+    size_t length;
+    if (itemSize > 0 && get_bytes(arg, &data, &length)) {
+        bool isShared = shared && length == itemSize;
+        if (!isShared && length != count * itemSize) {
+            std::ostringstream oss;
+            oss << "argument " << name << " must be " << count * itemSize << " bytes long";
+            if (shared) oss << ", or " << itemSize << " bytes long to be used for every item";
+            Nan::ThrowError(oss.str().c_str());
+            return false;
+        }
+        for (size_t i = 0; i < count; i++) {
+            items->ptrs[i] = isShared ? data : data + i * itemSize;
+            items->sizes[i] = itemSize;
+        }
+        return true;
+    }
 
-    NEW_BUFFER_AND_PTR(curve25519_pk, crypto_box_PUBLICKEYBYTES);
+    std::ostringstream oss;
+    oss << "argument " << name << " must be an array of buffers" << (itemSize > 0 ? " or a buffer" : "");
+    Nan::ThrowTypeError(oss.str().c_str());
+    return false;
+}
 
-    if (crypto_sign_ed25519_pk_to_curve25519(curve25519_pk_ptr, ed25519_pk) == 0){
-        return info.GetReturnValue().Set(curve25519_pk);
+/*
+* Reads count variable-length items packed in one buffer. offsets holds count + 1
+* increasing offsets into the buffer (an Array of numbers or a typed array); item i is [offsets[i], offsets[i + 1]).
+* Throws and returns false on error
+*/
+static bool get_batch_packed_items(Local<Value> bufferArg, Local<Value> offsetsArg, const char* name, size_t count, BatchItems* items) {
+    unsigned char* data;
+    size_t length;
+    if (!get_bytes(bufferArg, &data, &length)) {
+        std::ostringstream oss;
+        oss << "argument " << name << " must be a buffer";
+        Nan::ThrowTypeError(oss.str().c_str());
+        return false;
     }
-    return info.GetReturnValue().Set(Nan::Undefined());
+    if (!offsetsArg->IsObject()) {
+        Nan::ThrowTypeError("argument offsets must be an array or a typed array");
+        return false;
+    }
+    Local<Object> offsets = offsetsArg->ToObject();
+    Local<Value> offsetsLength = Nan::Get(offsets, Nan::New<String>("length").ToLocalChecked()).ToLocalChecked();
+    if (!offsetsLength->IsNumber() || offsetsLength->NumberValue() != (double) (count + 1)) {
+        std::ostringstream oss;
+        oss << "argument offsets must have " << count + 1 << " items";
+        Nan::ThrowError(oss.str().c_str());
+        return false;
+    }
+
+    items->ptrs.resize(count);
+    items->sizes.resize(count);
+    double previous = 0;
+    for (size_t i = 0; i <= count; i++) {
+        double offset = Nan::Get(offsets, (uint32_t) i).ToLocalChecked()->NumberValue();
+        if (!(offset >= previous && offset <= (double) length)) {
+            Nan::ThrowRangeError("argument offsets must be increasing, and within the buffer");
+            return false;
+        }
+        if (i > 0) {
+            items->ptrs[i - 1] = data + (size_t) previous;
+            items->sizes[i - 1] = (size_t) (offset - previous);
+        }
+        previous = offset;
+    }
+    return true;
 }
 
-/**
-* Translates the Ed25519 secret key to Curve25519
-* int crypto_sign_ed25519_sk_to_curve25519  (
-*    unsigned char* curve25519_sk,
-*    const unsigned char* ed25519_sk
-* )
-*
-* Parameters:
-*    [out]  curve25519_sk   the resulting Curve25519 secret key
-*    [in]   ed25519_sk      the source Ed25519 secret key
-*
-* Returns:
-*    0 if operation is successful.
+/*
+* Copies the items of several batches into one arena, and points them there.
+* Used by the async forms, which must not depend on the JS objects staying untouched
 */
-NAN_METHOD(bind_crypto_sign_ed25519_sk_to_curve25519){
-    Nan::EscapableHandleScope scope;
+static void copy_batch_items(std::vector<BatchItems*> const& batches, std::vector<unsigned char>* arena) {
+    size_t total = 0;
+    for (size_t b = 0; b < batches.size(); b++) {
+        for (size_t i = 0; i < batches[b]->sizes.size(); i++) {
+            total += batches[b]->sizes[i];
+        }
+    }
+    arena->resize(total > 0 ? total : 1);
+    size_t position = 0;
+    for (size_t b = 0; b < batches.size(); b++) {
+        for (size_t i = 0; i < batches[b]->sizes.size(); i++) {
+            unsigned char* destination = &(*arena)[0] + position;
+            memcpy(destination, batches[b]->ptrs[i], batches[b]->sizes[i]);
+            batches[b]->ptrs[i] = destination;
+            position += batches[b]->sizes[i];
+        }
+    }
+}
 
-    NUMBER_OF_MANDATORY_ARGS(1, "arguments ed25519_sk must be a buffer");
+/*
+* Batch Ed25519 verification
+*/
+#define SIGN_VERIFY_BATCH_GRAIN 8
+
+struct SignVerifyBatch {
+    BatchItems signatures;
+    BatchItems messages;
+    BatchItems publicKeys;
+    unsigned char* results;
+};
+
+static void sign_verify_batch_range(size_t begin, size_t end, void* data) {
+    SignVerifyBatch* batch = static_cast<SignVerifyBatch*>(data);
+    for (size_t i = begin; i < end; i++) {
+        batch->results[i] = crypto_sign_verify_detached(batch->signatures.ptrs[i], batch->messages.ptrs[i],
+            batch->messages.sizes[i], batch->publicKeys.ptrs[i]) == 0 ? 1 : 0;
+    }
+}
 
-    GET_ARG_AS_UCHAR_LEN(0, ed25519_sk, crypto_sign_SECRETKEYBYTES);
+/*
+* Parses (signatures, messages, publicKeys) or (signatures, messageBuffer, offsets, publicKeys),
+* argc excluding the callback. Throws and returns false on error
+*/
+static bool get_sign_verify_batch_args(NAN_METHOD_ARGS_TYPE info, int argc, SignVerifyBatch* batch) {
+    if (argc < 3) {
+        Nan::ThrowError("arguments signatures, messages and publicKeys are mandatory");
+        return false;
+    }
+    long long count = batch_count(info[0], "signatures", crypto_sign_BYTES);
+    if (count < 0) return false;
 
-    NEW_BUFFER_AND_PTR(curve25519_sk, crypto_box_SECRETKEYBYTES);
+    if (!get_batch_items(info[0], "signatures", (size_t) count, crypto_sign_BYTES, false, &batch->signatures)) return false;
 
-    if (crypto_sign_ed25519_sk_to_curve25519(curve25519_sk_ptr, ed25519_sk) == 0){
-        return info.GetReturnValue().Set(curve25519_sk);
+    int publicKeysIndex = 2;
+    if (!info[1]->IsArray() && is_bytes(info[1])) {
+        if (argc < 4) {
+            Nan::ThrowError("arguments signatures, messages, offsets and publicKeys are mandatory when messages are packed in one buffer");
+            return false;
+        }
+        if (!get_batch_packed_items(info[1], info[2], "messages", (size_t) count, &batch->messages)) return false;
+        publicKeysIndex = 3;
+    } else if (!get_batch_items(info[1], "messages", (size_t) count, 0, false, &batch->messages)) {
+        return false;
     }
-    return info.GetReturnValue().Set(Nan::Undefined());
+
+    return get_batch_items(info[publicKeysIndex], "publicKeys", (size_t) count, crypto_sign_PUBLICKEYBYTES, true, &batch->publicKeys);
 }
 
+class SignVerifyBatchWorker : public Nan::AsyncWorker {
+public:
+    SignVerifyBatchWorker(Nan::Callback* callback, SignVerifyBatch* batch)
+        : Nan::AsyncWorker(callback), batch(batch) {
+        std::vector<BatchItems*> batches;
+        batches.push_back(&batch->signatures);
+        batches.push_back(&batch->messages);
+        batches.push_back(&batch->publicKeys);
+        copy_batch_items(batches, &arena);
+    }
+
+    ~SignVerifyBatchWorker() {
+        if (batch->results != 0) {
+            free(batch->results);
+        }
+        delete batch;
+    }
+
+    void Execute() {
+        size_t count = batch->signatures.ptrs.size();
+        batch->results = (unsigned char*) malloc(count > 0 ? count : 1);
+        if (batch->results == 0) {
+            SetErrorMessage("out of memory");
+            return;
+        }
+        WorkerPool::ParallelFor(count, SIGN_VERIFY_BATCH_GRAIN, sign_verify_batch_range, batch);
+    }
+
+    void HandleOKCallback() {
+        Nan::HandleScope scope;
+
+        // The new buffer takes ownership of the results
+        Local<Value> argv[] = { Nan::Null(), Nan::NewBuffer((char*) batch->results, batch->signatures.ptrs.size()).ToLocalChecked() };
+        batch->results = 0;
+        callback->Call(2, argv);
+    }
+
+private:
+    SignVerifyBatch* batch;
+    std::vector<unsigned char> arena;
+};
+
 /**
- * Encrypts a message given the senders secret key, and receivers public key.
- * int crypto_box	(
- *    unsigned char * ctxt,
- *    const unsigned char * msg,
- *    unsigned long long mlen,
- *    const unsigned char * nonce,
- *    const unsigned char * pk,
- *    const unsigned char * sk)
- *
- * Parameters:
- *    [out] ctxt    the buffer for the cipher-text.
- *    [in] 	msg     the message to be encrypted.
- *    [in] 	mlen    the length of msg.
- *    [in] 	nonce   a randomly generated nonce.
- *    [in] 	pk 	    the receivers public key, used for encryption.
- *    [in] 	sk 	    the senders private key, used for signing.
+ * Verifies many detached Ed25519 signatures at once, spread over the worker pool threads.
  *
- * Returns:
- *    0 if operation is successful.
+ * Buffer|Array signatures, Array messages, Buffer|Array publicKeys, [Function callback]
+ * Buffer|Array signatures, Buffer messages, Array|TypedArray offsets, Buffer|Array publicKeys, [Function callback]
  *
- * Precondition:
- *    first crypto_box_ZEROBYTES of msg be all 0.
- *    the nonce must have size crypto_box_NONCEBYTES.
+ * signatures: array of crypto_sign_BYTES buffers, or one buffer of N * crypto_sign_BYTES
+ * messages: array of buffers, or one buffer with the messages back to back, described by N + 1 offsets
+ * publicKeys: array of crypto_sign_PUBLICKEYBYTES buffers, one buffer of N * crypto_sign_PUBLICKEYBYTES,
+ *   or a single public key used for every message
  *
- * Postcondition:
- *    first crypto_box_BOXZEROBYTES of ctxt be all 0.
- *    first mlen bytes of ctxt will contain the ciphertext.
+ * Returns (or passes to callback(err, results)) a buffer of N bytes: 1 where the signature is valid, 0 otherwise
  */
-NAN_METHOD(bind_crypto_box) {
+NAN_METHOD(bind_crypto_sign_verify_detached_batch) {
     Nan::EscapableHandleScope scope;
 
-    NUMBER_OF_MANDATORY_ARGS(4,"arguments message, nonce, publicKey and secretKey must be buffers");
-
-    GET_ARG_AS_UCHAR(0, message);
-    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_box_NONCEBYTES);
-    GET_ARG_AS_UCHAR_LEN(2, publicKey, crypto_box_PUBLICKEYBYTES);
-    GET_ARG_AS_UCHAR_LEN(3, secretKey, crypto_box_SECRETKEYBYTES);
-
-    NEW_BUFFER_AND_PTR(msg, message_size + crypto_box_ZEROBYTES);
+    bool async = info.Length() > 0 && info[info.Length() - 1]->IsFunction();
+    int argc = async ? info.Length() - 1 : info.Length();
 
-    // Fill the first crypto_box_ZEROBYTES with 0
-    unsigned int i;
-    for(i=0; i < crypto_box_ZEROBYTES; i++) {
-       msg_ptr[i] = 0U;
+    SignVerifyBatch* batch = new SignVerifyBatch();
+    batch->results = 0;
+    if (!get_sign_verify_batch_args(info, argc, batch)) {
+        delete batch;
+        return;
     }
-    //Copy the message to the new buffer
-    memcpy((void*) (msg_ptr + crypto_box_ZEROBYTES), (void *) message, message_size);
-    message_size += crypto_box_ZEROBYTES;
 
-    NEW_BUFFER_AND_PTR(ctxt, message_size);
+    if (async) {
+        GET_CALLBACK_LAST(callback);
+        WorkerPool::QueueWorker(new SignVerifyBatchWorker(callback, batch));
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+
+    size_t count = batch->signatures.ptrs.size();
+    NEW_BUFFER_AND_PTR(results, count);
+    batch->results = results_ptr;
+    WorkerPool::ParallelFor(count, SIGN_VERIFY_BATCH_GRAIN, sign_verify_batch_range, batch);
+    delete batch;
+
+    return info.GetReturnValue().Set(results);
+}
+
+/*
+* Batch Ed25519 signing
+*/
+#define SIGN_BATCH_GRAIN 8
+
+struct SignBatch {
+    BatchItems messages;
+    unsigned char secretKey[crypto_sign_SECRETKEYBYTES];
+    unsigned char* signatures;
+};
+
+static void sign_batch_range(size_t begin, size_t end, void* data) {
+    SignBatch* batch = static_cast<SignBatch*>(data);
+    for (size_t i = begin; i < end; i++) {
+        crypto_sign_detached(batch->signatures + i * crypto_sign_BYTES, NULL, batch->messages.ptrs[i],
+            batch->messages.sizes[i], batch->secretKey);
+    }
+}
+
+/*
+* Parses (messages, secretKey) or (messageBuffer, offsets, secretKey), argc excluding the callback.
+* Throws and returns false on error
+*/
+static bool get_sign_batch_args(NAN_METHOD_ARGS_TYPE info, int argc, SignBatch* batch) {
+    int secretKeyIndex = 1;
+    if (argc > 0 && !info[0]->IsArray() && is_bytes(info[0])) {
+        if (argc < 3) {
+            Nan::ThrowError("arguments messages, offsets and secretKey are mandatory when messages are packed in one buffer");
+            return false;
+        }
+        if (!info[1]->IsObject()) {
+            Nan::ThrowTypeError("argument offsets must be an array or a typed array");
+            return false;
+        }
+        Local<Value> offsetsLength = Nan::Get(info[1]->ToObject(), Nan::New<String>("length").ToLocalChecked()).ToLocalChecked();
+        if (!offsetsLength->IsNumber() || offsetsLength->NumberValue() < 1) {
+            Nan::ThrowError("argument offsets must have at least one item");
+            return false;
+        }
+        size_t count = (size_t) offsetsLength->NumberValue() - 1;
+        if (!get_batch_packed_items(info[0], info[1], "messages", count, &batch->messages)) return false;
+        secretKeyIndex = 2;
+    } else {
+        if (argc < 2) {
+            Nan::ThrowError("arguments messages and secretKey are mandatory");
+            return false;
+        }
+        long long count = batch_count(info[0], "messages", 0);
+        if (count < 0) return false;
+        if (!get_batch_items(info[0], "messages", (size_t) count, 0, false, &batch->messages)) return false;
+    }
+
+    unsigned char* secretKey;
+    size_t secretKeySize;
+    if (!get_bytes(info[secretKeyIndex], &secretKey, &secretKeySize) || secretKeySize != crypto_sign_SECRETKEYBYTES) {
+        std::ostringstream oss;
+        oss << "argument secretKey must be a " << crypto_sign_SECRETKEYBYTES << " bytes buffer";
+        Nan::ThrowTypeError(oss.str().c_str());
+        return false;
+    }
+    memcpy(batch->secretKey, secretKey, crypto_sign_SECRETKEYBYTES);
+    return true;
+}
+
+static void delete_sign_batch(SignBatch* batch) {
+    sodium_memzero(batch->secretKey, crypto_sign_SECRETKEYBYTES);
+    delete batch;
+}
+
+class SignBatchWorker : public Nan::AsyncWorker {
+public:
+    SignBatchWorker(Nan::Callback* callback, SignBatch* batch)
+        : Nan::AsyncWorker(callback), batch(batch) {
+        std::vector<BatchItems*> batches;
+        batches.push_back(&batch->messages);
+        copy_batch_items(batches, &arena);
+    }
+
+    ~SignBatchWorker() {
+        if (batch->signatures != 0) {
+            free(batch->signatures);
+        }
+        delete_sign_batch(batch);
+    }
+
+    void Execute() {
+        size_t size = batch->messages.ptrs.size() * crypto_sign_BYTES;
+        batch->signatures = (unsigned char*) malloc(size > 0 ? size : 1);
+        if (batch->signatures == 0) {
+            SetErrorMessage("out of memory");
+            return;
+        }
+        WorkerPool::ParallelFor(batch->messages.ptrs.size(), SIGN_BATCH_GRAIN, sign_batch_range, batch);
+    }
+
+    void HandleOKCallback() {
+        Nan::HandleScope scope;
+
+        // The new buffer takes ownership of the signatures
+        Local<Value> argv[] = { Nan::Null(), Nan::NewBuffer((char*) batch->signatures, batch->messages.ptrs.size() * crypto_sign_BYTES).ToLocalChecked() };
+        batch->signatures = 0;
+        callback->Call(2, argv);
+    }
+
+private:
+    SignBatch* batch;
+    std::vector<unsigned char> arena;
+};
+
+/**
+ * Signs many messages with the same secret key, spread over the worker pool threads.
+ *
+ * Array messages, Buffer secretKey, [Function callback]
+ * Buffer messages, Array|TypedArray offsets, Buffer secretKey, [Function callback]
+ *
+ * messages: array of buffers, or one buffer with the messages back to back, described by N + 1 offsets
+ *
+ * Returns (or passes to callback(err, signatures)) one buffer of N * crypto_sign_BYTES,
+ * holding the detached signatures in the order of the messages
+ */
+NAN_METHOD(bind_crypto_sign_detached_batch) {
+    Nan::EscapableHandleScope scope;
+
+    bool async = info.Length() > 0 && info[info.Length() - 1]->IsFunction();
+    int argc = async ? info.Length() - 1 : info.Length();
+
+    SignBatch* batch = new SignBatch();
+    batch->signatures = 0;
+    if (!get_sign_batch_args(info, argc, batch)) {
+        delete_sign_batch(batch);
+        return;
+    }
+
+    if (async) {
+        GET_CALLBACK_LAST(callback);
+        WorkerPool::QueueWorker(new SignBatchWorker(callback, batch));
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+
+    size_t count = batch->messages.ptrs.size();
+    NEW_BUFFER_AND_PTR(signatures, count * crypto_sign_BYTES);
+    batch->signatures = signatures_ptr;
+    WorkerPool::ParallelFor(count, SIGN_BATCH_GRAIN, sign_batch_range, batch);
+    delete_sign_batch(batch);
+
+    return info.GetReturnValue().Set(signatures);
+}
+
+/**
+* Translates the Ed25519 public key to Curve25519
+* int crypto_sign_ed25519_pk_to_curve25519  (
+*    unsigned char* curve25519_pk,
+*    const unsigned char* ed25519_pk
+* )
+*
+* Parameters:
+*    [out]  curve25519_pk   the resulting Curve25519 public key
+*    [in]   ed25519_pk      the source Ed25519 public key
+*
+* Returns:
+*    0 if operation is successful.
+*/
+NAN_METHOD(bind_crypto_sign_ed25519_pk_to_curve25519){
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(1, "arguments ed25519_pk must be a buffer");
+
+    GET_ARG_AS_UCHAR_LEN(0, ed25519_pk, crypto_sign_PUBLICKEYBYTES);
+
+    NEW_BUFFER_AND_PTR(curve25519_pk, crypto_box_PUBLICKEYBYTES);
+
+    if (crypto_sign_ed25519_pk_to_curve25519(curve25519_pk_ptr, ed25519_pk) == 0){
+        return info.GetReturnValue().Set(curve25519_pk);
+    }
+    return info.GetReturnValue().Set(Nan::Undefined());
+}
+
+/**
+* Translates the Ed25519 secret key to Curve25519
+* int crypto_sign_ed25519_sk_to_curve25519  (
+*    unsigned char* curve25519_sk,
+*    const unsigned char* ed25519_sk
+* )
+*
+* Parameters:
+*    [out]  curve25519_sk   the resulting Curve25519 secret key
+*    [in]   ed25519_sk      the source Ed25519 secret key
+*
+* Returns:
+*    0 if operation is successful.
+*/
+NAN_METHOD(bind_crypto_sign_ed25519_sk_to_curve25519){
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(1, "arguments ed25519_sk must be a buffer");
+
+    GET_ARG_AS_UCHAR_LEN(0, ed25519_sk, crypto_sign_SECRETKEYBYTES);
+
+    NEW_BUFFER_AND_PTR(curve25519_sk, crypto_box_SECRETKEYBYTES);
+
+    if (crypto_sign_ed25519_sk_to_curve25519(curve25519_sk_ptr, ed25519_sk) == 0){
+        return info.GetReturnValue().Set(curve25519_sk);
+    }
+    return info.GetReturnValue().Set(Nan::Undefined());
+}
+
+/**
+ * Encrypts a message given the senders secret key, and receivers public key.
+ * int crypto_box	(
+ *    unsigned char * ctxt,
+ *    const unsigned char * msg,
+ *    unsigned long long mlen,
+ *    const unsigned char * nonce,
+ *    const unsigned char * pk,
+ *    const unsigned char * sk)
+ *
+ * Parameters:
+ *    [out] ctxt    the buffer for the cipher-text.
+ *    [in] 	msg     the message to be encrypted.
+ *    [in] 	mlen    the length of msg.
+ *    [in] 	nonce   a randomly generated nonce.
+ *    [in] 	pk 	    the receivers public key, used for encryption.
+ *    [in] 	sk 	    the senders private key, used for signing.
+ *
+ * Returns:
+ *    0 if operation is successful.
+ *
+ * Precondition:
+ *    first crypto_box_ZEROBYTES of msg be all 0.
+ *    the nonce must have size crypto_box_NONCEBYTES.
+ *
+ * Postcondition:
+ *    first crypto_box_BOXZEROBYTES of ctxt be all 0.
+ *    first mlen bytes of ctxt will contain the ciphertext.
+ */
+NAN_METHOD(bind_crypto_box) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(4,"arguments message, nonce, publicKey and secretKey must be buffers");
+
+    GET_ARG_MESSAGE(0, message);
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_box_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, publicKey, crypto_box_PUBLICKEYBYTES);
+    GET_ARG_AS_UCHAR_LEN(3, secretKey, crypto_box_SECRETKEYBYTES);
+
+    // crypto_box_BOXZEROBYTES zeros followed by the crypto_box_easy output, see bind_crypto_secretbox
+    NEW_BUFFER_AND_PTR(ctxt, message_size + crypto_box_ZEROBYTES);
+    memset(ctxt_ptr, 0, crypto_box_BOXZEROBYTES);
 
-    if( crypto_box(ctxt_ptr, msg_ptr, message_size, nonce, publicKey, secretKey) == 0) {
+    if( crypto_box_easy(ctxt_ptr + crypto_box_BOXZEROBYTES, message, message_size, nonce, publicKey, secretKey) == 0) {
         return info.GetReturnValue().Set(ctxt);
     }
     return info.GetReturnValue().Set(Nan::Undefined());
@@ -1602,7 +3559,7 @@ NAN_METHOD(bind_crypto_box_easy) {
 
     NUMBER_OF_MANDATORY_ARGS(4,"arguments message, nonce, publicKey and secretKey must be buffers");
 
-    GET_ARG_AS_UCHAR(0, message);
+    GET_ARG_MESSAGE(0, message);
     GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_box_NONCEBYTES);
     GET_ARG_AS_UCHAR_LEN(2, publicKey, crypto_box_PUBLICKEYBYTES);
     GET_ARG_AS_UCHAR_LEN(3, secretKey, crypto_box_SECRETKEYBYTES);
@@ -1616,6 +3573,28 @@ NAN_METHOD(bind_crypto_box_easy) {
     }
 }
 
+/**
+ * Same as crypto_box_easy, but writes the message_size + crypto_box_MACBYTES
+ * cipher text bytes in out at offset. Returns the number of bytes written
+ */
+NAN_METHOD(bind_crypto_box_easy_into) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(6,"arguments out, offset, message, nonce, publicKey and secretKey are mandatory");
+
+    GET_ARG_MESSAGE(2, message);
+    GET_ARG_AS_UCHAR_LEN(3, nonce, crypto_box_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(4, publicKey, crypto_box_PUBLICKEYBYTES);
+    GET_ARG_AS_UCHAR_LEN(5, secretKey, crypto_box_SECRETKEYBYTES);
+    GET_OUTPUT_ARG(0, out, message_size + crypto_box_MACBYTES);
+
+    if (crypto_box_easy(out_ptr, message, message_size, nonce, publicKey, secretKey) == 0) {
+        return info.GetReturnValue().Set(Nan::New<Number>((double) (message_size + crypto_box_MACBYTES)));
+    } else {
+        return;
+    }
+}
+
 /**
  * Randomly generates a secret key and a corresponding public key.
  *
@@ -1657,274 +3636,1363 @@ NAN_METHOD(bind_crypto_box_keypair) {
 }
 
 /**
- * Decrypts a ciphertext ctxt given the receivers private key, and senders public key.
- *
- * int crypto_box_open(
- *    unsigned char *       msg,
- *    const unsigned char * ctxt,
- *    unsigned long long    clen,
- *    const unsigned char * nonce,
- *    const unsigned char * pk,
- *    const unsigned char * sk)
- *
- * Parameters:
- *     [out] msg     the buffer to place resulting plaintext.
- *     [in]  ctxt    the ciphertext to be decrypted.
- *     [in]  clen    the length of the ciphertext.
- *     [in]  nonce   a randomly generated.
- *     [in]  pk      the senders public key, used for verification.
- *     [in]  sk      the receivers private key, used for decryption.
- *
- Returns:
- *     0 if successful and -1 if verification fails.
- *
- Precondition:
- *     first crypto_box_BOXZEROBYTES of ctxt be all 0.
- *     the nonce must have size crypto_box_NONCEBYTES.
- *
- * Postcondition:
- *     first clen bytes of msg will contain the plaintext.
- *     first crypto_box_ZEROBYTES of msg will be all 0.
+ * Decrypts a ciphertext ctxt given the receivers private key, and senders public key.
+ *
+ * int crypto_box_open(
+ *    unsigned char *       msg,
+ *    const unsigned char * ctxt,
+ *    unsigned long long    clen,
+ *    const unsigned char * nonce,
+ *    const unsigned char * pk,
+ *    const unsigned char * sk)
+ *
+ * Parameters:
+ *     [out] msg     the buffer to place resulting plaintext.
+ *     [in]  ctxt    the ciphertext to be decrypted.
+ *     [in]  clen    the length of the ciphertext.
+ *     [in]  nonce   a randomly generated.
+ *     [in]  pk      the senders public key, used for verification.
+ *     [in]  sk      the receivers private key, used for decryption.
+ *
+ Returns:
+ *     0 if successful and -1 if verification fails.
+ *
+ Precondition:
+ *     first crypto_box_BOXZEROBYTES of ctxt be all 0.
+ *     the nonce must have size crypto_box_NONCEBYTES.
+ *
+ * Postcondition:
+ *     first clen bytes of msg will contain the plaintext.
+ *     first crypto_box_ZEROBYTES of msg will be all 0.
+ */
+NAN_METHOD(bind_crypto_box_open) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(4,"arguments cipherText, nonce, publicKey and secretKey must be buffers");
+
+    GET_ARG_AS_UCHAR(0, cipherText);
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_box_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, publicKey, crypto_box_PUBLICKEYBYTES);
+    GET_ARG_AS_UCHAR_LEN(3, secretKey, crypto_box_SECRETKEYBYTES);
+
+    // API requires that the first crypto_box_BOXZEROBYTES of ctxt be 0, followed by the MAC, so lets check
+    if( cipherText_size < crypto_box_ZEROBYTES ) {
+        std::ostringstream oss;
+        oss << "argument cipherText must have a length of at least " << crypto_box_ZEROBYTES << " bytes";
+        return Nan::ThrowError(oss.str().c_str());
+    }
+
+    unsigned int i;
+    for(i=0; i < crypto_box_BOXZEROBYTES; i++) {
+        if( cipherText[i] ) break;
+    }
+    if( i < crypto_box_BOXZEROBYTES ) {
+        std::ostringstream oss;
+        oss << "the first " << crypto_box_BOXZEROBYTES << " bytes of argument cipherText must be 0";
+        return Nan::ThrowError(oss.str().c_str());
+    }
+
+    // Decrypt the crypto_box_open_easy formatted part straight into the unpadded result
+    NEW_BUFFER_AND_PTR(plain_text, cipherText_size - crypto_box_ZEROBYTES);
+
+    if (crypto_box_open_easy(plain_text_ptr, cipherText + crypto_box_BOXZEROBYTES,
+                             cipherText_size - crypto_box_BOXZEROBYTES, nonce, publicKey, secretKey) == 0) {
+        return info.GetReturnValue().Set(plain_text);
+    } else {
+        return;
+    }
+}
+
+/**
+ * Decrypts a ciphertext ctxt given the receivers private key, and senders public key.
+ *
+ * int crypto_box_open_easy(
+ *    unsigned char *       msg,
+ *    const unsigned char * ctxt,
+ *    unsigned long long    clen,
+ *    const unsigned char * nonce,
+ *    const unsigned char * pk,
+ *    const unsigned char * sk)
+ *
+ * Parameters:
+ *     [out] msg     the buffer to place resulting plaintext.
+ *     [in]  ctxt    the ciphertext to be decrypted.
+ *     [in]  clen    the length of the ciphertext.
+ *     [in]  nonce   a randomly generated.
+ *     [in]  pk      the senders public key, used for verification.
+ *     [in]  sk      the receivers private key, used for decryption.
+ *
+ Returns:
+ *     0 if successful and -1 if verification fails.
+ *
+ Precondition:
+ *     the nonce must have size crypto_box_NONCEBYTES.
+ *
+ * Postcondition:
+ *     first clen bytes of msg will contain the plaintext.
+ */
+NAN_METHOD(bind_crypto_box_open_easy) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(4,"arguments cipherText, nonce, publicKey and secretKey must be buffers");
+
+    GET_ARG_AS_UCHAR(0, cipherText);
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_box_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, publicKey, crypto_box_PUBLICKEYBYTES);
+    GET_ARG_AS_UCHAR_LEN(3, secretKey, crypto_box_SECRETKEYBYTES);
+
+    // cipherText should have crypto_box_MACBYTES + encrypted message chars so lets check
+    if (cipherText_size < crypto_box_MACBYTES) {
+        std::ostringstream oss;
+        oss << "argument cipherText must have a length of at least " << crypto_box_MACBYTES << " bytes";
+        return Nan::ThrowError(oss.str().c_str());
+    }
+
+    NEW_BUFFER_AND_PTR(msg, cipherText_size - crypto_box_MACBYTES);
+
+    if( crypto_box_open_easy(msg_ptr, cipherText, cipherText_size, nonce, publicKey, secretKey) == 0) {
+        return info.GetReturnValue().Set(msg);
+    } else {
+        return;
+    }
+}
+
+/**
+ * Same as crypto_box_open_easy, but writes the cipherText_size - crypto_box_MACBYTES
+ * message bytes in out at offset. Returns the number of bytes written, or undefined if the
+ * verification fails, in which case that part of out is zeroed
+ */
+NAN_METHOD(bind_crypto_box_open_easy_into) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(6,"arguments out, offset, cipherText, nonce, publicKey and secretKey are mandatory");
+
+    GET_ARG_AS_UCHAR(2, cipherText);
+    GET_ARG_AS_UCHAR_LEN(3, nonce, crypto_box_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(4, publicKey, crypto_box_PUBLICKEYBYTES);
+    GET_ARG_AS_UCHAR_LEN(5, secretKey, crypto_box_SECRETKEYBYTES);
+
+    if (cipherText_size < crypto_box_MACBYTES) {
+        std::ostringstream oss;
+        oss << "argument cipherText must have a length of at least " << crypto_box_MACBYTES << " bytes";
+        return Nan::ThrowError(oss.str().c_str());
+    }
+    size_t message_size = cipherText_size - crypto_box_MACBYTES;
+    GET_OUTPUT_ARG(0, out, message_size);
+
+    if( crypto_box_open_easy(out_ptr, cipherText, cipherText_size, nonce, publicKey, secretKey) == 0) {
+        return info.GetReturnValue().Set(Nan::New<Number>((double) message_size));
+    } else {
+        sodium_memzero(out_ptr, message_size);
+        return;
+    }
+}
+
+/**
+ * Encrypts a message given the senders secret key and receivers public key, returning the MAC apart from the cipher text.
+ *
+ * int crypto_box_detached(
+ *    unsigned char *c,
+ *    unsigned char *mac,
+ *    const unsigned char *m,
+ *    unsigned long long mlen,
+ *    const unsigned char *n,
+ *    const unsigned char *pk,
+ *    const unsigned char *sk)
+ *
+ * Returns { cipherText, mac }: cipherText has the length of the message, mac is crypto_box_MACBYTES long
+ */
+NAN_METHOD(bind_crypto_box_detached) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(4,"arguments message, nonce, publicKey and secretKey must be buffers");
+
+    GET_ARG_MESSAGE(0, message);
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_box_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, publicKey, crypto_box_PUBLICKEYBYTES);
+    GET_ARG_AS_UCHAR_LEN(3, secretKey, crypto_box_SECRETKEYBYTES);
+
+    NEW_BUFFER_AND_PTR(c, message_size);
+    NEW_RESULT_BUFFER_AND_PTR(mac, crypto_box_MACBYTES);
+
+    if (crypto_box_detached(c_ptr, mac_ptr, message, message_size, nonce, publicKey, secretKey) == 0) {
+        return info.GetReturnValue().Set(detached_result(c, mac));
+    } else {
+        return;
+    }
+}
+
+/**
+ * Verifies and decrypts a cipher text produced by crypto_box_detached.
+ *
+ * int crypto_box_open_detached(
+ *    unsigned char *m,
+ *    const unsigned char *c,
+ *    const unsigned char *mac,
+ *    unsigned long long clen,
+ *    const unsigned char *n,
+ *    const unsigned char *pk,
+ *    const unsigned char *sk)
+ *
+ * Returns the message, or undefined if verification fails
+ */
+NAN_METHOD(bind_crypto_box_open_detached) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(5,"arguments cipherText, mac, nonce, publicKey and secretKey must be buffers");
+
+    GET_ARG_AS_UCHAR(0, cipherText);
+    GET_ARG_AS_UCHAR_LEN(1, mac, crypto_box_MACBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, nonce, crypto_box_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(3, publicKey, crypto_box_PUBLICKEYBYTES);
+    GET_ARG_AS_UCHAR_LEN(4, secretKey, crypto_box_SECRETKEYBYTES);
+
+    NEW_BUFFER_AND_PTR(m, cipherText_size);
+
+    if (crypto_box_open_detached(m_ptr, cipherText, mac, cipherText_size, nonce, publicKey, secretKey) == 0) {
+        return info.GetReturnValue().Set(m);
+    } else {
+        return;
+    }
+}
+
+/**
+ * Partially performs the computation required for both encryption and decryption of data.
+ *
+ * int crypto_box_beforenm(
+ *    unsigned char*        k,
+ *    const unsigned char*  pk,
+ *    const unsigned char*  sk)
+ *
+ * Parameters:
+ *    [out] k   the result of the computation.
+ *    [in]  pk  the receivers public key, used for encryption.
+ *    [in]  sk  the senders private key, used for signing.
+ *
+ * The intermediate data computed by crypto_box_beforenm is suitable for both
+ * crypto_box_afternm and crypto_box_open_afternm, and can be reused for any
+ * number of messages.
+ */
+NAN_METHOD(bind_crypto_box_beforenm) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(2,"arguments publicKey, and secretKey must be buffers");
+
+    GET_ARG_AS_UCHAR_LEN(0, publicKey, crypto_box_PUBLICKEYBYTES);
+    GET_ARG_AS_UCHAR_LEN(1, secretKey, crypto_box_SECRETKEYBYTES);
+
+    NEW_BUFFER_AND_PTR(k, crypto_box_BEFORENMBYTES);
+
+    crypto_box_beforenm(k_ptr, publicKey, secretKey);
+    return info.GetReturnValue().Set(k);
+}
+
+/**
+ * Encrypts a given a message m, using partial computed data.
+ *
+ * int crypto_box_afternm(
+ *    unsigned char * ctxt,
+ *       const unsigned char * msg,
+ *       unsigned long long mlen,
+ *       const unsigned char * nonce,
+ *       const unsigned char * k)
+ *
+ * Parameters:
+ *    [out] ctxt   the buffer for the cipher-text.
+ *    [in]  msg    the message to be encrypted.
+ *    [in]  mlen   the length of msg.
+ *    [in]  nonce  a randomly generated nonce.
+ *    [in]  k      the partial computed data.
+ *
+ * Returns:
+ *    0 if operation is successful.
+ */
+NAN_METHOD(bind_crypto_box_afternm) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3,"arguments message, nonce and k must be buffers");
+
+    GET_ARG_MESSAGE(0, message);
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_box_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, k, crypto_box_BEFORENMBYTES);
+
+    // crypto_box_BOXZEROBYTES zeros followed by the crypto_box_easy_afternm output, see bind_crypto_secretbox
+    NEW_BUFFER_AND_PTR(ctxt, message_size + crypto_box_ZEROBYTES);
+    memset(ctxt_ptr, 0, crypto_box_BOXZEROBYTES);
+
+    if( crypto_box_easy_afternm(ctxt_ptr + crypto_box_BOXZEROBYTES, message, message_size, nonce, k) == 0) {
+        return info.GetReturnValue().Set(ctxt);
+    } else {
+        return;
+    }
+}
+
+/**
+ * Decrypts a ciphertext ctxt given the receivers private key, and senders public key.
+ *
+ * int crypto_box_open_afternm ( unsigned char * msg,
+ *    const unsigned char * ctxt,
+ *    unsigned long long clen,
+ *    const unsigned char * nonce,
+ *    const unsigned char * k)
+ *
+ * Parameters:
+ *    [out] msg    the buffer to place resulting plaintext.
+ *    [in]  ctxt   the ciphertext to be decrypted.
+ *    [in]  clen   the length of the ciphertext.
+ *    [in]  nonce  a randomly generated nonce.
+ *    [in]  k      the partial computed data.
+ *
+ * Returns:
+ *    0 if successful and -1 if verification fails.
+ *
+ * Precondition:
+ *    first crypto_box_BOXZEROBYTES of ctxt be all 0.
+ *    the nonce must have size crypto_box_NONCEBYTES.
+ *
+ * Postcondition:
+ *    first clen bytes of msg will contain the plaintext.
+ *    first crypto_box_ZEROBYTES of msg will be all 0.
+ */
+NAN_METHOD(bind_crypto_box_open_afternm) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3,"arguments cipherText, nonce, k");
+
+    GET_ARG_AS_UCHAR(0, cipherText);
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_box_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, k, crypto_box_BEFORENMBYTES);
+
+    // API requires that the first crypto_box_BOXZEROBYTES of ctxt be 0, followed by the MAC, so lets check
+    if( cipherText_size < crypto_box_ZEROBYTES ) {
+        std::ostringstream oss;
+        oss << "argument cipherText must have a length of at least " << crypto_box_ZEROBYTES << " bytes";
+        return Nan::ThrowError(oss.str().c_str());
+    }
+
+    unsigned int i;
+    for(i=0; i < crypto_box_BOXZEROBYTES; i++) {
+        if( cipherText[i] ) break;
+    }
+    if( i < crypto_box_BOXZEROBYTES ) {
+        std::ostringstream oss;
+        oss << "the first " << crypto_box_BOXZEROBYTES << " bytes of argument cipherText must be 0";
+        return Nan::ThrowError(oss.str().c_str());
+    }
+
+    // Decrypt the crypto_box_open_easy_afternm formatted part straight into the unpadded result
+    NEW_BUFFER_AND_PTR(plain_text, cipherText_size - crypto_box_ZEROBYTES);
+
+    if( crypto_box_open_easy_afternm(plain_text_ptr, cipherText + crypto_box_BOXZEROBYTES,
+                                     cipherText_size - crypto_box_BOXZEROBYTES, nonce, k) == 0) {
+        return info.GetReturnValue().Set(plain_text);
+    } else {
+        return;
+    }
+}
+
+/**
+ * crypto_box_detached with a key precomputed by crypto_box_beforenm.
+ *
+ * int crypto_box_detached_afternm(
+ *    unsigned char *c,
+ *    unsigned char *mac,
+ *    const unsigned char *m,
+ *    unsigned long long mlen,
+ *    const unsigned char *n,
+ *    const unsigned char *k)
+ *
+ * Returns { cipherText, mac }
+ */
+NAN_METHOD(bind_crypto_box_detached_afternm) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3,"arguments message, nonce and k must be buffers");
+
+    GET_ARG_MESSAGE(0, message);
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_box_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, k, crypto_box_BEFORENMBYTES);
+
+    NEW_BUFFER_AND_PTR(c, message_size);
+    NEW_RESULT_BUFFER_AND_PTR(mac, crypto_box_MACBYTES);
+
+    if (crypto_box_detached_afternm(c_ptr, mac_ptr, message, message_size, nonce, k) == 0) {
+        return info.GetReturnValue().Set(detached_result(c, mac));
+    } else {
+        return;
+    }
+}
+
+/**
+ * crypto_box_open_detached with a key precomputed by crypto_box_beforenm.
+ *
+ * int crypto_box_open_detached_afternm(
+ *    unsigned char *m,
+ *    const unsigned char *c,
+ *    const unsigned char *mac,
+ *    unsigned long long clen,
+ *    const unsigned char *n,
+ *    const unsigned char *k)
+ *
+ * Returns the message, or undefined if verification fails
+ */
+NAN_METHOD(bind_crypto_box_open_detached_afternm) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(4,"arguments cipherText, mac, nonce and k must be buffers");
+
+    GET_ARG_AS_UCHAR(0, cipherText);
+    GET_ARG_AS_UCHAR_LEN(1, mac, crypto_box_MACBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, nonce, crypto_box_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(3, k, crypto_box_BEFORENMBYTES);
+
+    NEW_BUFFER_AND_PTR(m, cipherText_size);
+
+    if (crypto_box_open_detached_afternm(m_ptr, cipherText, mac, cipherText_size, nonce, k) == 0) {
+        return info.GetReturnValue().Set(m);
+    } else {
+        return;
+    }
+}
+
+/*
+* Batch crypto_box with a precomputed key.
+* Every message is sealed in the "easy" format: MAC followed by the encrypted message,
+* ie. the output of crypto_box_afternm without its crypto_box_BOXZEROBYTES leading zeros.
+*/
+#define BOX_BATCH_GRAIN 32
+
+struct BoxBatch {
+    BatchItems inputs;
+    // Either one nonce per item, or a starting nonce incremented for each item
+    BatchItems nonces;
+    unsigned char startNonce[crypto_box_NONCEBYTES];
+    bool incrementNonce;
+    const unsigned char* k;
+    bool open;
+    std::vector<uint32_t> offsets;
+    unsigned char* output;
+    unsigned char* results;
+};
+
+// Adds value to a little endian number, like sodium_increment does for 1
+static void nonce_add(unsigned char* nonce, size_t nonceSize, uint64_t value) {
+    uint64_t carry = value;
+    for (size_t i = 0; i < nonceSize && carry != 0; i++) {
+        carry += nonce[i];
+        nonce[i] = (unsigned char) (carry & 0xff);
+        carry >>= 8;
+    }
+}
+
+static void box_batch_range(size_t begin, size_t end, void* data) {
+    BoxBatch* batch = static_cast<BoxBatch*>(data);
+    unsigned char nonce[crypto_box_NONCEBYTES];
+    for (size_t i = begin; i < end; i++) {
+        const unsigned char* itemNonce;
+        if (batch->incrementNonce) {
+            memcpy(nonce, batch->startNonce, crypto_box_NONCEBYTES);
+            nonce_add(nonce, crypto_box_NONCEBYTES, i);
+            itemNonce = nonce;
+        } else {
+            itemNonce = batch->nonces.ptrs[i];
+        }
+
+        unsigned char* out = batch->output + batch->offsets[i];
+        if (batch->open) {
+            int rc = crypto_box_open_easy_afternm(out, batch->inputs.ptrs[i], batch->inputs.sizes[i], itemNonce, batch->k);
+            batch->results[i] = rc == 0 ? 1 : 0;
+            if (rc != 0) {
+                // Don't hand out unauthenticated data
+                sodium_memzero(out, batch->offsets[i + 1] - batch->offsets[i]);
+            }
+        } else {
+            crypto_box_easy_afternm(out, batch->inputs.ptrs[i], batch->inputs.sizes[i], itemNonce, batch->k);
+        }
+    }
+}
+
+/*
+* Parses (items, nonces, k) or (itemBuffer, offsets, nonces, k), and computes the output offsets.
+* Throws and returns false on error
+*/
+static bool get_box_batch_args(NAN_METHOD_ARGS_TYPE info, BoxBatch* batch) {
+    const char* name = batch->open ? "cipherTexts" : "messages";
+    int noncesIndex = 1;
+    size_t count;
+
+    if (info.Length() > 0 && !info[0]->IsArray() && is_bytes(info[0])) {
+        if (info.Length() < 4) {
+            Nan::ThrowError("arguments buffer, offsets, nonces and k are mandatory when items are packed in one buffer");
+            return false;
+        }
+        if (!info[1]->IsObject()) {
+            Nan::ThrowTypeError("argument offsets must be an array or a typed array");
+            return false;
+        }
+        Local<Value> offsetsLength = Nan::Get(info[1]->ToObject(), Nan::New<String>("length").ToLocalChecked()).ToLocalChecked();
+        if (!offsetsLength->IsNumber() || offsetsLength->NumberValue() < 1) {
+            Nan::ThrowError("argument offsets must have at least one item");
+            return false;
+        }
+        count = (size_t) offsetsLength->NumberValue() - 1;
+        if (!get_batch_packed_items(info[0], info[1], name, count, &batch->inputs)) return false;
+        noncesIndex = 2;
+    } else {
+        if (info.Length() < 3) {
+            Nan::ThrowError("arguments items, nonces and k are mandatory");
+            return false;
+        }
+        long long itemCount = batch_count(info[0], name, 0);
+        if (itemCount < 0) return false;
+        count = (size_t) itemCount;
+        if (!get_batch_items(info[0], name, count, 0, false, &batch->inputs)) return false;
+    }
+
+    // A single nonce is the starting nonce of the batch
+    Local<Value> noncesArg = info[noncesIndex];
+    unsigned char* startNonce;
+    size_t startNonceSize;
+    batch->incrementNonce = get_bytes(noncesArg, &startNonce, &startNonceSize) && startNonceSize == crypto_box_NONCEBYTES;
+    if (batch->incrementNonce) {
+        memcpy(batch->startNonce, startNonce, crypto_box_NONCEBYTES);
+    } else if (!get_batch_items(noncesArg, "nonces", count, crypto_box_NONCEBYTES, false, &batch->nonces)) {
+        return false;
+    }
+
+    Local<Value> kArg = info[noncesIndex + 1];
+    unsigned char* k;
+    size_t kSize;
+    if (!get_bytes(kArg, &k, &kSize) || kSize != crypto_box_BEFORENMBYTES) {
+        std::ostringstream oss;
+        oss << "argument k must be a " << crypto_box_BEFORENMBYTES << " bytes buffer";
+        Nan::ThrowTypeError(oss.str().c_str());
+        return false;
+    }
+    batch->k = k;
+
+    batch->offsets.resize(count + 1);
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        batch->offsets[i] = (uint32_t) total;
+        if (batch->open) {
+            if (batch->inputs.sizes[i] < crypto_box_MACBYTES) {
+                std::ostringstream oss;
+                oss << "item " << i << " of argument cipherTexts must be at least " << crypto_box_MACBYTES << " bytes long";
+                Nan::ThrowError(oss.str().c_str());
+                return false;
+            }
+            total += batch->inputs.sizes[i] - crypto_box_MACBYTES;
+        } else {
+            total += batch->inputs.sizes[i] + crypto_box_MACBYTES;
+        }
+        if (total > 0xFFFFFFFF) {
+            Nan::ThrowRangeError("the batch output can't exceed 4 GiB");
+            return false;
+        }
+    }
+    batch->offsets[count] = (uint32_t) total;
+    return true;
+}
+
+// { <outputName>: Buffer, offsets: Uint32Array [, results: Buffer] }
+static Local<Object> box_batch_result(BoxBatch* batch, Local<Object> output, Local<Object> results) {
+    size_t count = batch->offsets.size();
+    Local<ArrayBuffer> offsetsStorage = ArrayBuffer::New(v8::Isolate::GetCurrent(), count * sizeof(uint32_t));
+    Local<Uint32Array> offsets = Uint32Array::New(offsetsStorage, 0, count);
+    Nan::TypedArrayContents<uint32_t> offsetsContents(offsets);
+    memcpy(*offsetsContents, &batch->offsets[0], count * sizeof(uint32_t));
+
+    Local<Object> result = Nan::New<Object>();
+    Nan::Set(result, Nan::New<String>(batch->open ? "plainText" : "cipherText").ToLocalChecked(), output);
+    Nan::Set(result, Nan::New<String>("offsets").ToLocalChecked(), offsets);
+    if (batch->open) {
+        Nan::Set(result, Nan::New<String>("results").ToLocalChecked(), results);
+    }
+    return result;
+}
+
+/**
+ * Seals many messages with the same precomputed key (see crypto_box_beforenm).
+ *
+ * Array messages, Buffer|Array nonces, Buffer k
+ * Buffer messages, Array|TypedArray offsets, Buffer|Array nonces, Buffer k
+ *
+ * nonces: one nonce per message (array, or one buffer of N * crypto_box_NONCEBYTES),
+ *   or a single starting nonce, incremented (little endian) for each message
+ *
+ * Returns { cipherText, offsets }: all the cipher texts back to back in one buffer, and N + 1 offsets
+ * delimiting them. Cipher text i is the output of crypto_box_afternm without its crypto_box_BOXZEROBYTES leading zeros
+ */
+NAN_METHOD(bind_crypto_box_afternm_batch) {
+    Nan::EscapableHandleScope scope;
+
+    BoxBatch batch;
+    batch.open = false;
+    if (!get_box_batch_args(info, &batch)) {
+        return;
+    }
+
+    NEW_BUFFER_AND_PTR(cipherText, batch.offsets.back());
+    batch.output = cipherText_ptr;
+    batch.results = 0;
+    WorkerPool::ParallelFor(batch.inputs.ptrs.size(), BOX_BATCH_GRAIN, box_batch_range, &batch);
+
+    return info.GetReturnValue().Set(box_batch_result(&batch, cipherText, Local<Object>()));
+}
+
+/**
+ * Opens many cipher texts produced by crypto_box_afternm_batch (or crypto_box_easy_afternm) with the same precomputed key.
+ *
+ * Array cipherTexts, Buffer|Array nonces, Buffer k
+ * Buffer cipherTexts, Array|TypedArray offsets, Buffer|Array nonces, Buffer k
+ *
+ * Returns { plainText, offsets, results }: all the messages back to back in one buffer, N + 1 offsets delimiting them,
+ * and a buffer of N bytes, 1 where the cipher text has been verified, 0 otherwise (that message is then zeroed)
+ */
+NAN_METHOD(bind_crypto_box_open_afternm_batch) {
+    Nan::EscapableHandleScope scope;
+
+    BoxBatch batch;
+    batch.open = true;
+    if (!get_box_batch_args(info, &batch)) {
+        return;
+    }
+
+    size_t count = batch.inputs.ptrs.size();
+    NEW_BUFFER_AND_PTR(plainText, batch.offsets.back());
+    NEW_BUFFER_AND_PTR(results, count);
+    batch.output = plainText_ptr;
+    batch.results = results_ptr;
+    WorkerPool::ParallelFor(count, BOX_BATCH_GRAIN, box_batch_range, &batch);
+
+    return info.GetReturnValue().Set(box_batch_result(&batch, plainText, results));
+}
+
+/*
+* Scatter/gather crypto_secretbox_easy: the message (or cipher text) is an array of fragments,
+* processed in place of their concatenation without building it.
+* Same construction as crypto_secretbox_easy (XSalsa20-Poly1305): the key stream is Salsa20 keyed by
+* HSalsa20(key, nonce[0..16]) with nonce[16..24], its first 32 bytes are the Poly1305 key, the message
+* is xored with the rest of it, and the Poly1305 MAC of the cipher text is put in front of it.
+*/
+#define SECRETBOX_IOV_POLYKEYBYTES 32
+#define SALSA20_BLOCKBYTES 64
+
+static const unsigned char secretbox_iov_sigma[16] = {
+    'e', 'x', 'p', 'a', 'n', 'd', ' ', '3', '2', '-', 'b', 'y', 't', 'e', ' ', 'k'
+};
+
+struct SecretboxIov {
+    unsigned char subkey[crypto_stream_salsa20_KEYBYTES];
+    const unsigned char* salsaNonce;
+    // Position in the key stream
+    uint64_t position;
+    crypto_onetimeauth_poly1305_state poly;
+};
+
+static void secretbox_iov_init(SecretboxIov* iov, const unsigned char* nonce, const unsigned char* key) {
+    unsigned char polyKey[SECRETBOX_IOV_POLYKEYBYTES];
+
+    crypto_core_hsalsa20(iov->subkey, nonce, key, secretbox_iov_sigma);
+    iov->salsaNonce = nonce + 16;
+    crypto_stream_salsa20(polyKey, SECRETBOX_IOV_POLYKEYBYTES, iov->salsaNonce, iov->subkey);
+    crypto_onetimeauth_poly1305_init(&iov->poly, polyKey);
+    iov->position = SECRETBOX_IOV_POLYKEYBYTES;
+    sodium_memzero(polyKey, sizeof polyKey);
+}
+
+static void secretbox_iov_clear(SecretboxIov* iov) {
+    sodium_memzero(iov, sizeof *iov);
+}
+
+// Xors size bytes with the key stream. Fragments rarely end on a block boundary:
+// the rest of a started block is taken from that block, recomputed
+static void secretbox_iov_xor(SecretboxIov* iov, unsigned char* out, const unsigned char* in, size_t size) {
+    size_t offset = (size_t) (iov->position % SALSA20_BLOCKBYTES);
+    if (offset != 0 && size > 0) {
+        unsigned char block[SALSA20_BLOCKBYTES];
+        memset(block, 0, sizeof block);
+        crypto_stream_salsa20_xor_ic(block, block, sizeof block, iov->salsaNonce, iov->position / SALSA20_BLOCKBYTES, iov->subkey);
+        size_t partial = SALSA20_BLOCKBYTES - offset < size ? SALSA20_BLOCKBYTES - offset : size;
+        for (size_t i = 0; i < partial; i++) {
+            out[i] = in[i] ^ block[offset + i];
+        }
+        sodium_memzero(block, sizeof block);
+        out += partial;
+        in += partial;
+        size -= partial;
+        iov->position += partial;
+    }
+    if (size > 0) {
+        crypto_stream_salsa20_xor_ic(out, in, size, iov->salsaNonce, iov->position / SALSA20_BLOCKBYTES, iov->subkey);
+        iov->position += size;
+    }
+}
+
+/**
+ * Encrypts the concatenation of fragments, without concatenating them.
+ *
+ * Array fragments, Buffer nonce, Buffer key
+ *
+ * Returns the same buffer crypto_secretbox_easy would return for Buffer.concat(fragments)
+ */
+NAN_METHOD(bind_crypto_secretbox_easy_iov) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3,"arguments fragments, nonce, and key are mandatory");
+
+    BatchItems fragments;
+    long long count = batch_count(info[0], "fragments", 0);
+    if (count < 0 || !get_batch_items(info[0], "fragments", (size_t) count, 0, false, &fragments)) {
+        return;
+    }
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_secretbox_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, key, crypto_secretbox_KEYBYTES);
+
+    size_t message_size = 0;
+    for (size_t i = 0; i < fragments.sizes.size(); i++) {
+        message_size += fragments.sizes[i];
+    }
+
+    NEW_BUFFER_AND_PTR(c, message_size + crypto_secretbox_MACBYTES);
+
+    SecretboxIov iov;
+    secretbox_iov_init(&iov, nonce, key);
+    unsigned char* out = c_ptr + crypto_secretbox_MACBYTES;
+    for (size_t i = 0; i < fragments.sizes.size(); i++) {
+        secretbox_iov_xor(&iov, out, fragments.ptrs[i], fragments.sizes[i]);
+        crypto_onetimeauth_poly1305_update(&iov.poly, out, fragments.sizes[i]);
+        out += fragments.sizes[i];
+    }
+    crypto_onetimeauth_poly1305_final(&iov.poly, c_ptr);
+    secretbox_iov_clear(&iov);
+
+    return info.GetReturnValue().Set(c);
+}
+
+/**
+ * Verifies and decrypts the concatenation of fragments, a crypto_secretbox_easy cipher text
+ * (MAC followed by the encrypted message) split anywhere, without concatenating them.
+ *
+ * Array fragments, Buffer nonce, Buffer key
+ *
+ * Returns the message, or undefined if verification fails
+ */
+NAN_METHOD(bind_crypto_secretbox_open_easy_iov) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(3,"arguments fragments, nonce, and key are mandatory");
+
+    BatchItems fragments;
+    long long count = batch_count(info[0], "fragments", 0);
+    if (count < 0 || !get_batch_items(info[0], "fragments", (size_t) count, 0, false, &fragments)) {
+        return;
+    }
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_secretbox_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, key, crypto_secretbox_KEYBYTES);
+
+    size_t cipher_text_size = 0;
+    for (size_t i = 0; i < fragments.sizes.size(); i++) {
+        cipher_text_size += fragments.sizes[i];
+    }
+    if (cipher_text_size < crypto_secretbox_MACBYTES) {
+        std::ostringstream oss;
+        oss << "the cipher text must have a length of at least " << crypto_secretbox_MACBYTES << " bytes";
+        return Nan::ThrowError(oss.str().c_str());
+    }
+
+    // Collect the MAC, and skip it in the fragments
+    unsigned char mac[crypto_secretbox_MACBYTES];
+    size_t macSize = 0;
+    for (size_t i = 0; i < fragments.sizes.size() && macSize < crypto_secretbox_MACBYTES; i++) {
+        size_t part = crypto_secretbox_MACBYTES - macSize < fragments.sizes[i] ? crypto_secretbox_MACBYTES - macSize : fragments.sizes[i];
+        memcpy(mac + macSize, fragments.ptrs[i], part);
+        macSize += part;
+        fragments.ptrs[i] += part;
+        fragments.sizes[i] -= part;
+    }
+
+    // Verify everything before decrypting anything
+    SecretboxIov iov;
+    secretbox_iov_init(&iov, nonce, key);
+    for (size_t i = 0; i < fragments.sizes.size(); i++) {
+        crypto_onetimeauth_poly1305_update(&iov.poly, fragments.ptrs[i], fragments.sizes[i]);
+    }
+    unsigned char computedMac[crypto_secretbox_MACBYTES];
+    crypto_onetimeauth_poly1305_final(&iov.poly, computedMac);
+    if (crypto_verify_16(computedMac, mac) != 0) {
+        secretbox_iov_clear(&iov);
+        return;
+    }
+
+    NEW_BUFFER_AND_PTR(m, cipher_text_size - crypto_secretbox_MACBYTES);
+    unsigned char* out = m_ptr;
+    for (size_t i = 0; i < fragments.sizes.size(); i++) {
+        secretbox_iov_xor(&iov, out, fragments.ptrs[i], fragments.sizes[i]);
+        out += fragments.sizes[i];
+    }
+    secretbox_iov_clear(&iov);
+
+    return info.GetReturnValue().Set(m);
+}
+
+/**
+ * Runs crypto_secretbox_easy, crypto_box_easy, crypto_box_afternm, crypto_stream_xor or crypto_hash
+ * on the worker pool. The result is the same buffer the synchronous binding would return.
+ *
+ * The message buffer is referenced, not copied: it must not be modified until
+ * the callback has been called. Nonce and keys are copied.
+ */
+class CryptoWorker : public Nan::AsyncWorker {
+public:
+    enum Operation { SECRETBOX_EASY, BOX_EASY, BOX_AFTERNM, STREAM_XOR, HASH };
+
+    CryptoWorker(Nan::Callback* callback, Operation operation,
+                 Local<Object> messageBuffer, const unsigned char* message, size_t messageSize,
+                 const unsigned char* nonce = 0, size_t nonceSize = 0,
+                 const unsigned char* key = 0, size_t keySize = 0,
+                 const unsigned char* secondKey = 0, size_t secondKeySize = 0)
+        : Nan::AsyncWorker(callback), operation(operation), message(message), messageSize(messageSize), nonceSize(nonceSize), keySize(keySize),
+          secondKeySize(secondKeySize), result(0), resultSize(0) {
+        SaveToPersistent("message", messageBuffer);
+
+        if (nonce != 0) {
+            memcpy(this->nonce, nonce, nonceSize);
+        }
+        if (key != 0) {
+            memcpy(this->key, key, keySize);
+        }
+        if (secondKey != 0) {
+            memcpy(this->secondKey, secondKey, secondKeySize);
+        }
+    }
+
+    ~CryptoWorker() {
+        sodium_memzero(key, sizeof(key));
+        sodium_memzero(secondKey, sizeof(secondKey));
+        if (result != 0) {
+            free(result);
+        }
+    }
+
+    void Execute() {
+        int rc = -1;
+        switch (operation) {
+            case SECRETBOX_EASY:
+                resultSize = messageSize + crypto_secretbox_MACBYTES;
+                if ((result = (unsigned char*) malloc(resultSize)) == 0) break;
+                rc = crypto_secretbox_easy(result, message, messageSize, nonce, key);
+                break;
+
+            case BOX_EASY:
+                resultSize = messageSize + crypto_box_MACBYTES;
+                if ((result = (unsigned char*) malloc(resultSize)) == 0) break;
+                rc = crypto_box_easy(result, message, messageSize, nonce, key, secondKey);
+                break;
+
+            case BOX_AFTERNM:
+                // Same output as bind_crypto_box_afternm
+                resultSize = messageSize + crypto_box_ZEROBYTES;
+                if ((result = (unsigned char*) malloc(resultSize)) == 0) break;
+                memset(result, 0, crypto_box_BOXZEROBYTES);
+                rc = crypto_box_easy_afternm(result + crypto_box_BOXZEROBYTES, message, messageSize, nonce, key);
+                break;
+
+            case STREAM_XOR:
+                resultSize = messageSize;
+                // malloc(0) may return NULL
+                if ((result = (unsigned char*) malloc(resultSize > 0 ? resultSize : 1)) == 0) break;
+                rc = crypto_stream_xor(result, message, messageSize, nonce, key);
+                break;
+
+            case HASH:
+                resultSize = crypto_hash_BYTES;
+                if ((result = (unsigned char*) malloc(resultSize)) == 0) break;
+                rc = crypto_hash(result, message, messageSize);
+                break;
+        }
+
+        if (result == 0) {
+            SetErrorMessage("out of memory");
+        } else if (rc != 0) {
+            SetErrorMessage("encryption failed");
+        }
+    }
+
+    void HandleOKCallback() {
+        Nan::HandleScope scope;
+
+        // The new buffer takes ownership of result
+        Local<Value> argv[] = { Nan::Null(), Nan::NewBuffer((char*) result, resultSize).ToLocalChecked() };
+        result = 0;
+        callback->Call(2, argv);
+    }
+
+private:
+    Operation operation;
+    const unsigned char* message;
+    size_t messageSize;
+    unsigned char nonce[crypto_box_NONCEBYTES];
+    size_t nonceSize;
+    unsigned char key[crypto_box_SECRETKEYBYTES];
+    size_t keySize;
+    unsigned char secondKey[crypto_box_SECRETKEYBYTES];
+    size_t secondKeySize;
+    unsigned char* result;
+    size_t resultSize;
+};
+
+/**
+ * Asynchronous version of crypto_secretbox_easy.
+ * Buffer message, Buffer nonce, Buffer key, Function callback(err, cipherText)
+ */
+NAN_METHOD(bind_crypto_secretbox_easy_async) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(4,"arguments message, nonce, and key must be buffers; callback must be a function");
+
+    GET_ARG_AS_UCHAR(0, message);
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_secretbox_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, key, crypto_secretbox_KEYBYTES);
+    GET_CALLBACK_LAST(callback);
+
+    WorkerPool::QueueWorker(new CryptoWorker(callback, CryptoWorker::SECRETBOX_EASY, info[0]->ToObject(), message, message_size,
+        nonce, nonce_size, key, key_size));
+    return info.GetReturnValue().Set(Nan::Undefined());
+}
+
+/**
+ * Asynchronous version of crypto_box_easy.
+ * Buffer message, Buffer nonce, Buffer publicKey, Buffer secretKey, Function callback(err, cipherText)
+ */
+NAN_METHOD(bind_crypto_box_easy_async) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(5,"arguments message, nonce, publicKey and secretKey must be buffers; callback must be a function");
+
+    GET_ARG_AS_UCHAR(0, message);
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_box_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, publicKey, crypto_box_PUBLICKEYBYTES);
+    GET_ARG_AS_UCHAR_LEN(3, secretKey, crypto_box_SECRETKEYBYTES);
+    GET_CALLBACK_LAST(callback);
+
+    WorkerPool::QueueWorker(new CryptoWorker(callback, CryptoWorker::BOX_EASY, info[0]->ToObject(), message, message_size,
+        nonce, nonce_size, publicKey, publicKey_size, secretKey, secretKey_size));
+    return info.GetReturnValue().Set(Nan::Undefined());
+}
+
+/**
+ * Asynchronous version of crypto_box_afternm.
+ * Buffer message, Buffer nonce, Buffer k, Function callback(err, cipherText)
+ */
+NAN_METHOD(bind_crypto_box_afternm_async) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(4,"arguments message, nonce and k must be buffers; callback must be a function");
+
+    GET_ARG_AS_UCHAR(0, message);
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_box_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, k, crypto_box_BEFORENMBYTES);
+    GET_CALLBACK_LAST(callback);
+
+    WorkerPool::QueueWorker(new CryptoWorker(callback, CryptoWorker::BOX_AFTERNM, info[0]->ToObject(), message, message_size,
+        nonce, nonce_size, k, k_size));
+    return info.GetReturnValue().Set(Nan::Undefined());
+}
+
+/**
+ * Asynchronous version of crypto_stream_xor.
+ * Buffer message, Buffer nonce, Buffer key, Function callback(err, cipherText)
+ */
+NAN_METHOD(bind_crypto_stream_xor_async) {
+    Nan::EscapableHandleScope scope;
+
+    NUMBER_OF_MANDATORY_ARGS(4,"arguments message, nonce, and key must be buffers; callback must be a function");
+
+    GET_ARG_AS_UCHAR(0, message);
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_stream_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, key, crypto_stream_KEYBYTES);
+    GET_CALLBACK_LAST(callback);
+
+    WorkerPool::QueueWorker(new CryptoWorker(callback, CryptoWorker::STREAM_XOR, info[0]->ToObject(), message, message_size,
+        nonce, nonce_size, key, key_size));
+    return info.GetReturnValue().Set(Nan::Undefined());
+}
+
+/**
+ * Asynchronous version of crypto_hash.
+ * Buffer message, Function callback(err, hash)
  */
-NAN_METHOD(bind_crypto_box_open) {
+NAN_METHOD(bind_crypto_hash_async) {
     Nan::EscapableHandleScope scope;
 
-    NUMBER_OF_MANDATORY_ARGS(4,"arguments cipherText, nonce, publicKey and secretKey must be buffers");
+    NUMBER_OF_MANDATORY_ARGS(2,"argument message must be a buffer; callback must be a function");
 
-    GET_ARG_AS_UCHAR(0, cipherText);
-    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_box_NONCEBYTES);
-    GET_ARG_AS_UCHAR_LEN(2, publicKey, crypto_box_PUBLICKEYBYTES);
-    GET_ARG_AS_UCHAR_LEN(3, secretKey, crypto_box_SECRETKEYBYTES);
+    GET_ARG_AS_UCHAR(0, message);
+    GET_CALLBACK_LAST(callback);
 
-    // API requires that the first crypto_box_BOXZEROBYTES of msg be 0 so lets check
-    if( cipherText_size < crypto_box_BOXZEROBYTES ) {
-        std::ostringstream oss;
-        oss << "argument cipherText must have a length of at least " << crypto_box_BOXZEROBYTES << " bytes";
-        return Nan::ThrowError(oss.str().c_str());
+    WorkerPool::QueueWorker(new CryptoWorker(callback, CryptoWorker::HASH, info[0]->ToObject(), message, message_size));
+    return info.GetReturnValue().Set(Nan::Undefined());
+}
+
+/*
+* Sync/async dispatch.
+* Each primitive is modelled as cost(size) = fixedMicros + size / bytesPerMicro, measured on this machine.
+* Messages whose estimated cost fits in the latency budget are processed inline;
+* bigger ones are sent to the worker pool.
+*/
+#define DISPATCH_DEFAULT_BUDGET_MICROS 1000
+#define DISPATCH_SMALL_SIZE 256
+#define DISPATCH_LARGE_SIZE 65536
+#define DISPATCH_ROUNDS 5
+
+enum DispatchPrimitive { DISPATCH_SECRETBOX_EASY = 0, DISPATCH_BOX_EASY, DISPATCH_HASH, DISPATCH_COUNT };
+
+struct DispatchProfile {
+    const char* name;
+    double fixedMicros;
+    double bytesPerMicro;
+    size_t threshold;
+    bool overridden;
+};
+
+static DispatchProfile dispatchProfiles[DISPATCH_COUNT] = {
+    { "crypto_secretbox_easy", 0, 0, 0, false },
+    { "crypto_box_easy", 0, 0, 0, false },
+    { "crypto_hash", 0, 0, 0, false }
+};
+static double dispatchBudgetMicros = DISPATCH_DEFAULT_BUDGET_MICROS;
+static bool dispatchCalibrated = false;
+
+// The profiles are shared by all the worker_threads the module is loaded in
+static uv_once_t dispatchOnce = UV_ONCE_INIT;
+static uv_mutex_t dispatchMutex;
+
+static void dispatch_init_mutex() {
+    uv_mutex_init(&dispatchMutex);
+}
+
+static void dispatch_lock() {
+    uv_once(&dispatchOnce, dispatch_init_mutex);
+    uv_mutex_lock(&dispatchMutex);
+}
+
+static void dispatch_unlock() {
+    uv_mutex_unlock(&dispatchMutex);
+}
+
+// Best of DISPATCH_ROUNDS runs, in microseconds
+static double dispatch_time(DispatchPrimitive primitive, const unsigned char* in, unsigned char* out, size_t size,
+                            const unsigned char* nonce, const unsigned char* pk, const unsigned char* sk) {
+    double best = -1;
+    for (int i = 0; i < DISPATCH_ROUNDS; i++) {
+        uint64_t start = uv_hrtime();
+        switch (primitive) {
+            case DISPATCH_SECRETBOX_EASY:
+                crypto_secretbox_easy(out, in, size, nonce, sk);
+                break;
+            case DISPATCH_BOX_EASY:
+                crypto_box_easy(out, in, size, nonce, pk, sk);
+                break;
+            default:
+                crypto_hash(out, in, size);
+                break;
+        }
+        double elapsed = (double) (uv_hrtime() - start) / 1000.0;
+        if (best < 0 || elapsed < best) best = elapsed;
     }
+    return best;
+}
 
-    unsigned int i;
-    for(i=0; i < crypto_box_BOXZEROBYTES; i++) {
-        if( cipherText[i] ) break;
+// Must be called with the dispatch lock held
+static void dispatch_update_threshold(DispatchProfile* profile) {
+    if (profile->overridden) return;
+    double remaining = dispatchBudgetMicros - profile->fixedMicros;
+    if (remaining <= 0) {
+        profile->threshold = 0;
+    } else if (remaining * profile->bytesPerMicro >= (double) 0xFFFFFFFF) {
+        profile->threshold = 0xFFFFFFFF;
+    } else {
+        profile->threshold = (size_t) (remaining * profile->bytesPerMicro);
     }
-    if( i < crypto_box_BOXZEROBYTES ) {
-        std::ostringstream oss;
-        oss << "the first " << crypto_box_BOXZEROBYTES << " bytes of argument cipherText must be 0";
-        return Nan::ThrowError(oss.str().c_str());
+}
+
+static void dispatch_calibrate() {
+    unsigned char* in = (unsigned char*) malloc(DISPATCH_LARGE_SIZE);
+    unsigned char* out = (unsigned char*) malloc(DISPATCH_LARGE_SIZE + crypto_hash_BYTES + crypto_box_MACBYTES);
+    if (in == 0 || out == 0) {
+        free(in);
+        free(out);
+        throw new std::runtime_error("out of memory");
+    }
+    unsigned char nonce[crypto_box_NONCEBYTES];
+    unsigned char pk[crypto_box_PUBLICKEYBYTES];
+    unsigned char sk[crypto_box_SECRETKEYBYTES];
+    randombytes_buf(in, DISPATCH_LARGE_SIZE);
+    randombytes_buf(nonce, sizeof(nonce));
+    crypto_box_keypair(pk, sk);
+
+    // Measured without holding the lock
+    double fixedMicros[DISPATCH_COUNT];
+    double bytesPerMicro[DISPATCH_COUNT];
+    for (int i = 0; i < DISPATCH_COUNT; i++) {
+        DispatchPrimitive primitive = (DispatchPrimitive) i;
+        double small = dispatch_time(primitive, in, out, DISPATCH_SMALL_SIZE, nonce, pk, sk);
+        double large = dispatch_time(primitive, in, out, DISPATCH_LARGE_SIZE, nonce, pk, sk);
+        // Guard against timer resolution
+        double microsPerByte = (large - small) / (DISPATCH_LARGE_SIZE - DISPATCH_SMALL_SIZE);
+        if (microsPerByte <= 0) microsPerByte = 1e-6;
+        double fixed = small - microsPerByte * DISPATCH_SMALL_SIZE;
+
+        fixedMicros[i] = fixed > 0 ? fixed : 0;
+        bytesPerMicro[i] = 1.0 / microsPerByte;
+    }
+
+    sodium_memzero(sk, sizeof(sk));
+    free(in);
+    free(out);
+
+    dispatch_lock();
+    for (int i = 0; i < DISPATCH_COUNT; i++) {
+        dispatchProfiles[i].fixedMicros = fixedMicros[i];
+        dispatchProfiles[i].bytesPerMicro = bytesPerMicro[i];
+        dispatch_update_threshold(&dispatchProfiles[i]);
     }
+    dispatchCalibrated = true;
+    dispatch_unlock();
+}
 
-    NEW_BUFFER_AND_PTR(msg, cipherText_size);
+static size_t dispatch_threshold(DispatchPrimitive primitive) {
+    dispatch_lock();
+    bool calibrated = dispatchCalibrated;
+    dispatch_unlock();
+    if (!calibrated) dispatch_calibrate();
 
-    if (crypto_box_open(msg_ptr, cipherText, cipherText_size, nonce, publicKey, secretKey) == 0) {
+    dispatch_lock();
+    size_t threshold = dispatchProfiles[primitive].threshold;
+    dispatch_unlock();
+    return threshold;
+}
 
-        // Remove the padding at the beginning of the message
-        NEW_BUFFER_AND_PTR(plain_text, cipherText_size - crypto_box_ZEROBYTES);
-        memcpy(plain_text_ptr,(void*) (msg_ptr + crypto_box_ZEROBYTES), cipherText_size - crypto_box_ZEROBYTES);
-        return info.GetReturnValue().Set(plain_text);
-    } else {
-        return;
+static Local<Object> dispatch_thresholds_object() {
+    DispatchProfile profiles[DISPATCH_COUNT];
+    dispatch_lock();
+    double budgetMicros = dispatchBudgetMicros;
+    memcpy(profiles, dispatchProfiles, sizeof(profiles));
+    dispatch_unlock();
+
+    Local<Object> result = Nan::New<Object>();
+    Nan::Set(result, Nan::New<String>("budget").ToLocalChecked(), Nan::New<Number>(budgetMicros));
+    for (int i = 0; i < DISPATCH_COUNT; i++) {
+        Local<Object> profile = Nan::New<Object>();
+        Nan::Set(profile, Nan::New<String>("threshold").ToLocalChecked(), Nan::New<Number>((double) profiles[i].threshold));
+        Nan::Set(profile, Nan::New<String>("fixedMicros").ToLocalChecked(), Nan::New<Number>(profiles[i].fixedMicros));
+        Nan::Set(profile, Nan::New<String>("bytesPerMicro").ToLocalChecked(), Nan::New<Number>(profiles[i].bytesPerMicro));
+        Nan::Set(profile, Nan::New<String>("overridden").ToLocalChecked(), Nan::New<Boolean>(profiles[i].overridden));
+        Nan::Set(result, Nan::New<String>(profiles[i].name).ToLocalChecked(), profile);
     }
+    return result;
 }
 
 /**
- * Decrypts a ciphertext ctxt given the receivers private key, and senders public key.
- *
- * int crypto_box_open_easy(
- *    unsigned char *       msg,
- *    const unsigned char * ctxt,
- *    unsigned long long    clen,
- *    const unsigned char * nonce,
- *    const unsigned char * pk,
- *    const unsigned char * sk)
- *
- * Parameters:
- *     [out] msg     the buffer to place resulting plaintext.
- *     [in]  ctxt    the ciphertext to be decrypted.
- *     [in]  clen    the length of the ciphertext.
- *     [in]  nonce   a randomly generated.
- *     [in]  pk      the senders public key, used for verification.
- *     [in]  sk      the receivers private key, used for decryption.
- *
- Returns:
- *     0 if successful and -1 if verification fails.
- *
- Precondition:
- *     the nonce must have size crypto_box_NONCEBYTES.
- *
- * Postcondition:
- *     first clen bytes of msg will contain the plaintext.
+ * Measures the throughput of the dispatched primitives, and recomputes their thresholds
+ * Number budgetMicros (optional) : per-call latency budget, in microseconds. Defaults to the current one (1000 at first)
+ * Returns the same object as sodium_dispatch_thresholds
  */
-NAN_METHOD(bind_crypto_box_open_easy) {
+NAN_METHOD(bind_sodium_dispatch_calibrate) {
     Nan::EscapableHandleScope scope;
 
-    NUMBER_OF_MANDATORY_ARGS(4,"arguments cipherText, nonce, publicKey and secretKey must be buffers");
-
-    GET_ARG_AS_UCHAR(0, cipherText);
-    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_box_NONCEBYTES);
-    GET_ARG_AS_UCHAR_LEN(2, publicKey, crypto_box_PUBLICKEYBYTES);
-    GET_ARG_AS_UCHAR_LEN(3, secretKey, crypto_box_SECRETKEYBYTES);
+    if (info.Length() > 0 && !info[0]->IsUndefined()) {
+        if (!info[0]->IsNumber()) {
+            return Nan::ThrowTypeError("budgetMicros must be a positive number");
+        }
+        // NaN and infinities would make the thresholds undefined
+        if (!std::isfinite(info[0]->NumberValue()) || info[0]->NumberValue() < 0) {
+            return Nan::ThrowRangeError("budgetMicros must be a finite positive number");
+        }
+        dispatch_lock();
+        dispatchBudgetMicros = info[0]->NumberValue();
+        dispatch_unlock();
+    }
 
-    // cipherText should have crypto_box_MACBYTES + encrypted message chars so lets check
-    if (cipherText_size < crypto_box_MACBYTES) {
-        std::ostringstream oss;
-        oss << "argument cipherText must have a length of at least " << crypto_box_MACBYTES << " bytes";
-        return Nan::ThrowError(oss.str().c_str());
+    try {
+        dispatch_calibrate();
+    } catch (std::runtime_error* e) {
+        Nan::ThrowError(e->what());
+        delete e;
+        return;
     }
+    return info.GetReturnValue().Set(dispatch_thresholds_object());
+}
 
-    NEW_BUFFER_AND_PTR(msg, cipherText_size - crypto_box_MACBYTES);
+/**
+ * Returns { budget, crypto_secretbox_easy: { threshold, fixedMicros, bytesPerMicro, overridden }, crypto_box_easy: {...}, crypto_hash: {...} }
+ * Messages up to `threshold` bytes are processed synchronously by the _auto bindings
+ */
+NAN_METHOD(bind_sodium_dispatch_thresholds) {
+    Nan::EscapableHandleScope scope;
 
-    if( crypto_box_open_easy(msg_ptr, cipherText, cipherText_size, nonce, publicKey, secretKey) == 0) {
-        return info.GetReturnValue().Set(msg);
-    } else {
+    try {
+        dispatch_threshold(DISPATCH_HASH);
+    } catch (std::runtime_error* e) {
+        Nan::ThrowError(e->what());
+        delete e;
         return;
     }
+    return info.GetReturnValue().Set(dispatch_thresholds_object());
 }
 
 /**
- * Partially performs the computation required for both encryption and decryption of data.
- *
- * int crypto_box_beforenm(
- *    unsigned char*        k,
- *    const unsigned char*  pk,
- *    const unsigned char*  sk)
- *
- * Parameters:
- *    [out] k   the result of the computation.
- *    [in]  pk  the receivers public key, used for encryption.
- *    [in]  sk  the senders private key, used for signing.
- *
- * The intermediate data computed by crypto_box_beforenm is suitable for both
- * crypto_box_afternm and crypto_box_open_afternm, and can be reused for any
- * number of messages.
+ * Overrides the calibrated threshold of a primitive
+ * String name, Number bytes. Pass a negative number of bytes to go back to the calibrated value
  */
-NAN_METHOD(bind_crypto_box_beforenm) {
+NAN_METHOD(bind_sodium_dispatch_set_threshold) {
     Nan::EscapableHandleScope scope;
 
-    NUMBER_OF_MANDATORY_ARGS(2,"arguments publicKey, and secretKey must be buffers");
+    NUMBER_OF_MANDATORY_ARGS(2, "arguments name must be a string and bytes must be a number");
+    if (!info[1]->IsNumber()) {
+        return Nan::ThrowTypeError("bytes must be a number");
+    }
 
-    GET_ARG_AS_UCHAR_LEN(0, publicKey, crypto_box_PUBLICKEYBYTES);
-    GET_ARG_AS_UCHAR_LEN(1, secretKey, crypto_box_SECRETKEYBYTES);
+    String::Utf8Value name(info[0]);
+    for (int i = 0; i < DISPATCH_COUNT; i++) {
+        if (strcmp(*name, dispatchProfiles[i].name) != 0) continue;
 
-    NEW_BUFFER_AND_PTR(k, crypto_box_BEFORENMBYTES);
+        double bytes = info[1]->NumberValue();
+        if (std::isnan(bytes)) {
+            return Nan::ThrowRangeError("bytes must be a number");
+        }
+        dispatch_lock();
+        if (bytes < 0) {
+            dispatchProfiles[i].overridden = false;
+            dispatch_update_threshold(&dispatchProfiles[i]);
+        } else {
+            dispatchProfiles[i].overridden = true;
+            dispatchProfiles[i].threshold = bytes >= (double) 0xFFFFFFFF ? 0xFFFFFFFF : (size_t) bytes;
+        }
+        dispatch_unlock();
+        return info.GetReturnValue().Set(Nan::Undefined());
+    }
+    return Nan::ThrowTypeError("unknown primitive name");
+}
 
-    crypto_box_beforenm(k_ptr, publicKey, secretKey);
-    return info.GetReturnValue().Set(k);
+// Calibration may throw on allocation failure; async in that case
+#define DISPATCH_INLINE(primitive, size, inlineVar) \
+    bool inlineVar = false; \
+    try { \
+        inlineVar = (size) <= dispatch_threshold(primitive); \
+    } catch (std::runtime_error* e) { \
+        delete e; \
+    }
+
+/*
+* Delivers the result of an inline call as callback(err, result) on the next tick, so that the _auto
+* bindings call back asynchronously whichever way the message was processed
+*/
+static void dispatch_callback(Local<Value> callback, Local<Value> err, Local<Value> result) {
+    Local<Object> process = Nan::To<Object>(Nan::Get(Nan::GetCurrentContext()->Global(), Nan::New("process").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+    Local<Function> nextTick = Nan::Get(process, Nan::New("nextTick").ToLocalChecked()).ToLocalChecked().As<Function>();
+    Local<Value> argv[] = { callback, err, result };
+    Nan::Call(nextTick, process, 3, argv);
 }
 
 /**
- * Encrypts a given a message m, using partial computed data.
- *
- * int crypto_box_afternm(
- *    unsigned char * ctxt,
- *       const unsigned char * msg,
- *       unsigned long long mlen,
- *       const unsigned char * nonce,
- *       const unsigned char * k)
- *
- * Parameters:
- *    [out] ctxt   the buffer for the cipher-text.
- *    [in]  msg    the message to be encrypted.
- *    [in]  mlen   the length of msg.
- *    [in]  nonce  a randomly generated nonce.
- *    [in]  k      the partial computed data.
- *
- * Returns:
- *    0 if operation is successful.
+ * crypto_secretbox_easy, run inline or on the worker pool depending on the message size
+ * Buffer message, Buffer nonce, Buffer key, Function callback(err, cipherText)
+ * The result is always passed to the callback, asynchronously: on the next tick when the message
+ * was processed inline, once the worker is done otherwise
  */
-NAN_METHOD(bind_crypto_box_afternm) {
+NAN_METHOD(bind_crypto_secretbox_easy_auto) {
     Nan::EscapableHandleScope scope;
 
-    NUMBER_OF_MANDATORY_ARGS(3,"arguments message, nonce and k must be buffers");
+    NUMBER_OF_MANDATORY_ARGS(4,"arguments message, nonce, and key must be buffers; callback must be a function");
 
     GET_ARG_AS_UCHAR(0, message);
-    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_box_NONCEBYTES);
-    GET_ARG_AS_UCHAR_LEN(2, k, crypto_box_BEFORENMBYTES);
-
-    // Pad the message with crypto_box_ZEROBYTES zeros
-    NEW_BUFFER_AND_PTR(msg, message_size + crypto_box_ZEROBYTES);
-
-    unsigned int i;
-    for(i=0; i < crypto_box_ZEROBYTES; i++) {
-       msg_ptr[i] = 0U;
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_secretbox_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, key, crypto_secretbox_KEYBYTES);
+    if (!info[info.Length() - 1]->IsFunction()) {
+        return Nan::ThrowTypeError("the last argument must be a callback function");
     }
-    //Copy the message to the new buffer
-    memcpy((void*) (msg_ptr + crypto_box_ZEROBYTES), (void *) message, message_size);
-    message_size += crypto_box_ZEROBYTES;
-
-    NEW_BUFFER_AND_PTR(ctxt, message_size);
 
-    if( crypto_box_afternm(ctxt_ptr, msg_ptr, message_size, nonce, k) == 0) {
-        return info.GetReturnValue().Set(ctxt);
-    } else {
-        return;
+    DISPATCH_INLINE(DISPATCH_SECRETBOX_EASY, message_size, runInline);
+    if (runInline) {
+        NEW_BUFFER_AND_PTR(c, message_size + crypto_secretbox_MACBYTES);
+        if (crypto_secretbox_easy(c_ptr, message, message_size, nonce, key) == 0) {
+            dispatch_callback(info[info.Length() - 1], Nan::Null(), c);
+        } else {
+            dispatch_callback(info[info.Length() - 1], Nan::Error("encryption failed"), Nan::Undefined());
+        }
+        return info.GetReturnValue().Set(Nan::Undefined());
     }
+
+    GET_CALLBACK_LAST(callback);
+    WorkerPool::QueueWorker(new CryptoWorker(callback, CryptoWorker::SECRETBOX_EASY, info[0]->ToObject(), message, message_size,
+        nonce, nonce_size, key, key_size));
+    return info.GetReturnValue().Set(Nan::Undefined());
 }
 
 /**
- * Decrypts a ciphertext ctxt given the receivers private key, and senders public key.
- *
- * int crypto_box_open_afternm ( unsigned char * msg,
- *    const unsigned char * ctxt,
- *    unsigned long long clen,
- *    const unsigned char * nonce,
- *    const unsigned char * k)
- *
- * Parameters:
- *    [out] msg    the buffer to place resulting plaintext.
- *    [in]  ctxt   the ciphertext to be decrypted.
- *    [in]  clen   the length of the ciphertext.
- *    [in]  nonce  a randomly generated nonce.
- *    [in]  k      the partial computed data.
- *
- * Returns:
- *    0 if successful and -1 if verification fails.
- *
- * Precondition:
- *    first crypto_box_BOXZEROBYTES of ctxt be all 0.
- *    the nonce must have size crypto_box_NONCEBYTES.
- *
- * Postcondition:
- *    first clen bytes of msg will contain the plaintext.
- *    first crypto_box_ZEROBYTES of msg will be all 0.
+ * crypto_box_easy, run inline or on the worker pool depending on the message size
+ * Buffer message, Buffer nonce, Buffer publicKey, Buffer secretKey, Function callback(err, cipherText)
+ * Same callback convention as crypto_secretbox_easy_auto
  */
-NAN_METHOD(bind_crypto_box_open_afternm) {
+NAN_METHOD(bind_crypto_box_easy_auto) {
     Nan::EscapableHandleScope scope;
 
-    NUMBER_OF_MANDATORY_ARGS(3,"arguments cipherText, nonce, k");
-
-    GET_ARG_AS_UCHAR(0, cipherText);
-    GET_ARG_AS_UCHAR_LEN(0, nonce, crypto_box_NONCEBYTES);
-    GET_ARG_AS_UCHAR_LEN(1, k, crypto_box_BEFORENMBYTES);
+    NUMBER_OF_MANDATORY_ARGS(5,"arguments message, nonce, publicKey and secretKey must be buffers; callback must be a function");
 
-    // API requires that the first crypto_box_BOXZEROBYTES of msg be 0 so lets check
-    if( cipherText_size < crypto_box_BOXZEROBYTES ) {
-        std::ostringstream oss;
-        oss << "argument cipherText must have a length of at least " << crypto_box_BOXZEROBYTES << " bytes";
-        return Nan::ThrowError(oss.str().c_str());
+    GET_ARG_AS_UCHAR(0, message);
+    GET_ARG_AS_UCHAR_LEN(1, nonce, crypto_box_NONCEBYTES);
+    GET_ARG_AS_UCHAR_LEN(2, publicKey, crypto_box_PUBLICKEYBYTES);
+    GET_ARG_AS_UCHAR_LEN(3, secretKey, crypto_box_SECRETKEYBYTES);
+    if (!info[info.Length() - 1]->IsFunction()) {
+        return Nan::ThrowTypeError("the last argument must be a callback function");
     }
 
-    unsigned int i;
-    for(i=0; i < crypto_box_BOXZEROBYTES; i++) {
-        if( cipherText[i] ) break;
-    }
-    if( i < crypto_box_BOXZEROBYTES ) {
-        std::ostringstream oss;
-        oss << "the first " << crypto_box_BOXZEROBYTES << " bytes of argument cipherText must be 0";
-        return Nan::ThrowError(oss.str().c_str());
+    DISPATCH_INLINE(DISPATCH_BOX_EASY, message_size, runInline);
+    if (runInline) {
+        NEW_BUFFER_AND_PTR(ctxt, message_size + crypto_box_MACBYTES);
+        if (crypto_box_easy(ctxt_ptr, message, message_size, nonce, publicKey, secretKey) == 0) {
+            dispatch_callback(info[info.Length() - 1], Nan::Null(), ctxt);
+        } else {
+            dispatch_callback(info[info.Length() - 1], Nan::Error("encryption failed"), Nan::Undefined());
+        }
+        return info.GetReturnValue().Set(Nan::Undefined());
     }
 
-    NEW_BUFFER_AND_PTR(msg, cipherText_size);
+    GET_CALLBACK_LAST(callback);
+    WorkerPool::QueueWorker(new CryptoWorker(callback, CryptoWorker::BOX_EASY, info[0]->ToObject(), message, message_size,
+        nonce, nonce_size, publicKey, publicKey_size, secretKey, secretKey_size));
+    return info.GetReturnValue().Set(Nan::Undefined());
+}
+
+/**
+ * crypto_hash, run inline or on the worker pool depending on the message size
+ * Buffer message, Function callback(err, hash)
+ * Same callback convention as crypto_secretbox_easy_auto
+ */
+NAN_METHOD(bind_crypto_hash_auto) {
+    Nan::EscapableHandleScope scope;
 
-    if( crypto_box_open_afternm(msg_ptr, cipherText, cipherText_size, nonce, k) == 0) {
+    NUMBER_OF_MANDATORY_ARGS(2,"argument message must be a buffer; callback must be a function");
 
-        // Remove the padding at the beginning of the message
-        NEW_BUFFER_AND_PTR(plain_text,cipherText_size - crypto_box_ZEROBYTES);
-        memcpy(plain_text_ptr,(void*) (msg_ptr + crypto_box_ZEROBYTES), cipherText_size - crypto_box_ZEROBYTES);
+    GET_ARG_AS_UCHAR(0, message);
+    if (!info[info.Length() - 1]->IsFunction()) {
+        return Nan::ThrowTypeError("the last argument must be a callback function");
+    }
 
-        return info.GetReturnValue().Set(plain_text);
-    } else {
-        return;
+    DISPATCH_INLINE(DISPATCH_HASH, message_size, runInline);
+    if (runInline) {
+        NEW_BUFFER_AND_PTR(hash, crypto_hash_BYTES);
+        crypto_hash(hash_ptr, message, message_size);
+        dispatch_callback(info[info.Length() - 1], Nan::Null(), hash);
+        return info.GetReturnValue().Set(Nan::Undefined());
     }
+
+    GET_CALLBACK_LAST(callback);
+    WorkerPool::QueueWorker(new CryptoWorker(callback, CryptoWorker::HASH, info[0]->ToObject(), message, message_size));
+    return info.GetReturnValue().Set(Nan::Undefined());
 }
 
 /**
@@ -1980,13 +5048,28 @@ NAN_METHOD(bind_crypto_scalarmult) {
 #define NEW_UINT_PROP(NAME) \
     Nan::ForceSet(target, Nan::New<String>(#NAME).ToLocalChecked(), Nan::New<v8::Uint32>((uint32_t) NAME), v8::ReadOnly);
 
-void RegisterModule(Handle<Object> target) {
+void RegisterModule(Local<Object> target) {
     // init sodium library before we do anything
     sodium_init();
 
+    // Start the crypto worker pool
+    WorkerPool::Init();
+
+    // Slab of the small results of this thread
+    result_slab_init();
+
+    // Scratch buffer of the string messages of this thread
+    message_scratch_init();
+
     // Register KeyRing object
     KeyRing::Init(target);
 
+    // Register the incremental hashing and authentication objects
+    HashState::Init(target);
+    AuthState::Init(target);
+    OnetimeAuthState::Init(target);
+    SecretboxStream::Init(target);
+
     // Register version functions
     NEW_METHOD(sodium_version_string);
 
@@ -1994,10 +5077,33 @@ void RegisterModule(Handle<Object> target) {
     NEW_METHOD(sodium_library_version_minor);
     NEW_METHOD(sodium_library_version_major);
 
+    // Crypto worker pool counters
+    NEW_METHOD(sodium_pool_stats);
+    NEW_METHOD(sodium_result_slab);
+
+    // Sync/async dispatch thresholds
+    NEW_METHOD(sodium_dispatch_calibrate);
+    NEW_METHOD(sodium_dispatch_thresholds);
+    NEW_METHOD(sodium_dispatch_set_threshold);
+
     // register utilities
     NEW_METHOD(memzero);
     NEW_METHOD(memcmp);
 
+    // register hex and base64 codecs
+    NEW_METHOD(sodium_bin2hex);
+    NEW_METHOD(sodium_bin2hex_into);
+    NEW_METHOD(sodium_hex2bin);
+    NEW_METHOD(sodium_hex2bin_into);
+    NEW_METHOD(sodium_bin2base64);
+    NEW_METHOD(sodium_bin2base64_into);
+    NEW_METHOD(sodium_base642bin);
+    NEW_METHOD(sodium_base642bin_into);
+    NEW_INT_PROP(sodium_base64_VARIANT_ORIGINAL);
+    NEW_INT_PROP(sodium_base64_VARIANT_ORIGINAL_NO_PADDING);
+    NEW_INT_PROP(sodium_base64_VARIANT_URLSAFE);
+    NEW_INT_PROP(sodium_base64_VARIANT_URLSAFE_NO_PADDING);
+
     // register random utilities
     NEW_METHOD(randombytes_buf);
     Nan::SetMethod(target, "randombytes", bind_randombytes_buf);
@@ -2012,8 +5118,13 @@ void RegisterModule(Handle<Object> target) {
 
     // Hash
     NEW_METHOD(crypto_hash);
+    NEW_METHOD(crypto_hash_async);
+    NEW_METHOD(crypto_hash_auto);
+    NEW_METHOD(crypto_hash_into);
     NEW_METHOD(crypto_hash_sha512);
+    NEW_METHOD(crypto_hash_sha512_into);
     NEW_METHOD(crypto_hash_sha256);
+    NEW_METHOD(crypto_hash_sha256_into);
     NEW_INT_PROP(crypto_hash_BYTES);
     NEW_INT_PROP(crypto_hash_sha256_BYTES);
     NEW_INT_PROP(crypto_hash_sha512_BYTES);
@@ -2023,6 +5134,8 @@ void RegisterModule(Handle<Object> target) {
     // Password hash / Key derivation
     NEW_METHOD(crypto_pwhash_scryptsalsa208sha256);
     NEW_METHOD(crypto_pwhash_scryptsalsa208sha256_ll);
+    NEW_METHOD(crypto_pwhash_scryptsalsa208sha256_async);
+    NEW_METHOD(crypto_pwhash_scryptsalsa208sha256_ll_async);
     NEW_INT_PROP(crypto_pwhash_scryptsalsa208sha256_SALTBYTES);
     NEW_INT_PROP(crypto_pwhash_scryptsalsa208sha256_STRBYTES);
     NEW_UINT_PROP(crypto_pwhash_scryptsalsa208sha256_OPSLIMIT_SENSITIVE);
@@ -2033,6 +5146,8 @@ void RegisterModule(Handle<Object> target) {
     // Password-based file encryption
     Nan::SetMethod(target, "encrypt_file", pw_file_encrypt);
     Nan::SetMethod(target, "decrypt_file", pw_file_decrypt);
+    Nan::SetMethod(target, "encrypt_file_stream", pw_file_stream_encrypt);
+    Nan::SetMethod(target, "decrypt_file_stream", pw_file_stream_decrypt);
 
     // Auth
     NEW_METHOD(crypto_auth);
@@ -2051,6 +5166,9 @@ void RegisterModule(Handle<Object> target) {
     // Stream
     NEW_METHOD(crypto_stream);
     NEW_METHOD(crypto_stream_xor);
+    NEW_METHOD(crypto_stream_xor_async);
+    NEW_METHOD(crypto_stream_xor_into);
+    NEW_METHOD(crypto_stream_xor_inplace);
     NEW_INT_PROP(crypto_stream_KEYBYTES);
     NEW_INT_PROP(crypto_stream_NONCEBYTES);
     NEW_STRING_PROP(crypto_stream_PRIMITIVE);
@@ -2067,9 +5185,20 @@ void RegisterModule(Handle<Object> target) {
     NEW_METHOD(crypto_secretbox);
     NEW_METHOD(crypto_secretbox_open);
     NEW_METHOD(crypto_secretbox_easy);
+    NEW_METHOD(crypto_secretbox_easy_async);
+    NEW_METHOD(crypto_secretbox_easy_auto);
+    NEW_METHOD(crypto_secretbox_easy_into);
+    NEW_METHOD(crypto_secretbox_easy_inplace);
     NEW_METHOD(crypto_secretbox_open_easy);
+    NEW_METHOD(crypto_secretbox_open_easy_into);
+    NEW_METHOD(crypto_secretbox_open_easy_inplace);
+    NEW_METHOD(crypto_secretbox_detached);
+    NEW_METHOD(crypto_secretbox_open_detached);
+    NEW_METHOD(crypto_secretbox_easy_iov);
+    NEW_METHOD(crypto_secretbox_open_easy_iov);
     NEW_INT_PROP(crypto_secretbox_BOXZEROBYTES);
     NEW_INT_PROP(crypto_secretbox_KEYBYTES);
+    NEW_INT_PROP(crypto_secretbox_MACBYTES);
     NEW_INT_PROP(crypto_secretbox_NONCEBYTES);
     NEW_INT_PROP(crypto_secretbox_ZEROBYTES);
     NEW_STRING_PROP(crypto_secretbox_PRIMITIVE);
@@ -2077,10 +5206,13 @@ void RegisterModule(Handle<Object> target) {
     // Sign
     NEW_METHOD(crypto_sign);
     NEW_METHOD(crypto_sign_detached);
+    NEW_METHOD(crypto_sign_detached_into);
     NEW_METHOD(crypto_sign_keypair);
     NEW_METHOD(crypto_sign_seed_keypair);
     NEW_METHOD(crypto_sign_open);
     NEW_METHOD(crypto_sign_verify_detached);
+    NEW_METHOD(crypto_sign_verify_detached_batch);
+    NEW_METHOD(crypto_sign_detached_batch);
     NEW_INT_PROP(crypto_sign_BYTES);
     NEW_INT_PROP(crypto_sign_PUBLICKEYBYTES);
     NEW_INT_PROP(crypto_sign_SECRETKEYBYTES);
@@ -2093,12 +5225,23 @@ void RegisterModule(Handle<Object> target) {
     // Box
     NEW_METHOD(crypto_box);
     NEW_METHOD(crypto_box_easy);
+    NEW_METHOD(crypto_box_easy_async);
+    NEW_METHOD(crypto_box_easy_auto);
+    NEW_METHOD(crypto_box_easy_into);
     NEW_METHOD(crypto_box_keypair);
     NEW_METHOD(crypto_box_open);
     NEW_METHOD(crypto_box_open_easy);
+    NEW_METHOD(crypto_box_open_easy_into);
+    NEW_METHOD(crypto_box_detached);
+    NEW_METHOD(crypto_box_open_detached);
     NEW_METHOD(crypto_box_beforenm);
     NEW_METHOD(crypto_box_afternm);
+    NEW_METHOD(crypto_box_afternm_async);
     NEW_METHOD(crypto_box_open_afternm);
+    NEW_METHOD(crypto_box_detached_afternm);
+    NEW_METHOD(crypto_box_open_detached_afternm);
+    NEW_METHOD(crypto_box_afternm_batch);
+    NEW_METHOD(crypto_box_open_afternm_batch);
     NEW_INT_PROP(crypto_box_NONCEBYTES);
     NEW_INT_PROP(crypto_box_BEFORENMBYTES);
     NEW_INT_PROP(crypto_box_BOXZEROBYTES);
@@ -2122,4 +5265,5 @@ void RegisterModule(Handle<Object> target) {
 
 }
 
-NODE_MODULE(sodium, RegisterModule);
+// Context-aware: can be loaded by several worker_threads
+NAN_MODULE_WORKER_ENABLED(sodium, RegisterModule)
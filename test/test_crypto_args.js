@@ -0,0 +1,112 @@
+"use strict";
+
+var should = require('should');
+var crypto = require('crypto');
+var sodium = require('../build/Release/sodium');
+
+describe('Binary arguments', function() {
+    var key = sodium.randombytes_buf(sodium.crypto_secretbox_KEYBYTES);
+    var nonce = sodium.randombytes_buf(sodium.crypto_secretbox_NONCEBYTES);
+    var message = crypto.randomBytes(100);
+    var expected = sodium.crypto_secretbox_easy(message, nonce, key).toString('hex');
+
+    // Copies buffer into a larger arena, and returns a view of it at an offset
+    function viewOf(buffer, ViewType, arena) {
+        var offset = 24;
+        var bytes = new Uint8Array(arena || new ArrayBuffer(buffer.length + 2 * offset), offset, buffer.length);
+        bytes.set(buffer);
+        return ViewType === Uint8Array ? bytes : new ViewType(bytes.buffer, bytes.byteOffset, buffer.length);
+    }
+
+    function arrayBufferOf(buffer) {
+        var arrayBuffer = new ArrayBuffer(buffer.length);
+        new Uint8Array(arrayBuffer).set(buffer);
+        return arrayBuffer;
+    }
+
+    it('should accept Uint8Array views at an offset', function(done) {
+        sodium.crypto_secretbox_easy(viewOf(message, Uint8Array), viewOf(nonce, Uint8Array), viewOf(key, Uint8Array))
+            .toString('hex').should.eql(expected);
+        done();
+    });
+
+    it('should accept DataView', function(done) {
+        sodium.crypto_secretbox_easy(viewOf(message, DataView), nonce, key).toString('hex').should.eql(expected);
+        done();
+    });
+
+    it('should accept ArrayBuffer', function(done) {
+        sodium.crypto_secretbox_easy(arrayBufferOf(message), arrayBufferOf(nonce), arrayBufferOf(key))
+            .toString('hex').should.eql(expected);
+        done();
+    });
+
+    it('should accept views of a SharedArrayBuffer', function(done) {
+        if (typeof SharedArrayBuffer === 'undefined') return done();
+        var arena = new SharedArrayBuffer(message.length + 48);
+        sodium.crypto_secretbox_easy(viewOf(message, Uint8Array, arena), nonce, key).toString('hex').should.eql(expected);
+        done();
+    });
+
+    it('should write into views', function(done) {
+        var out = new Uint8Array(new ArrayBuffer(200), 10, 150);
+        var written = sodium.crypto_secretbox_easy_into(out, 2, message, nonce, key);
+        new Buffer(out.buffer, out.byteOffset + 2, written).toString('hex').should.eql(expected);
+        done();
+    });
+
+    it('should accept views in batches', function(done) {
+        var keys = sodium.crypto_sign_keypair();
+        var messages = [viewOf(message, Uint8Array), message];
+        var signatures = sodium.crypto_sign_detached_batch(messages, viewOf(keys.secretKey, Uint8Array));
+        sodium.crypto_sign_verify_detached_batch(signatures, messages, keys.publicKey)
+            .toString('hex').should.eql('0101');
+        done();
+    });
+
+    it('should reject other types', function(done) {
+        (function() {
+            sodium.crypto_secretbox_easy([1, 2, 3], nonce, key);
+        }).should.throw();
+        (function() {
+            sodium.crypto_secretbox_easy({}, nonce, key);
+        }).should.throw();
+        done();
+    });
+});
+
+describe('String messages', function() {
+    var key = crypto.randomBytes(sodium.crypto_secretbox_KEYBYTES);
+    var nonce = crypto.randomBytes(sodium.crypto_secretbox_NONCEBYTES);
+    var json = JSON.stringify({ name: 'café 😀', values: [1, 2, 3] });
+
+    it('should encode strings to UTF-8, as Buffer', function(done) {
+        sodium.crypto_secretbox_easy(json, nonce, key).toString('hex')
+            .should.eql(sodium.crypto_secretbox_easy(new Buffer(json, 'utf8'), nonce, key).toString('hex'));
+        sodium.crypto_hash_sha256(json).toString('hex')
+            .should.eql(crypto.createHash('sha256').update(json, 'utf8').digest('hex'));
+        done();
+    });
+
+    it('should accept long strings', function(done) {
+        var long = new Array(5000).join(json);
+        sodium.crypto_hash_sha256(long).toString('hex')
+            .should.eql(crypto.createHash('sha256').update(long, 'utf8').digest('hex'));
+        done();
+    });
+
+    it('should accept strings in sign and verify', function(done) {
+        var keys = sodium.crypto_sign_keypair();
+        var signature = sodium.crypto_sign_detached(json, keys.secretKey);
+        sodium.crypto_sign_verify_detached(signature, new Buffer(json, 'utf8'), keys.publicKey).should.be.ok;
+        sodium.crypto_sign_verify_detached(signature, json, keys.publicKey).should.be.ok;
+        done();
+    });
+
+    it('should still reject empty messages', function(done) {
+        (function() {
+            sodium.crypto_hash_sha256('');
+        }).should.throw();
+        done();
+    });
+});
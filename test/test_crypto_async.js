@@ -0,0 +1,176 @@
+"use strict";
+
+var should = require('should');
+var crypto = require('crypto');
+var sodium = require('../build/Release/sodium');
+
+// Large enough to be worth a thread hop, odd to catch off-by-one padding bugs
+var message = crypto.randomBytes(1024 * 1024 + 7);
+
+describe('Async AEAD', function() {
+    this.timeout(10000);
+
+    it('crypto_secretbox_easy_async should match crypto_secretbox_easy', function(done) {
+        var nonce = crypto.randomBytes(sodium.crypto_secretbox_NONCEBYTES);
+        var key = crypto.randomBytes(sodium.crypto_secretbox_KEYBYTES);
+        var expected = sodium.crypto_secretbox_easy(message, nonce, key);
+        sodium.crypto_secretbox_easy_async(message, nonce, key, function(err, cipherText) {
+            should.not.exist(err);
+            cipherText.toString('hex').should.eql(expected.toString('hex'));
+            sodium.crypto_secretbox_open_easy(cipherText, nonce, key).toString('hex').should.eql(message.toString('hex'));
+            done();
+        });
+    });
+
+    it('crypto_box_easy_async should match crypto_box_easy', function(done) {
+        var sender = sodium.crypto_box_keypair();
+        var receiver = sodium.crypto_box_keypair();
+        var nonce = crypto.randomBytes(sodium.crypto_box_NONCEBYTES);
+        var expected = sodium.crypto_box_easy(message, nonce, receiver.publicKey, sender.secretKey);
+        sodium.crypto_box_easy_async(message, nonce, receiver.publicKey, sender.secretKey, function(err, cipherText) {
+            should.not.exist(err);
+            cipherText.toString('hex').should.eql(expected.toString('hex'));
+            done();
+        });
+    });
+
+    it('crypto_box_afternm_async should match crypto_box_afternm', function(done) {
+        var sender = sodium.crypto_box_keypair();
+        var receiver = sodium.crypto_box_keypair();
+        var k = sodium.crypto_box_beforenm(receiver.publicKey, sender.secretKey);
+        var nonce = crypto.randomBytes(sodium.crypto_box_NONCEBYTES);
+        var expected = sodium.crypto_box_afternm(message, nonce, k);
+        sodium.crypto_box_afternm_async(message, nonce, k, function(err, cipherText) {
+            should.not.exist(err);
+            cipherText.length.should.eql(expected.length);
+            cipherText.toString('hex').should.eql(expected.toString('hex'));
+            done();
+        });
+    });
+
+    it('crypto_stream_xor_async should match crypto_stream_xor', function(done) {
+        var nonce = crypto.randomBytes(sodium.crypto_stream_NONCEBYTES);
+        var key = crypto.randomBytes(sodium.crypto_stream_KEYBYTES);
+        var expected = sodium.crypto_stream_xor(message, nonce, key);
+        sodium.crypto_stream_xor_async(message, nonce, key, function(err, cipherText) {
+            should.not.exist(err);
+            cipherText.toString('hex').should.eql(expected.toString('hex'));
+            done();
+        });
+    });
+
+    it('should call back asynchronously', function(done) {
+        var nonce = crypto.randomBytes(sodium.crypto_secretbox_NONCEBYTES);
+        var key = crypto.randomBytes(sodium.crypto_secretbox_KEYBYTES);
+        var returned = false;
+        sodium.crypto_secretbox_easy_async(new Buffer('hello'), nonce, key, function(err, cipherText) {
+            returned.should.be.ok;
+            done();
+        });
+        returned = true;
+    });
+
+    it('should throw on a bad key size', function() {
+        var nonce = crypto.randomBytes(sodium.crypto_secretbox_NONCEBYTES);
+        (function() {
+            sodium.crypto_secretbox_easy_async(message, nonce, new Buffer(2), function() {});
+        }).should.throw();
+    });
+
+    it('should throw without a callback', function() {
+        var nonce = crypto.randomBytes(sodium.crypto_stream_NONCEBYTES);
+        var key = crypto.randomBytes(sodium.crypto_stream_KEYBYTES);
+        (function() {
+            sodium.crypto_stream_xor_async(message, nonce, key);
+        }).should.throw();
+    });
+});
+
+describe('Sync/async dispatch', function() {
+    this.timeout(10000);
+
+    var nonce = crypto.randomBytes(sodium.crypto_secretbox_NONCEBYTES);
+    var key = crypto.randomBytes(sodium.crypto_secretbox_KEYBYTES);
+
+    afterEach(function() {
+        sodium.sodium_dispatch_set_threshold('crypto_secretbox_easy', -1);
+        sodium.sodium_dispatch_set_threshold('crypto_hash', -1);
+    });
+
+    it('should expose calibrated thresholds', function() {
+        var thresholds = sodium.sodium_dispatch_thresholds();
+        thresholds.budget.should.be.above(0);
+        ['crypto_secretbox_easy', 'crypto_box_easy', 'crypto_hash'].forEach(function(name) {
+            thresholds[name].threshold.should.be.type('number');
+            thresholds[name].bytesPerMicro.should.be.above(0);
+            thresholds[name].overridden.should.eql(false);
+        });
+    });
+
+    it('should scale thresholds with the latency budget', function() {
+        var initialBudget = sodium.sodium_dispatch_thresholds().budget;
+        var small = sodium.sodium_dispatch_calibrate(100);
+        var large = sodium.sodium_dispatch_calibrate(100000);
+        large.budget.should.eql(100000);
+        large.crypto_hash.threshold.should.be.above(small.crypto_hash.threshold);
+        sodium.sodium_dispatch_calibrate(initialBudget);
+    });
+
+    it('should run small messages inline, and still call back asynchronously', function(done) {
+        sodium.sodium_dispatch_set_threshold('crypto_secretbox_easy', 1024);
+        var message = crypto.randomBytes(100);
+        var returned = false;
+        var result = sodium.crypto_secretbox_easy_auto(message, nonce, key, function(err, cipherText) {
+            returned.should.eql(true);
+            should.not.exist(err);
+            cipherText.toString('hex').should.eql(sodium.crypto_secretbox_easy(message, nonce, key).toString('hex'));
+            done();
+        });
+        returned = true;
+        should.not.exist(result);
+    });
+
+    it('should offload large messages', function(done) {
+        sodium.sodium_dispatch_set_threshold('crypto_secretbox_easy', 1024);
+        var message = crypto.randomBytes(4096);
+        var result = sodium.crypto_secretbox_easy_auto(message, nonce, key, function(err, cipherText) {
+            should.not.exist(err);
+            cipherText.toString('hex').should.eql(sodium.crypto_secretbox_easy(message, nonce, key).toString('hex'));
+            done();
+        });
+        should.not.exist(result);
+    });
+
+    it('crypto_hash_auto should match crypto_hash both ways', function(done) {
+        var message = crypto.randomBytes(4096);
+        var expected = sodium.crypto_hash(message).toString('hex');
+        sodium.sodium_dispatch_set_threshold('crypto_hash', 1 << 20);
+        sodium.crypto_hash_auto(message, function(err, hash) {
+            should.not.exist(err);
+            hash.toString('hex').should.eql(expected);
+            sodium.sodium_dispatch_set_threshold('crypto_hash', 0);
+            sodium.crypto_hash_auto(message, function(err, hash) {
+                should.not.exist(err);
+                hash.toString('hex').should.eql(expected);
+                done();
+            });
+        });
+    });
+
+    it('should reject budgets and thresholds that are not numbers', function() {
+        [NaN, Infinity, -1].forEach(function(budget) {
+            (function() {
+                sodium.sodium_dispatch_calibrate(budget);
+            }).should.throw(RangeError);
+        });
+        (function() {
+            sodium.sodium_dispatch_set_threshold('crypto_hash', NaN);
+        }).should.throw(RangeError);
+    });
+
+    it('should reject unknown primitive names', function() {
+        (function() {
+            sodium.sodium_dispatch_set_threshold('crypto_nope', 10);
+        }).should.throw();
+    });
+});
@@ -137,3 +137,57 @@ describe('crypto_auth_verify check paramters', function() {
     });
 
 });
+
+describe('Auth state', function() {
+    var key = crypto.randomBytes(sodium.crypto_auth_KEYBYTES);
+    var message = crypto.randomBytes(1000);
+
+    it('should authenticate incrementally, as crypto_auth', function(done) {
+        var state = new sodium.AuthState(key);
+        for (var i = 0; i < message.length; i += 99) {
+            state.update(message.slice(i, i + 99));
+        }
+        state.final().toString('hex').should.eql(sodium.crypto_auth(message, key).toString('hex'));
+        done();
+    });
+
+    it('should compute HMAC-SHA-256', function(done) {
+        var tag = new sodium.AuthState(key, 'hmacsha256').update(message).final();
+        tag.toString('hex').should.eql(crypto.createHmac('sha256', key).update(message).digest('hex'));
+        done();
+    });
+
+    it('should verify tags', function(done) {
+        var tag = sodium.crypto_auth(message, key);
+        new sodium.AuthState(key).update(message).verify(tag).should.eql(true);
+        tag[0] ^= 1;
+        new sodium.AuthState(key).update(message).verify(tag).should.eql(false);
+        done();
+    });
+
+    it('should accept ArrayBuffers', function(done) {
+        var tag = sodium.crypto_auth(message, key);
+        var state = new sodium.AuthState(new Uint8Array(key).buffer);
+        state.update(new Uint8Array(message).buffer).verify(new Uint8Array(tag).buffer).should.eql(true);
+        done();
+    });
+
+    it('should throw once finalized', function(done) {
+        var state = new sodium.AuthState(key).update(message);
+        state.final();
+        (function() {
+            state.update(message);
+        }).should.throw();
+        (function() {
+            state.verify(new Buffer(32));
+        }).should.throw();
+        done();
+    });
+
+    it('should reject invalid keys', function(done) {
+        (function() {
+            new sodium.AuthState(new Buffer(16));
+        }).should.throw();
+        done();
+    });
+});
@@ -301,4 +301,153 @@ describe('BoxOpen', function() {
         done();
     });
 
-});
\ No newline at end of file
+});
+describe('Box afternm batch', function() {
+    var alice = sodium.crypto_box_keypair();
+    var bob = sodium.crypto_box_keypair();
+    var k = sodium.crypto_box_beforenm(bob.publicKey, alice.secretKey);
+    var count = 300;
+    var messages = [], nonces = [];
+    for (var i = 0; i < count; i++) {
+        messages.push(crypto.randomBytes(1 + i % 100));
+        nonces.push(crypto.randomBytes(sodium.crypto_box_NONCEBYTES));
+    }
+
+    function cipherTextAt(batch, i) {
+        return batch.cipherText.slice(batch.offsets[i], batch.offsets[i + 1]);
+    }
+
+    it('should match crypto_box_afternm without its leading zeros', function(done) {
+        var batch = sodium.crypto_box_afternm_batch(messages, nonces, k);
+        batch.offsets.should.have.length(count + 1);
+        for (var i = 0; i < count; i++) {
+            var single = sodium.crypto_box_afternm(messages[i], nonces[i], k);
+            cipherTextAt(batch, i).toString('hex').should.eql(single.slice(sodium.crypto_box_BOXZEROBYTES).toString('hex'));
+        }
+        done();
+    });
+
+    it('should increment a starting nonce', function(done) {
+        var start = new Buffer(sodium.crypto_box_NONCEBYTES);
+        start.fill(0);
+        start[0] = 0xfe;
+        var batch = sodium.crypto_box_afternm_batch(messages.slice(0, 3), start, k);
+        var expectedNonces = ['fe', 'ff', '0001'].map(function(prefix) {
+            var nonce = new Buffer(sodium.crypto_box_NONCEBYTES);
+            nonce.fill(0);
+            new Buffer(prefix, 'hex').copy(nonce);
+            return nonce;
+        });
+        for (var i = 0; i < 3; i++) {
+            var single = sodium.crypto_box_afternm(messages[i], expectedNonces[i], k);
+            cipherTextAt(batch, i).toString('hex').should.eql(single.slice(sodium.crypto_box_BOXZEROBYTES).toString('hex'));
+        }
+        done();
+    });
+
+    it('crypto_box_open_afternm_batch should open a packed batch', function(done) {
+        var batch = sodium.crypto_box_afternm_batch(messages, Buffer.concat(nonces), k);
+        // Tamper with one cipher text
+        batch.cipherText[batch.offsets[5]] ^= 1;
+        var opened = sodium.crypto_box_open_afternm_batch(batch.cipherText, batch.offsets, nonces, k);
+        opened.results.should.have.length(count);
+        for (var i = 0; i < count; i++) {
+            var message = opened.plainText.slice(opened.offsets[i], opened.offsets[i + 1]);
+            if (i == 5) {
+                opened.results[i].should.eql(0);
+                message.toString('hex').should.eql(new Buffer(messages[i].length).fill(0).toString('hex'));
+            } else {
+                opened.results[i].should.eql(1);
+                message.toString('hex').should.eql(messages[i].toString('hex'));
+            }
+        }
+        done();
+    });
+
+    it('should throw on a bad key or mismatched nonces', function(done) {
+        (function() {
+            sodium.crypto_box_afternm_batch(messages, nonces, new Buffer(2));
+        }).should.throw();
+        (function() {
+            sodium.crypto_box_afternm_batch(messages, nonces.slice(1), k);
+        }).should.throw();
+        done();
+    });
+});
+
+describe('Box afternm', function() {
+    var alice = sodium.crypto_box_keypair();
+    var bob = sodium.crypto_box_keypair();
+    var k = sodium.crypto_box_beforenm(bob.publicKey, alice.secretKey);
+    var n = sodium.randombytes_buf(sodium.crypto_box_NONCEBYTES);
+
+    it('crypto_box_afternm should match crypto_box', function(done) {
+        var message = crypto.randomBytes(1000);
+        sodium.crypto_box_afternm(message, n, k).toString('hex')
+            .should.eql(sodium.crypto_box(message, n, bob.publicKey, alice.secretKey).toString('hex'));
+        done();
+    });
+
+    it('crypto_box_afternm should be zero padded crypto_box_easy', function(done) {
+        var message = crypto.randomBytes(64);
+        var ctxt = sodium.crypto_box_afternm(message, n, k);
+        ctxt.length.should.eql(message.length + sodium.crypto_box_ZEROBYTES);
+        ctxt.slice(0, sodium.crypto_box_BOXZEROBYTES).toString('hex').should.eql(new Buffer(sodium.crypto_box_BOXZEROBYTES).fill(0).toString('hex'));
+        ctxt.slice(sodium.crypto_box_BOXZEROBYTES).toString('hex')
+            .should.eql(sodium.crypto_box_easy(message, n, bob.publicKey, alice.secretKey).toString('hex'));
+        done();
+    });
+
+    it('crypto_box_open_afternm should decrypt', function(done) {
+        var message = crypto.randomBytes(1000);
+        var ctxt = sodium.crypto_box_afternm(message, n, k);
+        var k2 = sodium.crypto_box_beforenm(alice.publicKey, bob.secretKey);
+        sodium.crypto_box_open_afternm(ctxt, n, k2).toString('hex').should.eql(message.toString('hex'));
+
+        ctxt[ctxt.length - 1] ^= 1;
+        should.not.exist(sodium.crypto_box_open_afternm(ctxt, n, k2));
+        done();
+    });
+
+    it('crypto_box_open_afternm should throw on a too short cipher text', function(done) {
+        (function() {
+            sodium.crypto_box_open_afternm(new Buffer(sodium.crypto_box_ZEROBYTES - 1).fill(0), n, k);
+        }).should.throw();
+        done();
+    });
+});
+
+describe('Box detached', function() {
+    var alice = sodium.crypto_box_keypair();
+    var bob = sodium.crypto_box_keypair();
+    var n = sodium.randombytes_buf(sodium.crypto_box_NONCEBYTES);
+    var message = crypto.randomBytes(1000);
+
+    it('should split crypto_box_easy output in mac and cipher text', function(done) {
+        var result = sodium.crypto_box_detached(message, n, bob.publicKey, alice.secretKey);
+        result.mac.length.should.eql(sodium.crypto_box_MACBYTES);
+        Buffer.concat([result.mac, result.cipherText]).toString('hex')
+            .should.eql(sodium.crypto_box_easy(message, n, bob.publicKey, alice.secretKey).toString('hex'));
+        done();
+    });
+
+    it('crypto_box_open_detached should verify and decrypt', function(done) {
+        var result = sodium.crypto_box_detached(message, n, bob.publicKey, alice.secretKey);
+        sodium.crypto_box_open_detached(result.cipherText, result.mac, n, alice.publicKey, bob.secretKey).toString('hex')
+            .should.eql(message.toString('hex'));
+        result.cipherText[0] ^= 1;
+        should.not.exist(sodium.crypto_box_open_detached(result.cipherText, result.mac, n, alice.publicKey, bob.secretKey));
+        done();
+    });
+
+    it('afternm forms should match', function(done) {
+        var k = sodium.crypto_box_beforenm(bob.publicKey, alice.secretKey);
+        var result = sodium.crypto_box_detached_afternm(message, n, k);
+        var expected = sodium.crypto_box_detached(message, n, bob.publicKey, alice.secretKey);
+        result.mac.toString('hex').should.eql(expected.mac.toString('hex'));
+        result.cipherText.toString('hex').should.eql(expected.cipherText.toString('hex'));
+        sodium.crypto_box_open_detached_afternm(result.cipherText, result.mac, n, k).toString('hex')
+            .should.eql(message.toString('hex'));
+        done();
+    });
+});
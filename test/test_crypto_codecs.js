@@ -0,0 +1,116 @@
+"use strict";
+
+var should = require('should');
+var crypto = require('crypto');
+var sodium = require('../build/Release/sodium');
+
+// Base64 of buf in the given variant, from Buffer's encoder
+function base64(buf, variant) {
+    var b64 = buf.toString('base64');
+    if (variant == sodium.sodium_base64_VARIANT_URLSAFE || variant == sodium.sodium_base64_VARIANT_URLSAFE_NO_PADDING) {
+        b64 = b64.replace(/\+/g, '-').replace(/\//g, '_');
+    }
+    if (variant == sodium.sodium_base64_VARIANT_ORIGINAL_NO_PADDING || variant == sodium.sodium_base64_VARIANT_URLSAFE_NO_PADDING) {
+        b64 = b64.replace(/=+$/, '');
+    }
+    return b64;
+}
+
+var VARIANTS = [
+    sodium.sodium_base64_VARIANT_ORIGINAL,
+    sodium.sodium_base64_VARIANT_ORIGINAL_NO_PADDING,
+    sodium.sodium_base64_VARIANT_URLSAFE,
+    sodium.sodium_base64_VARIANT_URLSAFE_NO_PADDING
+];
+
+describe('Hex codec', function() {
+    it('should encode and decode like Buffer', function(done) {
+        for (var size = 0; size < 70; size++) {
+            var buf = crypto.randomBytes(size);
+            var hex = buf.toString('hex');
+            sodium.sodium_bin2hex(buf).should.eql(hex);
+            sodium.sodium_hex2bin(hex).toString('hex').should.eql(hex);
+            sodium.sodium_hex2bin(hex.toUpperCase()).toString('hex').should.eql(hex);
+            sodium.sodium_hex2bin(new Buffer(hex)).toString('hex').should.eql(hex);
+        }
+        done();
+    });
+
+    it('should reject invalid hex', function(done) {
+        should.not.exist(sodium.sodium_hex2bin('abc'));
+        should.not.exist(sodium.sodium_hex2bin('0g'));
+        should.not.exist(sodium.sodium_hex2bin('0 '));
+        should.not.exist(sodium.sodium_hex2bin('é0'));
+        done();
+    });
+
+    it('should encode and decode into a buffer', function(done) {
+        var buf = crypto.randomBytes(32);
+        var out = new Buffer(70);
+        out.fill(0xaa);
+        sodium.sodium_bin2hex_into(out, 3, buf).should.eql(64);
+        out.slice(3, 67).toString().should.eql(buf.toString('hex'));
+        out[67].should.eql(0xaa);
+
+        var bin = new Buffer(40);
+        bin.fill(0xaa);
+        sodium.sodium_hex2bin_into(bin, 4, buf.toString('hex')).should.eql(32);
+        bin.slice(4, 36).toString('hex').should.eql(buf.toString('hex'));
+
+        should.not.exist(sodium.sodium_hex2bin_into(bin, 4, buf.toString('hex').replace(/.$/, 'x')));
+        bin.slice(4, 36).toString('hex').should.eql(new Buffer(32).fill(0).toString('hex'));
+
+        (function() {
+            sodium.sodium_bin2hex_into(out, 10, buf);
+        }).should.throw(RangeError);
+        done();
+    });
+});
+
+describe('Base64 codec', function() {
+    it('should encode and decode like Buffer, in every variant', function(done) {
+        VARIANTS.forEach(function(variant) {
+            for (var size = 0; size < 70; size++) {
+                var buf = crypto.randomBytes(size);
+                var b64 = base64(buf, variant);
+                sodium.sodium_bin2base64(buf, variant).should.eql(b64);
+                sodium.sodium_base642bin(b64, variant).toString('hex').should.eql(buf.toString('hex'));
+            }
+        });
+        done();
+    });
+
+    it('should default to the original variant', function(done) {
+        var buf = crypto.randomBytes(40);
+        sodium.sodium_bin2base64(buf).should.eql(buf.toString('base64'));
+        sodium.sodium_base642bin(buf.toString('base64')).toString('hex').should.eql(buf.toString('hex'));
+        done();
+    });
+
+    it('should reject invalid base64', function(done) {
+        should.not.exist(sodium.sodium_base642bin('QQ'));
+        should.not.exist(sodium.sodium_base642bin('QR=='));
+        should.not.exist(sodium.sodium_base642bin('Q@=='));
+        should.not.exist(sodium.sodium_base642bin('QUJD RA=='));
+        should.not.exist(sodium.sodium_base642bin('a-b_'));
+        should.not.exist(sodium.sodium_base642bin('a+b/', sodium.sodium_base64_VARIANT_URLSAFE));
+        should.not.exist(sodium.sodium_base642bin('QQ==', sodium.sodium_base64_VARIANT_ORIGINAL_NO_PADDING));
+        (function() {
+            sodium.sodium_base642bin('QQ==', 2);
+        }).should.throw();
+        done();
+    });
+
+    it('should encode and decode into a buffer', function(done) {
+        var buf = crypto.randomBytes(32);
+        var b64 = buf.toString('base64');
+        var out = new Buffer(50);
+        sodium.sodium_bin2base64_into(out, 2, buf).should.eql(b64.length);
+        out.slice(2, 2 + b64.length).toString().should.eql(b64);
+
+        var bin = new Buffer(40);
+        sodium.sodium_base642bin_into(bin, 8, out.slice(2, 2 + b64.length)).should.eql(32);
+        bin.slice(8).toString('hex').should.eql(buf.toString('hex'));
+        done();
+    });
+});
@@ -21,6 +21,7 @@ describe('Constants', function() {
         sodium.crypto_onetimeauth_KEYBYTES.should.have.type('number').above(0);
         sodium.crypto_secretbox_BOXZEROBYTES.should.have.type('number').above(0);
         sodium.crypto_secretbox_KEYBYTES.should.have.type('number').above(0);
+        sodium.crypto_secretbox_MACBYTES.should.eql(16);
         sodium.crypto_secretbox_NONCEBYTES.should.have.type('number').above(0);
         sodium.crypto_secretbox_ZEROBYTES.should.have.type('number').above(0);
         sodium.crypto_sign_BYTES.should.have.type('number').above(0);
@@ -83,4 +83,101 @@ describe('crypto_hash_sha256 verify parameters', function() {
         });
         done();
     });
-});
\ No newline at end of file
+});
+describe('Result slab', function() {
+    var message = new Buffer('This is a test');
+
+    var key = sodium.randombytes_buf(sodium.crypto_onetimeauth_KEYBYTES);
+
+    it('should carve small results out of a shared slab', function(done) {
+        sodium.sodium_result_slab(true);
+        var before = sodium.sodium_result_slab();
+        var tag1 = sodium.crypto_onetimeauth(message, key);
+        var tag2 = sodium.crypto_onetimeauth(message, key);
+        sodium.sodium_result_slab().results.should.eql(before.results + 2);
+
+        tag1.toString('hex').should.eql(tag2.toString('hex'));
+        tag1.length.should.eql(sodium.crypto_onetimeauth_BYTES);
+        tag1.buffer.byteLength.should.be.above(tag1.length);
+        done();
+    });
+
+    it('should not use the slab for secrets', function(done) {
+        var keys = sodium.crypto_box_keypair();
+        keys.secretKey.buffer.byteLength.should.eql(keys.secretKey.length);
+        done();
+    });
+
+    it('should not use the slab for hashes, which may be keys', function(done) {
+        sodium.sodium_result_slab(true);
+        [sodium.crypto_hash(message), sodium.crypto_hash_sha256(message), sodium.crypto_hash_sha512(message),
+            sodium.crypto_auth(message, sodium.randombytes_buf(sodium.crypto_auth_KEYBYTES))].forEach(function(hash) {
+            hash.buffer.byteLength.should.eql(hash.length);
+        });
+        done();
+    });
+
+    it('should be possible to turn off', function(done) {
+        sodium.sodium_result_slab(false).enabled.should.eql(false);
+        var tag = sodium.crypto_onetimeauth(message, key);
+        tag.buffer.byteLength.should.eql(tag.length);
+        sodium.sodium_result_slab(true).enabled.should.eql(true);
+        done();
+    });
+});
+
+describe('Hash state', function() {
+    var message = crypto.randomBytes(1000);
+
+    it('should hash incrementally, as crypto_hash_sha256 and crypto_hash_sha512', function(done) {
+        var sha256 = new sodium.HashState('sha256');
+        var sha512 = new sodium.HashState();
+        for (var i = 0; i < message.length; i += 77) {
+            sha256.update(message.slice(i, i + 77));
+            sha512.update(message.slice(i, i + 77));
+        }
+        sha256.final().toString('hex').should.eql(sodium.crypto_hash_sha256(message).toString('hex'));
+        sha512.final().toString('hex').should.eql(sodium.crypto_hash_sha512(message).toString('hex'));
+        done();
+    });
+
+    it('should accept typed arrays and ArrayBuffers', function(done) {
+        var state = new sodium.HashState('sha256');
+        state.update(new Uint8Array(message.slice(0, 500)));
+        state.update(new Uint8Array(message.slice(500)).buffer);
+        state.final().toString('hex').should.eql(sodium.crypto_hash_sha256(message).toString('hex'));
+        done();
+    });
+
+    it('should throw once finalized', function(done) {
+        var state = new sodium.HashState('sha256').update(message);
+        state.final();
+        (function() {
+            state.update(message);
+        }).should.throw();
+        (function() {
+            state.final();
+        }).should.throw();
+        done();
+    });
+
+    it('should reject unknown algorithms', function(done) {
+        (function() {
+            new sodium.HashState('md5');
+        }).should.throw();
+        done();
+    });
+
+    it('should hash a stream', function(done) {
+        var HashStream = require('../lib/hash-stream');
+        var stream = new HashStream('sha512');
+        stream.on('data', function(digest) {
+            digest.toString('hex').should.eql(sodium.crypto_hash_sha512(message).toString('hex'));
+            stream.digest.toString('hex').should.eql(digest.toString('hex'));
+            done();
+        });
+        stream.write(message.slice(0, 300));
+        stream.write(message.slice(300));
+        stream.end();
+    });
+});
@@ -0,0 +1,68 @@
+"use strict";
+
+var should = require('should');
+var crypto = require('crypto');
+var sodium = require('../build/Release/sodium');
+
+describe('In place bindings', function() {
+    var message = crypto.randomBytes(1000);
+
+    it('crypto_stream_xor_inplace should match crypto_stream_xor', function(done) {
+        var key = sodium.randombytes_buf(sodium.crypto_stream_KEYBYTES);
+        var nonce = sodium.randombytes_buf(sodium.crypto_stream_NONCEBYTES);
+        var buffer = new Buffer(message);
+        sodium.crypto_stream_xor_inplace(buffer, nonce, key).should.eql(message.length);
+        buffer.toString('hex').should.eql(sodium.crypto_stream_xor(message, nonce, key).toString('hex'));
+        sodium.crypto_stream_xor_inplace(buffer, nonce, key);
+        buffer.toString('hex').should.eql(message.toString('hex'));
+        done();
+    });
+
+    it('crypto_secretbox_easy_inplace and crypto_secretbox_open_easy_inplace', function(done) {
+        var key = sodium.randombytes_buf(sodium.crypto_secretbox_KEYBYTES);
+        var nonce = sodium.randombytes_buf(sodium.crypto_secretbox_NONCEBYTES);
+        var buffer = new Buffer(message.length + sodium.crypto_secretbox_MACBYTES);
+        buffer.length.should.eql(message.length + 16);
+        message.copy(buffer);
+
+        var cipherLength = sodium.crypto_secretbox_easy_inplace(buffer, message.length, nonce, key);
+        cipherLength.should.eql(buffer.length);
+        buffer.toString('hex').should.eql(sodium.crypto_secretbox_easy(message, nonce, key).toString('hex'));
+
+        var messageLength = sodium.crypto_secretbox_open_easy_inplace(buffer, nonce, key);
+        messageLength.should.eql(message.length);
+        buffer.slice(0, messageLength).toString('hex').should.eql(message.toString('hex'));
+        done();
+    });
+
+    it('crypto_secretbox_open_easy_inplace should leave buffer untouched on failure', function(done) {
+        var key = sodium.randombytes_buf(sodium.crypto_secretbox_KEYBYTES);
+        var nonce = sodium.randombytes_buf(sodium.crypto_secretbox_NONCEBYTES);
+        var cipherText = sodium.crypto_secretbox_easy(message, nonce, key);
+        // Cipher text followed by unrelated data
+        var buffer = Buffer.concat([cipherText, new Buffer(10).fill(1)]);
+        buffer[20] ^= 1;
+        var before = buffer.toString('hex');
+        should.not.exist(sodium.crypto_secretbox_open_easy_inplace(buffer, nonce, key, cipherText.length));
+        buffer.toString('hex').should.eql(before);
+
+        buffer[20] ^= 1;
+        sodium.crypto_secretbox_open_easy_inplace(buffer, nonce, key, cipherText.length).should.eql(message.length);
+        done();
+    });
+
+    it('crypto_secretbox_easy_inplace should throw without room for the MAC', function(done) {
+        var key = sodium.randombytes_buf(sodium.crypto_secretbox_KEYBYTES);
+        var nonce = sodium.randombytes_buf(sodium.crypto_secretbox_NONCEBYTES);
+        (function() {
+            sodium.crypto_secretbox_easy_inplace(new Buffer(message), message.length, nonce, key);
+        }).should.throw(RangeError);
+        // One byte short
+        var buffer = new Buffer(message.length + sodium.crypto_secretbox_MACBYTES - 1);
+        message.copy(buffer);
+        (function() {
+            sodium.crypto_secretbox_easy_inplace(buffer, message.length, nonce, key);
+        }).should.throw(RangeError);
+        done();
+    });
+});
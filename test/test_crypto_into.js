@@ -0,0 +1,99 @@
+"use strict";
+
+var should = require('should');
+var crypto = require('crypto');
+var sodium = require('../build/Release/sodium');
+
+// Output buffer with a guard byte around the written region
+function outputBuffer(size, offset) {
+    var out = new Buffer(size + offset + 1);
+    out.fill(0xaa);
+    return out;
+}
+
+function checkWritten(out, offset, written, expected) {
+    written.should.eql(expected.length);
+    out.slice(offset, offset + written).toString('hex').should.eql(expected.toString('hex'));
+    out[offset - 1].should.eql(0xaa);
+    out[offset + written].should.eql(0xaa);
+}
+
+describe('Output buffer (_into) bindings', function() {
+    var message = crypto.randomBytes(100);
+    var offset = 7;
+
+    it('crypto_secretbox_easy_into and crypto_secretbox_open_easy_into', function(done) {
+        var key = sodium.randombytes_buf(sodium.crypto_secretbox_KEYBYTES);
+        var nonce = sodium.randombytes_buf(sodium.crypto_secretbox_NONCEBYTES);
+        var expected = sodium.crypto_secretbox_easy(message, nonce, key);
+
+        var out = outputBuffer(expected.length, offset);
+        var written = sodium.crypto_secretbox_easy_into(out, offset, message, nonce, key);
+        checkWritten(out, offset, written, expected);
+
+        var plain = outputBuffer(message.length, offset);
+        written = sodium.crypto_secretbox_open_easy_into(plain, offset, expected, nonce, key);
+        checkWritten(plain, offset, written, message);
+
+        expected[0] ^= 1;
+        should.not.exist(sodium.crypto_secretbox_open_easy_into(plain, offset, expected, nonce, key));
+        done();
+    });
+
+    it('crypto_box_easy_into and crypto_box_open_easy_into', function(done) {
+        var alice = sodium.crypto_box_keypair();
+        var bob = sodium.crypto_box_keypair();
+        var nonce = sodium.randombytes_buf(sodium.crypto_box_NONCEBYTES);
+        var expected = sodium.crypto_box_easy(message, nonce, bob.publicKey, alice.secretKey);
+
+        var out = outputBuffer(expected.length, offset);
+        var written = sodium.crypto_box_easy_into(out, offset, message, nonce, bob.publicKey, alice.secretKey);
+        checkWritten(out, offset, written, expected);
+
+        var plain = outputBuffer(message.length, offset);
+        written = sodium.crypto_box_open_easy_into(plain, offset, expected, nonce, alice.publicKey, bob.secretKey);
+        checkWritten(plain, offset, written, message);
+        done();
+    });
+
+    it('crypto_stream_xor_into', function(done) {
+        var key = sodium.randombytes_buf(sodium.crypto_stream_KEYBYTES);
+        var nonce = sodium.randombytes_buf(sodium.crypto_stream_NONCEBYTES);
+        var expected = sodium.crypto_stream_xor(message, nonce, key);
+        var out = outputBuffer(expected.length, offset);
+        checkWritten(out, offset, sodium.crypto_stream_xor_into(out, offset, message, nonce, key), expected);
+        done();
+    });
+
+    it('crypto_hash_into, crypto_hash_sha256_into and crypto_hash_sha512_into', function(done) {
+        var out = outputBuffer(64, offset);
+        checkWritten(out, offset, sodium.crypto_hash_into(out, offset, message), sodium.crypto_hash(message));
+        out = outputBuffer(32, offset);
+        checkWritten(out, offset, sodium.crypto_hash_sha256_into(out, offset, message), sodium.crypto_hash_sha256(message));
+        out = outputBuffer(64, offset);
+        checkWritten(out, offset, sodium.crypto_hash_sha512_into(out, offset, message), sodium.crypto_hash_sha512(message));
+        done();
+    });
+
+    it('crypto_sign_detached_into', function(done) {
+        var keys = sodium.crypto_sign_keypair();
+        var out = outputBuffer(sodium.crypto_sign_BYTES, offset);
+        checkWritten(out, offset, sodium.crypto_sign_detached_into(out, offset, message, keys.secretKey),
+            sodium.crypto_sign_detached(message, keys.secretKey));
+        done();
+    });
+
+    it('should throw when the output does not fit', function(done) {
+        var out = new Buffer(70);
+        (function() {
+            sodium.crypto_hash_into(out, 7, message);
+        }).should.throw();
+        (function() {
+            sodium.crypto_hash_into(out, 100, message);
+        }).should.throw();
+        (function() {
+            sodium.crypto_hash_into(out, -1, message);
+        }).should.throw();
+        done();
+    });
+});
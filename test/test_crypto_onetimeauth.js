@@ -132,3 +132,42 @@ describe('crypto_onetimeauth_verify verify parameters', function() {
         done();
     });
 });
+
+describe('OneTimeAuth state', function() {
+    var key = crypto.randomBytes(sodium.crypto_onetimeauth_KEYBYTES);
+    var message = crypto.randomBytes(1000);
+
+    it('should authenticate incrementally, as crypto_onetimeauth', function(done) {
+        var state = new sodium.OnetimeAuthState(key);
+        // Pieces that are not multiples of the Poly1305 block size
+        for (var i = 0; i < message.length; i += 7) {
+            state.update(message.slice(i, i + 7));
+        }
+        state.final().toString('hex').should.eql(sodium.crypto_onetimeauth(message, key).toString('hex'));
+        done();
+    });
+
+    it('should verify tags', function(done) {
+        var tag = sodium.crypto_onetimeauth(message, key);
+        new sodium.OnetimeAuthState(key).update(message).verify(tag).should.eql(true);
+        tag[15] ^= 1;
+        new sodium.OnetimeAuthState(key).update(message).verify(tag).should.eql(false);
+        done();
+    });
+
+    it('should accept ArrayBuffers', function(done) {
+        var tag = sodium.crypto_onetimeauth(message, key);
+        var state = new sodium.OnetimeAuthState(new Uint8Array(key).buffer);
+        state.update(new Uint8Array(message).buffer).verify(new Uint8Array(tag).buffer).should.eql(true);
+        done();
+    });
+
+    it('should throw once finalized', function(done) {
+        var state = new sodium.OnetimeAuthState(key).update(message);
+        state.verify(sodium.crypto_onetimeauth(message, key));
+        (function() {
+            state.final();
+        }).should.throw();
+        done();
+    });
+});
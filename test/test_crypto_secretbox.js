@@ -253,3 +253,234 @@ describe("crypto_secretbox_open verify parameters", function () {
         done();
     });
 });
+
+describe('Secretbox detached', function() {
+    var key = sodium.randombytes_buf(sodium.crypto_secretbox_KEYBYTES);
+    var nonce = sodium.randombytes_buf(sodium.crypto_secretbox_NONCEBYTES);
+    var message = crypto.randomBytes(1000);
+
+    it('should split crypto_secretbox_easy output in mac and cipher text', function(done) {
+        var result = sodium.crypto_secretbox_detached(message, nonce, key);
+        result.mac.length.should.eql(sodium.crypto_secretbox_MACBYTES);
+        result.cipherText.length.should.eql(message.length);
+        Buffer.concat([result.mac, result.cipherText]).toString('hex')
+            .should.eql(sodium.crypto_secretbox_easy(message, nonce, key).toString('hex'));
+        done();
+    });
+
+    it('crypto_secretbox_open_detached should verify and decrypt', function(done) {
+        var result = sodium.crypto_secretbox_detached(message, nonce, key);
+        sodium.crypto_secretbox_open_detached(result.cipherText, result.mac, nonce, key).toString('hex')
+            .should.eql(message.toString('hex'));
+        result.mac[0] ^= 1;
+        should.not.exist(sodium.crypto_secretbox_open_detached(result.cipherText, result.mac, nonce, key));
+        done();
+    });
+});
+
+describe('Secretbox iov', function() {
+    var key = sodium.randombytes_buf(sodium.crypto_secretbox_KEYBYTES);
+    var nonce = sodium.randombytes_buf(sodium.crypto_secretbox_NONCEBYTES);
+
+    // Splits buffer at the given offsets
+    function split(buffer, cuts) {
+        var fragments = [], previous = 0;
+        cuts.concat([buffer.length]).forEach(function(cut) {
+            fragments.push(buffer.slice(previous, cut));
+            previous = cut;
+        });
+        return fragments;
+    }
+
+    it('crypto_secretbox_easy_iov should match crypto_secretbox_easy of the concatenation', function(done) {
+        var message = crypto.randomBytes(1000);
+        // Cuts within the first block, on and around block boundaries, and an empty fragment
+        [[], [1], [5, 31, 32, 33], [64, 64, 100], [63, 127, 128, 129, 999]].forEach(function(cuts) {
+            sodium.crypto_secretbox_easy_iov(split(message, cuts), nonce, key).toString('hex')
+                .should.eql(sodium.crypto_secretbox_easy(message, nonce, key).toString('hex'));
+        });
+        done();
+    });
+
+    it('crypto_secretbox_open_easy_iov should verify across fragments', function(done) {
+        var message = crypto.randomBytes(300);
+        var cipherText = sodium.crypto_secretbox_easy(message, nonce, key);
+        // The first cut splits the MAC
+        var fragments = split(cipherText, [3, 16, 40, 200]);
+        sodium.crypto_secretbox_open_easy_iov(fragments, nonce, key).toString('hex').should.eql(message.toString('hex'));
+
+        fragments[3][0] ^= 1;
+        should.not.exist(sodium.crypto_secretbox_open_easy_iov(fragments, nonce, key));
+        done();
+    });
+
+    it('should throw on bad fragments', function(done) {
+        (function() {
+            sodium.crypto_secretbox_easy_iov(["abc"], nonce, key);
+        }).should.throw();
+        (function() {
+            sodium.crypto_secretbox_open_easy_iov([new Buffer(10)], nonce, key);
+        }).should.throw();
+        done();
+    });
+});
+
+describe('Secretbox stream', function() {
+    var key = sodium.randombytes_buf(sodium.crypto_secretbox_KEYBYTES);
+    var HEADERBYTES = sodium.SecretboxStream.HEADERBYTES;
+
+    // Feeds buffer to a SecretboxStream in pieces of pieceSize bytes
+    function run(state, buffer, pieceSize) {
+        var out = [];
+        for (var i = 0; i < buffer.length; i += pieceSize) {
+            out.push(state.update(buffer.slice(i, i + pieceSize)));
+        }
+        out.push(state.final());
+        return Buffer.concat(out);
+    }
+
+    function encrypt(message, chunkSize, pieceSize) {
+        return run(new sodium.SecretboxStream('encrypt', key, chunkSize), message, pieceSize || 1000);
+    }
+
+    function decrypt(cipherText, pieceSize) {
+        return run(new sodium.SecretboxStream('decrypt', key), cipherText, pieceSize || 1000);
+    }
+
+    it('should round trip, whatever the chunk size and the pieces', function(done) {
+        [0, 1, 99, 100, 101, 5000].forEach(function(size) {
+            var message = crypto.randomBytes(size);
+            [1, 7, 100].forEach(function(chunkSize) {
+                [1, 13, 100, 6000].forEach(function(pieceSize) {
+                    var cipherText = encrypt(message, chunkSize, pieceSize);
+                    // Whole chunks, and a short last one
+                    cipherText.length.should.eql(HEADERBYTES + message.length +
+                        (Math.floor(message.length / chunkSize) + 1) * sodium.crypto_secretbox_MACBYTES);
+                    decrypt(cipherText, pieceSize).toString('hex').should.eql(message.toString('hex'));
+                });
+            });
+        });
+        done();
+    });
+
+    it('should use a new nonce for every stream', function(done) {
+        var message = crypto.randomBytes(50);
+        encrypt(message, 10).toString('hex').should.not.eql(encrypt(message, 10).toString('hex'));
+        done();
+    });
+
+    it('should accept typed arrays and ArrayBuffers', function(done) {
+        var message = crypto.randomBytes(250);
+        var state = new sodium.SecretboxStream('encrypt', new Uint8Array(key).buffer, 100);
+        var cipherText = Buffer.concat([
+            state.update(new Uint8Array(message.slice(0, 120))),
+            state.update(new Uint8Array(message.slice(120)).buffer),
+            state.final()
+        ]);
+        decrypt(cipherText).toString('hex').should.eql(message.toString('hex'));
+        done();
+    });
+
+    it('should detect modified, reordered and truncated streams', function(done) {
+        var message = crypto.randomBytes(250);
+        var cipherText = encrypt(message, 100);
+        var chunk = 100 + sodium.crypto_secretbox_MACBYTES;
+        var first = cipherText.slice(HEADERBYTES, HEADERBYTES + chunk);
+        var second = cipherText.slice(HEADERBYTES + chunk, HEADERBYTES + 2 * chunk);
+        var header = cipherText.slice(0, HEADERBYTES);
+        var last = cipherText.slice(HEADERBYTES + 2 * chunk);
+        // Two whole chunks and the last one, which decrypt when put back in order
+        first.length.should.eql(chunk);
+        second.length.should.eql(chunk);
+        last.length.should.eql(50 + sodium.crypto_secretbox_MACBYTES);
+        first.toString('hex').should.not.eql(second.toString('hex'));
+        decrypt(Buffer.concat([header, first, second, last])).toString('hex').should.eql(message.toString('hex'));
+
+        var modified = new Buffer(cipherText);
+        modified[HEADERBYTES + chunk + 5] ^= 1;
+        var modifiedHeader = new Buffer(cipherText);
+        modifiedHeader[0] ^= 1;
+
+        [
+            modified,
+            modifiedHeader,
+            Buffer.concat([header, second, first, last]),
+            Buffer.concat([header, first, first, second, last]),
+            // Truncated on a chunk boundary, and within the last chunk
+            Buffer.concat([header, first, second]),
+            cipherText.slice(0, cipherText.length - 1),
+            cipherText.slice(0, HEADERBYTES - 1),
+            // Data after the last chunk
+            Buffer.concat([cipherText, new Buffer(20)])
+        ].forEach(function(bad) {
+            (function() {
+                decrypt(bad);
+            }).should.throw();
+        });
+        done();
+    });
+
+    it('should refuse to go on after an error or final()', function(done) {
+        var state = new sodium.SecretboxStream('encrypt', key, 10);
+        state.final();
+        (function() {
+            state.update(new Buffer(1));
+        }).should.throw();
+
+        var badHeader = new Buffer(HEADERBYTES).fill(0xff);
+        state = new sodium.SecretboxStream('decrypt', key);
+        (function() {
+            state.update(badHeader);
+        }).should.throw();
+        (function() {
+            state.final();
+        }).should.throw();
+        done();
+    });
+
+    it('should check its arguments', function(done) {
+        (function() {
+            new sodium.SecretboxStream('compress', key);
+        }).should.throw();
+        (function() {
+            new sodium.SecretboxStream('encrypt', new Buffer(10));
+        }).should.throw();
+        (function() {
+            new sodium.SecretboxStream('encrypt', key, 0);
+        }).should.throw();
+        (function() {
+            new sodium.SecretboxStream('encrypt', key, sodium.SecretboxStream.MAX_CHUNKSIZE + 1);
+        }).should.throw();
+        done();
+    });
+
+    it('should encrypt and decrypt through Transform streams', function(done) {
+        var SecretBoxStream = require('../lib/secretbox-stream');
+        var message = crypto.randomBytes(200000);
+        var encryptor = new SecretBoxStream.SecretBoxEncryptStream(key, { chunkSize: 16384 });
+        var decryptor = new SecretBoxStream.SecretBoxDecryptStream(key);
+        var out = [];
+        encryptor.pipe(decryptor);
+        decryptor.on('data', function(data) {
+            out.push(data);
+        });
+        decryptor.on('end', function() {
+            Buffer.concat(out).toString('hex').should.eql(message.toString('hex'));
+            done();
+        });
+        encryptor.write(message.slice(0, 70000));
+        encryptor.write(message.slice(70000));
+        encryptor.end();
+    });
+
+    it('should emit an error on a truncated stream', function(done) {
+        var SecretBoxStream = require('../lib/secretbox-stream');
+        var decryptor = new SecretBoxStream.SecretBoxDecryptStream(key);
+        decryptor.on('error', function(err) {
+            err.should.be.an.instanceOf(Error);
+            done();
+        });
+        decryptor.resume();
+        decryptor.end(encrypt(crypto.randomBytes(300), 100).slice(0, HEADERBYTES + 116));
+    });
+});
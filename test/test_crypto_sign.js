@@ -104,3 +104,122 @@ describe('Sign', function() {
         done();
     });
 });
+
+describe('Sign verify batch', function() {
+    this.timeout(20000);
+
+    var count = 200;
+    var keys = sodium.crypto_sign_keypair();
+    var otherKeys = sodium.crypto_sign_keypair();
+    var messages = [], signatures = [], publicKeys = [];
+    for (var i = 0; i < count; i++) {
+        var message = crypto.randomBytes(1 + i % 50);
+        messages.push(message);
+        // Sign a few with another key, so that they don't verify
+        var signer = i % 7 == 3 ? otherKeys : keys;
+        signatures.push(sodium.crypto_sign_detached(message, signer.secretKey));
+        publicKeys.push(keys.publicKey);
+    }
+
+    function expected() {
+        var results = [];
+        for (var i = 0; i < count; i++) {
+            results.push(sodium.crypto_sign_verify_detached(signatures[i], messages[i], publicKeys[i]) ? 1 : 0);
+        }
+        return results;
+    }
+
+    it('should match crypto_sign_verify_detached item by item', function(done) {
+        var results = sodium.crypto_sign_verify_detached_batch(signatures, messages, publicKeys);
+        results.should.have.length(count);
+        Array.prototype.slice.call(results).should.eql(expected());
+        done();
+    });
+
+    it('should accept packed signatures, messages and a single public key', function(done) {
+        var offsets = new Uint32Array(count + 1);
+        for (var i = 0; i < count; i++) {
+            offsets[i + 1] = offsets[i] + messages[i].length;
+        }
+        var results = sodium.crypto_sign_verify_detached_batch(Buffer.concat(signatures), Buffer.concat(messages), offsets, keys.publicKey);
+        Array.prototype.slice.call(results).should.eql(expected());
+        done();
+    });
+
+    it('should verify on the worker pool when given a callback', function(done) {
+        var returned = false;
+        sodium.crypto_sign_verify_detached_batch(signatures, messages, Buffer.concat(publicKeys), function(err, results) {
+            should.not.exist(err);
+            returned.should.be.ok;
+            Array.prototype.slice.call(results).should.eql(expected());
+            done();
+        });
+        returned = true;
+    });
+
+    it('should accept an empty batch', function(done) {
+        sodium.crypto_sign_verify_detached_batch([], [], []).should.have.length(0);
+        done();
+    });
+
+    it('should throw on mismatched lengths', function(done) {
+        (function() {
+            sodium.crypto_sign_verify_detached_batch(signatures, messages.slice(1), publicKeys);
+        }).should.throw();
+        (function() {
+            sodium.crypto_sign_verify_detached_batch(Buffer.concat(signatures).slice(1), messages, publicKeys);
+        }).should.throw();
+        done();
+    });
+});
+
+describe('Sign batch', function() {
+    this.timeout(20000);
+
+    var count = 150;
+    var keys = sodium.crypto_sign_keypair();
+    var messages = [];
+    for (var i = 0; i < count; i++) {
+        messages.push(crypto.randomBytes(1 + i % 40));
+    }
+
+    function checkSignatures(signatures) {
+        signatures.should.have.length(count * sodium.crypto_sign_BYTES);
+        for (var i = 0; i < count; i++) {
+            var signature = signatures.slice(i * sodium.crypto_sign_BYTES, (i + 1) * sodium.crypto_sign_BYTES);
+            // Ed25519 signatures are deterministic
+            signature.toString('hex').should.eql(sodium.crypto_sign_detached(messages[i], keys.secretKey).toString('hex'));
+        }
+    }
+
+    it('should match crypto_sign_detached item by item', function(done) {
+        checkSignatures(sodium.crypto_sign_detached_batch(messages, keys.secretKey));
+        done();
+    });
+
+    it('should accept packed messages with offsets', function(done) {
+        var offsets = [0];
+        for (var i = 0; i < count; i++) {
+            offsets.push(offsets[i] + messages[i].length);
+        }
+        checkSignatures(sodium.crypto_sign_detached_batch(Buffer.concat(messages), offsets, keys.secretKey));
+        done();
+    });
+
+    it('should sign on the worker pool when given a callback', function(done) {
+        sodium.crypto_sign_detached_batch(messages, keys.secretKey, function(err, signatures) {
+            should.not.exist(err);
+            checkSignatures(signatures);
+            var results = sodium.crypto_sign_verify_detached_batch(signatures, messages, keys.publicKey);
+            Array.prototype.every.call(results, function(r) { return r === 1; }).should.be.ok;
+            done();
+        });
+    });
+
+    it('should throw on a bad secret key', function(done) {
+        (function() {
+            sodium.crypto_sign_detached_batch(messages, keys.publicKey);
+        }).should.throw();
+        done();
+    });
+});
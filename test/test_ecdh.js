@@ -39,4 +39,18 @@ describe("ECDH", function () {
         bobSecret.should.eql(aliceSecret);
         done();
     });
-});
\ No newline at end of file
+
+    it("should give the session key a backing store of its own", function (done) {
+        var bob = new DHKey();
+        var alice = new DHKey();
+        var aliceDH = new ECDH(bob.pk().get(), alice.sk().get());
+
+        // Small non secret results around it come out of the shared result slab
+        sodium.crypto_onetimeauth(new Buffer('before'), sodium.randombytes_buf(sodium.crypto_onetimeauth_KEYBYTES));
+        var sessionKey = aliceDH.sessionKey();
+        sodium.crypto_onetimeauth(new Buffer('after'), sodium.randombytes_buf(sodium.crypto_onetimeauth_KEYBYTES));
+
+        sessionKey.buffer.byteLength.should.eql(sessionKey.length);
+        done();
+    });
+});
@@ -25,3 +25,229 @@ binding.encrypt_file(randData, password, testFileName);
 plaintext = binding.decrypt_file(testFileName, password);
 
 assert(plaintext.toString('hex') == randData.toString('hex'), 'Error through encryption/decryption process. Low level API');
+
+describe('FileEncrypt async', function(){
+	this.timeout(30000);
+
+	it('encrypts and decrypts on a worker thread, with callbacks', function(done){
+		var content = new Buffer(4096), pass = new Buffer(16);
+		sodium.Random.buffer(content);
+		sodium.Random.buffer(pass);
+
+		sodium.FileEncrypt.encryptFile(content, pass, testFileName, function(err){
+			assert.ifError(err);
+			sodium.FileEncrypt.decryptFile(testFileName, pass, function(err, plaintext){
+				assert.ifError(err);
+				assert.equal(plaintext.toString('hex'), content.toString('hex'));
+				done();
+			});
+		});
+	});
+
+	it('returns Promises from the *Async variants', function(done){
+		if (typeof Promise !== 'function') return done();
+		var content = new Buffer(1024), pass = new Buffer(16);
+		sodium.Random.buffer(content);
+		sodium.Random.buffer(pass);
+
+		sodium.FileEncrypt.encryptFileAsync(content, pass, testFileName).then(function(){
+			return sodium.FileEncrypt.decryptFileAsync(testFileName, pass);
+		}).then(function(plaintext){
+			assert.equal(plaintext.toString('hex'), content.toString('hex'));
+			done();
+		}).catch(done);
+	});
+
+	it('passes decryption errors to the callback', function(done){
+		var content = new Buffer(64), pass = new Buffer(16);
+		sodium.Random.buffer(content);
+		sodium.Random.buffer(pass);
+
+		binding.encrypt_file(content, pass, testFileName, function(err){
+			assert.ifError(err);
+			binding.decrypt_file(testFileName, new Buffer('wrong password'), function(err, plaintext){
+				assert.ok(err instanceof Error);
+				assert.equal(typeof plaintext, 'undefined');
+				done();
+			});
+		});
+	});
+
+	it('builds the missing folders and reports missing files on the worker thread', function(done){
+		var fs = require('fs');
+		var nestedFileName = 'test.enc.dir/sub/test.enc';
+		var content = new Buffer(64), pass = new Buffer(16);
+		sodium.Random.buffer(content);
+		sodium.Random.buffer(pass);
+
+		sodium.FileEncrypt.encryptFile(content, pass, nestedFileName, function(err){
+			assert.ifError(err);
+			sodium.FileEncrypt.decryptFile(nestedFileName, pass, function(err, plaintext){
+				assert.ifError(err);
+				assert.equal(plaintext.toString('hex'), content.toString('hex'));
+				fs.unlinkSync(nestedFileName);
+				fs.rmdirSync('test.enc.dir/sub');
+				fs.rmdirSync('test.enc.dir');
+
+				sodium.FileEncrypt.decryptFile('test.enc.missing', pass, function(err){
+					assert.ok(err instanceof Error);
+					assert.equal(err.message, 'file cannot be found');
+					done();
+				});
+			});
+		});
+	});
+});
+
+describe('FileEncrypt streaming', function(){
+	this.timeout(30000);
+
+	var fs = require('fs');
+	var plainFileName = 'test.stream.txt', encryptedFileName = 'test.stream.enc', decryptedFileName = 'test.stream.out';
+
+	after(function(){
+		[plainFileName, encryptedFileName, decryptedFileName].forEach(function(name){
+			if (fs.existsSync(name)) fs.unlinkSync(name);
+		});
+	});
+
+	it('encrypts and decrypts files of any size, around the chunk and block boundaries', function(done){
+		var pass = new Buffer(16);
+		sodium.Random.buffer(pass);
+		[0, 1, 65535, 65536, 65537, 1048577, 3000000].forEach(function(size){
+			var content = new Buffer(size);
+			sodium.Random.buffer(content);
+			fs.writeFileSync(plainFileName, content);
+
+			binding.encrypt_file_stream(plainFileName, encryptedFileName, pass);
+			binding.decrypt_file_stream(encryptedFileName, decryptedFileName, pass);
+			assert.equal(fs.readFileSync(decryptedFileName).toString('hex'), content.toString('hex'));
+		});
+		done();
+	});
+
+	it('accepts file descriptors', function(done){
+		var content = new Buffer(100000), pass = new Buffer('password');
+		sodium.Random.buffer(content);
+		fs.writeFileSync(plainFileName, content);
+
+		var input = fs.openSync(plainFileName, 'r'), output = fs.openSync(encryptedFileName, 'w');
+		sodium.FileEncrypt.encryptFileStream(input, output, pass);
+		fs.closeSync(input);
+		fs.closeSync(output);
+
+		sodium.FileEncrypt.decryptFileStream(encryptedFileName, decryptedFileName, 'password');
+		assert.equal(fs.readFileSync(decryptedFileName).toString('hex'), content.toString('hex'));
+		done();
+	});
+
+	//Temporary files of the outputs
+	function tempFiles(){
+		return fs.readdirSync('.').filter(function(name){
+			return name.indexOf(decryptedFileName + '.tmp-') == 0 || name.indexOf(encryptedFileName + '.tmp-') == 0;
+		});
+	}
+
+	it('rejects modified and truncated files, and leaves the output untouched', function(done){
+		var content = new Buffer(200000), pass = new Buffer(16);
+		sodium.Random.buffer(content);
+		sodium.Random.buffer(pass);
+		fs.writeFileSync(plainFileName, content);
+		binding.encrypt_file_stream(plainFileName, encryptedFileName, pass);
+		var encrypted = fs.readFileSync(encryptedFileName);
+
+		var modified = new Buffer(encrypted);
+		modified[modified.length - 100] ^= 1;
+		[modified, encrypted.slice(0, encrypted.length - 1), encrypted.slice(0, 20 + 8 + 28 + 65552), Buffer.concat([encrypted, encrypted])].forEach(function(bad){
+			fs.writeFileSync(encryptedFileName, bad);
+			fs.writeFileSync(decryptedFileName, 'previous content');
+			assert.throws(function(){
+				binding.decrypt_file_stream(encryptedFileName, decryptedFileName, pass);
+			}, Error);
+			assert.equal(fs.readFileSync(decryptedFileName).toString(), 'previous content');
+			assert.deepEqual(tempFiles(), []);
+		});
+		//Nor creates it
+		fs.unlinkSync(decryptedFileName);
+		assert.throws(function(){
+			binding.decrypt_file_stream(encryptedFileName, decryptedFileName, pass);
+		}, Error);
+		assert.ok(!fs.existsSync(decryptedFileName));
+
+		fs.writeFileSync(encryptedFileName, encrypted);
+		assert.throws(function(){
+			binding.decrypt_file_stream(encryptedFileName, decryptedFileName, new Buffer('wrong password'));
+		}, Error);
+
+		//Files of encrypt_file aren't in the streaming format
+		binding.encrypt_file(content, pass, encryptedFileName);
+		assert.throws(function(){
+			binding.decrypt_file_stream(encryptedFileName, decryptedFileName, pass);
+		}, TypeError);
+		done();
+	});
+
+	it('builds the missing folders of an output path', function(done){
+		var nestedFileName = 'test.stream.dir/sub/test.stream.enc';
+		var content = new Buffer(1000), pass = new Buffer('password');
+		sodium.Random.buffer(content);
+		fs.writeFileSync(plainFileName, content);
+
+		sodium.FileEncrypt.encryptFileStream(plainFileName, nestedFileName, pass, function(err){
+			assert.ifError(err);
+			binding.decrypt_file_stream(nestedFileName, decryptedFileName, pass);
+			assert.equal(fs.readFileSync(decryptedFileName).toString('hex'), content.toString('hex'));
+			fs.unlinkSync(nestedFileName);
+			fs.rmdirSync('test.stream.dir/sub');
+			fs.rmdirSync('test.stream.dir');
+			done();
+		});
+	});
+
+	it('refuses to write over its input', function(done){
+		var content = new Buffer(100000), pass = new Buffer('password');
+		sodium.Random.buffer(content);
+		fs.writeFileSync(plainFileName, content);
+
+		assert.throws(function(){
+			binding.encrypt_file_stream(plainFileName, plainFileName, pass);
+		}, TypeError);
+		var input = fs.openSync(plainFileName, 'r'), output = fs.openSync(plainFileName, 'r+');
+		assert.throws(function(){
+			binding.encrypt_file_stream(input, output, pass);
+		}, TypeError);
+		fs.closeSync(input);
+		fs.closeSync(output);
+		assert.equal(fs.readFileSync(plainFileName).toString('hex'), content.toString('hex'));
+
+		binding.encrypt_file_stream(plainFileName, encryptedFileName, pass);
+		assert.throws(function(){
+			binding.decrypt_file_stream(encryptedFileName, encryptedFileName, pass);
+		}, TypeError);
+		binding.decrypt_file_stream(encryptedFileName, decryptedFileName, pass);
+		assert.equal(fs.readFileSync(decryptedFileName).toString('hex'), content.toString('hex'));
+		assert.deepEqual(tempFiles(), []);
+		done();
+	});
+
+	it('runs on a worker thread, with callbacks and Promises', function(done){
+		if (typeof Promise !== 'function') return done();
+		var content = new Buffer(300000), pass = new Buffer(16);
+		sodium.Random.buffer(content);
+		sodium.Random.buffer(pass);
+		fs.writeFileSync(plainFileName, content);
+
+		sodium.FileEncrypt.encryptFileStream(plainFileName, encryptedFileName, pass, function(err){
+			assert.ifError(err);
+			sodium.FileEncrypt.decryptFileStreamAsync(encryptedFileName, decryptedFileName, pass).then(function(){
+				assert.equal(fs.readFileSync(decryptedFileName).toString('hex'), content.toString('hex'));
+				return sodium.FileEncrypt.decryptFileStreamAsync(encryptedFileName, decryptedFileName, new Buffer('wrong password'));
+			}).then(function(){
+				done(new Error('decryption with a wrong password should fail'));
+			}, function(err){
+				assert.ok(err instanceof Error);
+				done();
+			}).catch(done);
+		});
+	});
+});
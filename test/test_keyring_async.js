@@ -59,4 +59,31 @@ generateCurve25519KeyPairs(function(){
 	testCurve25519Exchange(function(){
 		generateEd25519KeyPairs(testEd25519Signatures);
 	});
-});
\ No newline at end of file
+});
+//Encrypted key files, saved and loaded on worker threads
+var fs = require('fs');
+var path = require('path');
+var os = require('os');
+
+var encKeyPath = path.join(os.tmpdir(), 'node-sodium-async-' + process.pid + '.key');
+var keyring3 = new sodium.KeyRing();
+var keyring4 = new sodium.KeyRing();
+
+keyring3.createKeyPair('ed25519', encKeyPath, function(pubKey3){
+	assert.ok(!(pubKey3 instanceof Error), 'Error while generating and saving the key pair');
+	var loadReturned = false;
+	keyring4.load(encKeyPath, function(pubKey4){
+		assert.ok(loadReturned, 'load() called back before returning');
+		assert.ok(!(pubKey4 instanceof Error), 'Error while loading the encrypted key file');
+		assert.equal(pubKey4.publicKey, pubKey3.publicKey, 'Loaded public key differs from the saved one');
+		assert.equal(pubKey4.curvePublicKey, pubKey3.curvePublicKey, 'Loaded curve25519 public key differs from the saved one');
+
+		keyring4.load(encKeyPath, function(err){
+			assert.ok(err instanceof Error, 'Loading with a wrong password should pass an error to the callback');
+			fs.unlinkSync(encKeyPath);
+			keyring3.clear();
+			keyring4.clear();
+		}, 'wrong password');
+	}, 'password3');
+	loadReturned = true;
+}, 'password3');
@@ -65,6 +65,14 @@ var testCurve25519 = function(callback){
 	assert.equal(message1, plaintext1.toString(), 'Initial message 1 and decrypted message aren\'t identitcal!');
 	assert.equal(message2, plaintext2.toString(), 'Initial message 2 and decrypted message aren\'t identitcal!');
 
+	//Same exchange, in the easy format : 16 bytes shorter, no leading zeros
+	var easyCipher1 = keyring1.encryptEasy(new Buffer(message1), new Buffer(pubKey2.publicKey, 'hex'), nonce1);
+	assert.equal(easyCipher1.length, cipher1.length - sodium.Const.Box.boxZeroBytes, 'Unexpected easy cipher length');
+	assert.equal(easyCipher1.toString('hex'), cipher1.slice(sodium.Const.Box.boxZeroBytes).toString('hex'), 'Easy cipher and crypto_box cipher don\'t match');
+	var easyPlaintext1 = keyring2.decryptEasy(easyCipher1, new Buffer(pubKey1.publicKey, 'hex'), nonce1);
+	assert.equal(message1, easyPlaintext1.toString(), 'Initial message 1 and easy-decrypted message aren\'t identitcal!');
+	assert.throws(function(){ keyring2.decryptEasy(easyCipher1.slice(0, 15), new Buffer(pubKey1.publicKey, 'hex'), nonce1); }, 'Truncated easy cipher accepted');
+
 	if (callback && typeof callback == 'function') callback();
 };
 //Ed25519 signatures
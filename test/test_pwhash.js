@@ -107,3 +107,88 @@ function testScryptLl(v){
 	var derivedKey = sodium.Pwhash.crypto_pwhash_scryptsalsa208sha256_ll(v.pass, v.salt, v.opsLimit, v.r, v.p, v.keyLength);
 	assert.ok(derivedKey.toString('hex') == v.result, 'Scrypt assertion fail, low level call with vector ' + JSON.stringify(v));
 }
+
+//Testing the asynchronous scrypt functions against the same vectors
+describe('Pwhash async', function(){
+	this.timeout(60000);
+
+	hlVectors.forEach(function(v, i){
+		it('high level async call matches the sync call, vector ' + i, function(done){
+			sodium.Pwhash.crypto_pwhash_scryptsalsa208sha256_async(v.pass, v.salt, v.keyLength, v.opsLimit, v.memLimit, function(err, derivedKey){
+				assert.ifError(err);
+				assert.equal(derivedKey.toString('hex'), v.result);
+				done();
+			});
+		});
+	});
+
+	llVectors.forEach(function(v, i){
+		it('low level async call matches the sync call, vector ' + i, function(done){
+			sodium.Pwhash.crypto_pwhash_scryptsalsa208sha256_ll_async(v.pass, v.salt, v.opsLimit, v.r, v.p, v.keyLength, function(err, derivedKey){
+				assert.ifError(err);
+				assert.equal(derivedKey.toString('hex'), v.result);
+				done();
+			});
+		});
+	});
+
+	it('returns a Promise when no callback is given', function(done){
+		if (typeof Promise !== 'function') return done();
+		var v = hlVectors[0];
+		sodium.Pwhash.crypto_pwhash_scryptsalsa208sha256_async(v.pass, v.salt).then(function(derivedKey){
+			assert.equal(derivedKey.toString('hex'), v.result);
+			done();
+		}, done);
+	});
+
+	it('throws synchronously on invalid parameters', function(){
+		assert.throws(function(){
+			binding.crypto_pwhash_scryptsalsa208sha256_async(new Buffer('password'), new Buffer(2), function(){});
+		});
+		assert.throws(function(){
+			binding.crypto_pwhash_scryptsalsa208sha256_async(new Buffer('password'), hlVectors[0].salt);
+		});
+	});
+});
+
+describe('Crypto worker pool', function(){
+	this.timeout(60000);
+
+	it('exposes its counters', function(){
+		var stats = binding.sodium_pool_stats();
+		assert.ok(stats.threads > 0);
+		assert.equal(typeof stats.queued, 'number');
+		assert.equal(typeof stats.active, 'number');
+		assert.equal(typeof stats.completed, 'number');
+		assert.equal(typeof stats.parallelTasks, 'number');
+	});
+
+	it("doesn't count the ParallelFor tasks as jobs", function(){
+		var before = binding.sodium_pool_stats().completed;
+		//Large enough to be split between the pool threads
+		var stream = new binding.SecretboxStream('encrypt', new Buffer(binding.crypto_secretbox_KEYBYTES).fill(1));
+		stream.update(new Buffer(4 * 1024 * 1024).fill(2));
+		stream.final();
+		assert.equal(binding.sodium_pool_stats().completed, before);
+	});
+
+	it('runs concurrent derivations and counts them', function(done){
+		var before = binding.sodium_pool_stats().completed;
+		var jobs = 8, remaining = jobs;
+		var v = hlVectors[0];
+		for (var i = 0; i < jobs; i++){
+			binding.crypto_pwhash_scryptsalsa208sha256_async(new Buffer(v.pass), v.salt, function(err, derivedKey){
+				assert.ifError(err);
+				assert.equal(derivedKey.toString('hex'), v.result);
+				if (--remaining > 0) return;
+				var stats = binding.sodium_pool_stats();
+				assert.equal(stats.completed - before, jobs);
+				assert.equal(stats.queued, 0);
+				assert.equal(stats.active, 0);
+				done();
+			});
+		}
+		var stats = binding.sodium_pool_stats();
+		assert.equal(stats.queued + stats.active + stats.completed - before, jobs);
+	});
+});
@@ -23,6 +23,46 @@ describe("toBuffer", function () {
         done();
     });
 
+    it("should decode hex and base64 strings", function (done) {
+        var buf = new Buffer([0xfb, 0xff, 0x00, 0x10, 0x7e]);
+        toBuffer(buf.toString('hex'), 'hex').toString('hex').should.eql(buf.toString('hex'));
+        toBuffer(buf.toString('base64'), 'base64').toString('hex').should.eql(buf.toString('hex'));
+        toBuffer('-_8AEH4', 'base64').toString('hex').should.eql(buf.toString('hex'));
+        done();
+    });
+
+    it("should keep accepting the hex and base64 strings Buffer accepts", function (done) {
+        var buf = new Buffer('fbff00107e00112233445566778899aabbccddeeff0123456789abcdef', 'hex');
+        var b64 = buf.toString('base64');
+        [
+            // Wrapped lines, as in PEM files
+            b64.slice(0, 16) + '\n' + b64.slice(16, 32) + '\r\n' + b64.slice(32),
+            ' ' + b64 + ' ',
+            // Padding that doesn't match the length, or missing
+            'QQ=',
+            'QUI',
+            b64.replace(/=+$/, ''),
+            // Both alphabets
+            '+_8AEH4',
+            '-/8AEH4=',
+            // Not base64 at all: decoded as Buffer always did
+            'QR==',
+            'not base64!'
+        ].forEach(function(str) {
+            toBuffer(str, 'base64').toString('hex').should.eql(new Buffer(str, 'base64').toString('hex'));
+        });
+
+        [
+            buf.toString('hex').toUpperCase(),
+            buf.toString('hex').slice(0, 10) + '\n' + buf.toString('hex').slice(10),
+            '0x',
+            'abc'
+        ].forEach(function(str) {
+            toBuffer(str, 'hex').toString('hex').should.eql(new Buffer(str, 'hex').toString('hex'));
+        });
+        done();
+    });
+
     it("should return undefined on bad param 1", function (done) {
         (function() {
             var b = toBuffer(123, 'utf8');
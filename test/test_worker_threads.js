@@ -0,0 +1,100 @@
+"use strict";
+
+var should = require('should');
+var path = require('path');
+
+var workerThreads;
+try {
+    workerThreads = require('worker_threads');
+} catch (e) {
+    // Not available on this version of node
+}
+
+var bindingPath = path.join(__dirname, '..', 'build', 'Release', 'sodium');
+
+// Runs in each worker: sync and async calls, plus a KeyRing, all in that worker's isolate
+var workerSource = [
+    "var wt = require('worker_threads');",
+    "var sodium = require(wt.workerData.bindingPath);",
+    "var key = Buffer.alloc(sodium.crypto_secretbox_KEYBYTES, wt.workerData.id);",
+    "var nonce = Buffer.alloc(sodium.crypto_secretbox_NONCEBYTES, 1);",
+    "var message = Buffer.alloc(100000, wt.workerData.id);",
+    "var results = [];",
+    "for (var i = 0; i < 20; i++) {",
+    "    var c = sodium.crypto_secretbox_easy(message, nonce, key);",
+    "    results.push(sodium.crypto_secretbox_open_easy(c, nonce, key).equals(message));",
+    "}",
+    "var keyRing = new sodium.KeyRing();",
+    "var pubKey = sodium.KeyRing().createKeyPair('ed25519');",
+    "results.push(typeof pubKey.publicKey === 'string');",
+    "results.push(typeof keyRing.createKeyPair('curve25519').publicKey === 'string');",
+    "sodium.crypto_secretbox_easy_async(message, nonce, key, function(err, cipherText) {",
+    "    results.push(!err && sodium.crypto_secretbox_open_easy(cipherText, nonce, key).equals(message));",
+    "    sodium.crypto_pwhash_scryptsalsa208sha256_async(Buffer.from('password'), Buffer.alloc(32, 2), function(err, derivedKey) {",
+    "        results.push(!err && derivedKey.length === 32);",
+    "        keyRing.clear();",
+    "        wt.parentPort.postMessage({ ok: results.every(Boolean), key: derivedKey.toString('hex') });",
+    "    });",
+    "});"
+].join('\n');
+
+describe('worker_threads', function() {
+    this.timeout(60000);
+
+    it('should load and run the module in several workers concurrently', function(done) {
+        if (!workerThreads) return this.skip();
+
+        // Make sure the main thread instance is loaded too
+        var sodium = require(bindingPath);
+        var expectedKey = sodium.crypto_pwhash_scryptsalsa208sha256(Buffer.from('password'), Buffer.alloc(32, 2)).toString('hex');
+
+        var count = 4, remaining = count, failed = false;
+        for (var i = 0; i < count; i++) {
+            var worker = new workerThreads.Worker(workerSource, {
+                eval: true,
+                workerData: { bindingPath: bindingPath, id: i + 1 }
+            });
+            worker.on('message', function(result) {
+                result.ok.should.be.ok;
+                result.key.should.eql(expectedKey);
+            });
+            worker.on('error', function(err) {
+                if (!failed) {
+                    failed = true;
+                    done(err);
+                }
+            });
+            worker.on('exit', function(code) {
+                if (failed) return;
+                if (code !== 0) {
+                    failed = true;
+                    return done(new Error('worker exited with code ' + code));
+                }
+                if (--remaining === 0) done();
+            });
+        }
+    });
+
+    it('should survive workers exiting with jobs in flight', function(done) {
+        if (!workerThreads) return this.skip();
+
+        var source = [
+            "var wt = require('worker_threads');",
+            "var sodium = require(wt.workerData.bindingPath);",
+            "for (var i = 0; i < 8; i++) {",
+            "    sodium.crypto_pwhash_scryptsalsa208sha256_async(Buffer.from('password'), Buffer.alloc(32, 3), function() {});",
+            "}",
+            "process.exit(0);"
+        ].join('\n');
+        var worker = new workerThreads.Worker(source, { eval: true, workerData: { bindingPath: bindingPath } });
+        worker.on('error', done);
+        worker.on('exit', function() {
+            var sodium = require(bindingPath);
+            sodium.crypto_secretbox_easy_async(Buffer.from('still alive'), Buffer.alloc(sodium.crypto_secretbox_NONCEBYTES), Buffer.alloc(sodium.crypto_secretbox_KEYBYTES), function(err, cipherText) {
+                should.not.exist(err);
+                cipherText.length.should.eql(11 + sodium.crypto_secretbox_MACBYTES);
+                done();
+            });
+        });
+    });
+});
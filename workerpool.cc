@@ -0,0 +1,303 @@
+/**
+ * Thread pool dedicated to the crypto operations of the addon
+ */
+#include <cstdlib>
+
+#include "workerpool.h"
+
+#define WORKERPOOL_MAX_THREADS 128
+
+uv_once_t WorkerPool::initOnce = UV_ONCE_INIT;
+uv_thread_t* WorkerPool::threads = 0;
+unsigned int WorkerPool::threadCount = 0;
+uv_mutex_t WorkerPool::mutex;
+uv_cond_t WorkerPool::cond;
+uv_cond_t WorkerPool::executedCond;
+std::deque<WorkerPool::Job> WorkerPool::pending;
+std::map<uv_loop_t*, WorkerPool::LoopContext*> WorkerPool::contexts;
+unsigned int WorkerPool::active = 0;
+unsigned int WorkerPool::pendingTasks = 0;
+unsigned long long WorkerPool::completed = 0;
+unsigned long long WorkerPool::parallelTasks = 0;
+
+void WorkerPool::InitThreads() {
+    unsigned int size = 0;
+    const char* sizeStr = getenv("SODIUM_THREADPOOL_SIZE");
+    if (sizeStr != 0) {
+        size = (unsigned int) atoi(sizeStr);
+    }
+    if (size == 0) {
+        uv_cpu_info_t* cpus;
+        int cpuCount = 0;
+        if (uv_cpu_info(&cpus, &cpuCount) == 0) {
+            uv_free_cpu_info(cpus, cpuCount);
+        }
+        size = cpuCount > 0 ? (unsigned int) cpuCount : 1;
+    }
+    if (size > WORKERPOOL_MAX_THREADS) size = WORKERPOOL_MAX_THREADS;
+
+    uv_mutex_init(&mutex);
+    uv_cond_init(&cond);
+    uv_cond_init(&executedCond);
+
+    threads = new uv_thread_t[size];
+    for (unsigned int i = 0; i < size; i++) {
+        if (uv_thread_create(&threads[threadCount], ThreadMain, 0) == 0) {
+            threadCount++;
+        }
+    }
+}
+
+void WorkerPool::Init() {
+    uv_once(&initOnce, InitThreads);
+
+    uv_loop_t* loop = Nan::GetCurrentEventLoop();
+    uv_mutex_lock(&mutex);
+    bool exists = contexts.find(loop) != contexts.end();
+    uv_mutex_unlock(&mutex);
+    if (exists) return;
+
+    LoopContext* context = new LoopContext();
+    context->loop = loop;
+    context->inFlight = 0;
+    context->executing = 0;
+    context->completedAsync.data = context;
+    uv_async_init(loop, &context->completedAsync, OnCompleted);
+    // Idle pool must not keep the loop alive
+    uv_unref((uv_handle_t*) &context->completedAsync);
+
+    uv_mutex_lock(&mutex);
+    contexts[loop] = context;
+    uv_mutex_unlock(&mutex);
+
+#ifdef SODIUM_HAS_CLEANUP_HOOKS
+    node::AddEnvironmentCleanupHook(v8::Isolate::GetCurrent(), CleanupLoop, context);
+#endif
+}
+
+void WorkerPool::QueueWorker(Nan::AsyncWorker* worker) {
+    uv_loop_t* loop = Nan::GetCurrentEventLoop();
+    uv_mutex_lock(&mutex);
+    std::map<uv_loop_t*, LoopContext*>::iterator it = contexts.find(loop);
+    LoopContext* context = it != contexts.end() ? it->second : 0;
+    uv_mutex_unlock(&mutex);
+
+    if (threadCount == 0 || context == 0) {
+        // No thread could be started, or unknown loop: fall back to libuv's pool
+        Nan::AsyncQueueWorker(worker);
+        return;
+    }
+
+    if (context->inFlight++ == 0) {
+        uv_ref((uv_handle_t*) &context->completedAsync);
+    }
+
+    Job job = { worker, context, 0, 0 };
+    uv_mutex_lock(&mutex);
+    pending.push_back(job);
+    uv_cond_signal(&cond);
+    uv_mutex_unlock(&mutex);
+}
+
+WorkerPool::Stats WorkerPool::GetStats() {
+    Stats stats;
+    uv_mutex_lock(&mutex);
+    stats.threads = threadCount;
+    stats.queued = (unsigned int) pending.size() - pendingTasks;
+    stats.active = active;
+    stats.completed = completed;
+    stats.parallelTasks = parallelTasks;
+    uv_mutex_unlock(&mutex);
+    return stats;
+}
+
+void WorkerPool::ThreadMain(void* arg) {
+    for (;;) {
+        uv_mutex_lock(&mutex);
+        while (pending.empty()) {
+            uv_cond_wait(&cond, &mutex);
+        }
+        Job job = pending.front();
+        pending.pop_front();
+        if (job.worker == 0) {
+            pendingTasks--;
+            uv_mutex_unlock(&mutex);
+            job.task(job.arg);
+            uv_mutex_lock(&mutex);
+            parallelTasks++;
+            uv_mutex_unlock(&mutex);
+            continue;
+        }
+        active++;
+        job.context->executing++;
+        uv_mutex_unlock(&mutex);
+
+        job.worker->Execute();
+
+        uv_mutex_lock(&mutex);
+        active--;
+        completed++;
+        job.context->executing--;
+        job.context->done.push_back(job.worker);
+        // Sent under the lock, so that CleanupLoop can't close the handle in between
+        uv_async_send(&job.context->completedAsync);
+        uv_cond_broadcast(&executedCond);
+        uv_mutex_unlock(&mutex);
+    }
+}
+
+// Runs on the event loop thread. uv_async_send calls may be coalesced, so drain everything
+NAUV_WORK_CB(WorkerPool::OnCompleted) {
+    LoopContext* context = static_cast<LoopContext*>(async->data);
+
+    std::deque<Nan::AsyncWorker*> finished;
+    uv_mutex_lock(&mutex);
+    finished.swap(context->done);
+    uv_mutex_unlock(&mutex);
+
+    for (std::deque<Nan::AsyncWorker*>::iterator it = finished.begin(); it != finished.end(); ++it) {
+        (*it)->WorkComplete();
+        (*it)->Destroy();
+    }
+
+    context->inFlight -= (unsigned int) finished.size();
+    if (context->inFlight == 0) {
+        uv_unref((uv_handle_t*) &context->completedAsync);
+    }
+}
+
+/*
+* Called when the environment of a loop is torn down (worker thread exiting).
+* Jobs that haven't started are dropped, running ones are waited for; none of
+* their callbacks are called, the isolate is going away.
+*/
+void WorkerPool::CleanupLoop(void* arg) {
+    LoopContext* context = static_cast<LoopContext*>(arg);
+    std::deque<Nan::AsyncWorker*> dropped;
+
+    uv_mutex_lock(&mutex);
+    contexts.erase(context->loop);
+    for (std::deque<Job>::iterator it = pending.begin(); it != pending.end();) {
+        if (it->context == context) {
+            dropped.push_back(it->worker);
+            it = pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    while (context->executing > 0) {
+        uv_cond_wait(&executedCond, &mutex);
+    }
+    dropped.insert(dropped.end(), context->done.begin(), context->done.end());
+    context->done.clear();
+    uv_mutex_unlock(&mutex);
+
+    for (std::deque<Nan::AsyncWorker*>::iterator it = dropped.begin(); it != dropped.end(); ++it) {
+        (*it)->Destroy();
+    }
+
+    uv_close((uv_handle_t*) &context->completedAsync, OnContextClosed);
+}
+
+void WorkerPool::OnContextClosed(uv_handle_t* handle) {
+    delete static_cast<LoopContext*>(handle->data);
+}
+
+/*
+* ParallelFor state. Shared by the calling thread and the helper tasks; freed by the last one to release it,
+* since helpers may start after all the chunks have been processed.
+*/
+struct WorkerPool::Range {
+    size_t count;
+    size_t chunkSize;
+    size_t next;
+    size_t chunksLeft;
+    unsigned int refs;
+    RangeFunction fn;
+    void* data;
+    uv_cond_t doneCond;
+};
+
+// Processes one chunk. Returns false when there is none left to take
+bool WorkerPool::RunChunk(Range* range) {
+    uv_mutex_lock(&mutex);
+    if (range->next >= range->count) {
+        uv_mutex_unlock(&mutex);
+        return false;
+    }
+    size_t begin = range->next;
+    size_t end = begin + range->chunkSize < range->count ? begin + range->chunkSize : range->count;
+    range->next = end;
+    uv_mutex_unlock(&mutex);
+
+    range->fn(begin, end, range->data);
+
+    uv_mutex_lock(&mutex);
+    if (--range->chunksLeft == 0) {
+        uv_cond_signal(&range->doneCond);
+    }
+    uv_mutex_unlock(&mutex);
+    return true;
+}
+
+void WorkerPool::ReleaseRange(Range* range) {
+    uv_mutex_lock(&mutex);
+    bool last = --range->refs == 0;
+    uv_mutex_unlock(&mutex);
+    if (last) {
+        uv_cond_destroy(&range->doneCond);
+        delete range;
+    }
+}
+
+void WorkerPool::RangeTask(void* arg) {
+    Range* range = static_cast<Range*>(arg);
+    while (RunChunk(range)) {}
+    ReleaseRange(range);
+}
+
+void WorkerPool::ParallelFor(size_t count, size_t grain, RangeFunction fn, void* data) {
+    if (count == 0) return;
+    uv_once(&initOnce, InitThreads);
+    if (grain == 0) grain = 1;
+
+    // A few chunks per thread, so that a slow one doesn't hold everybody
+    size_t chunkSize = count / ((size_t) (threadCount + 1) * 4);
+    if (chunkSize < grain) chunkSize = grain;
+    size_t chunks = (count + chunkSize - 1) / chunkSize;
+    if (chunks == 1 || threadCount == 0) {
+        fn(0, count, data);
+        return;
+    }
+
+    unsigned int helpers = chunks - 1 < threadCount ? (unsigned int) (chunks - 1) : threadCount;
+
+    Range* range = new Range();
+    range->count = count;
+    range->chunkSize = chunkSize;
+    range->next = 0;
+    range->chunksLeft = chunks;
+    range->refs = helpers + 1;
+    range->fn = fn;
+    range->data = data;
+    uv_cond_init(&range->doneCond);
+
+    uv_mutex_lock(&mutex);
+    for (unsigned int i = 0; i < helpers; i++) {
+        Job job = { 0, 0, RangeTask, range };
+        pending.push_back(job);
+    }
+    pendingTasks += helpers;
+    uv_cond_broadcast(&cond);
+    uv_mutex_unlock(&mutex);
+
+    while (RunChunk(range)) {}
+
+    uv_mutex_lock(&mutex);
+    while (range->chunksLeft > 0) {
+        uv_cond_wait(&range->doneCond, &mutex);
+    }
+    uv_mutex_unlock(&mutex);
+
+    ReleaseRange(range);
+}
@@ -0,0 +1,105 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <deque>
+#include <map>
+
+#include <uv.h>
+#include <node.h>
+#include <nan.h>
+
+// Environment cleanup hooks, needed to tear down per-isolate state when a worker thread exits
+#if NODE_MAJOR_VERSION > 10 || (NODE_MAJOR_VERSION == 10 && NODE_MINOR_VERSION >= 2)
+#define SODIUM_HAS_CLEANUP_HOOKS 1
+#endif
+
+/**
+ * Thread pool owned by the addon, used for the heavy crypto operations
+ * (scrypt, file encryption...) so that they don't compete with fs/dns/zlib
+ * for the threads of libuv's default pool.
+ *
+ * Nan::AsyncWorker instances are queued exactly as with Nan::AsyncQueueWorker:
+ * Execute() runs on one of the pool threads, then WorkComplete() and Destroy()
+ * are called back on the thread of the event loop that queued the worker.
+ *
+ * The threads are shared by the whole process. Each event loop (main thread or
+ * worker_threads) the addon is loaded in gets its own completion handle.
+ */
+class WorkerPool {
+public:
+    // queued, active and completed count the queued workers only. The chunks a ParallelFor
+    // hands to the pool threads are counted apart, in parallelTasks, once done
+    struct Stats {
+        unsigned int threads;
+        unsigned int queued;
+        unsigned int active;
+        unsigned long long completed;
+        unsigned long long parallelTasks;
+    };
+
+    // Creates the pool threads, once per process. The size is taken from the
+    // SODIUM_THREADPOOL_SIZE environment variable if set, or from the number of CPUs otherwise.
+    // Then sets up the completion handle of the current event loop
+    static void Init();
+
+    // Queues a worker. Must be called from the thread of an event loop Init() has been called on
+    static void QueueWorker(Nan::AsyncWorker* worker);
+
+    static Stats GetStats();
+
+    // Body of a ParallelFor: processes the items [begin, end)
+    typedef void (*RangeFunction)(size_t begin, size_t end, void* data);
+
+    // Splits [0, count) in chunks of at least grain items and runs fn on them, on the pool
+    // threads and on the calling thread, which takes chunks too instead of just waiting.
+    // Returns once every item has been processed. Safe to call from a pool thread (from Execute).
+    static void ParallelFor(size_t count, size_t grain, RangeFunction fn, void* data);
+
+private:
+    // Completion state of one event loop
+    struct LoopContext {
+        uv_loop_t* loop;
+        uv_async_t completedAsync;
+        std::deque<Nan::AsyncWorker*> done;
+        // Jobs queued and not yet completed on the loop. Only touched on the loop thread
+        unsigned int inFlight;
+        // Jobs of this loop being executed by a pool thread
+        unsigned int executing;
+    };
+
+    // Either a Nan::AsyncWorker, completed on the loop of context, or a plain task (worker == 0)
+    struct Job {
+        Nan::AsyncWorker* worker;
+        LoopContext* context;
+        void (*task)(void* arg);
+        void* arg;
+    };
+
+    struct Range;
+    static bool RunChunk(Range* range);
+    static void ReleaseRange(Range* range);
+    static void RangeTask(void* arg);
+
+    static void InitThreads();
+    static void ThreadMain(void* arg);
+    static NAUV_WORK_CB(OnCompleted);
+    static void CleanupLoop(void* arg);
+    static void OnContextClosed(uv_handle_t* handle);
+
+    static uv_once_t initOnce;
+    static uv_thread_t* threads;
+    static unsigned int threadCount;
+    static uv_mutex_t mutex;
+    static uv_cond_t cond;
+    // Signaled when a job completes, for CleanupLoop
+    static uv_cond_t executedCond;
+    static std::deque<Job> pending;
+    static std::map<uv_loop_t*, LoopContext*> contexts;
+    // Workers running, and ParallelFor tasks among the pending jobs
+    static unsigned int active;
+    static unsigned int pendingTasks;
+    static unsigned long long completed;
+    static unsigned long long parallelTasks;
+};
+
+#endif